@@ -1,113 +1,642 @@
 #include "audio_processor.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include "../gstreamer/sample_decoder.h"
+#include "../dsp/resampler.h"
+#include "../dsp/time_stretch.h"
 
 namespace mpccli {
 
+namespace {
+
+constexpr size_t kDefaultPitchCacheBytes = 128 * 1024 * 1024;
+
+// Velocity curve: squared, so 127 is full volume and 64 is about -12 dB
+float velocityGain(int velocity) {
+  const float v = static_cast<float>(velocity) / 127.0f;
+  return v * v;
+}
+
+// Whether a definition plays any of `files`
+bool usesAnyFile(const SampleDefinition& definition, const std::set<std::string>& files) {
+  for (const SampleLayer& layer : definition.layers) {
+    for (const std::string& file : layer.files) {
+      if (files.count(file)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+AudioProcessor::AudioProcessor(std::shared_ptr<PadTable> pads)
+    : pads_(pads ? std::move(pads) : std::make_shared<PadTable>()),
+      sounds_(kMaxPads),
+      registered_count_(0),
+      engine_(kEngineSampleRate, kEngineChannels),
+      pitch_cache_(kDefaultPitchCacheBytes, engine_.epochs(),
+                   [this](PadId pad, int source, std::shared_ptr<const SampleBuffer>& original,
+                          PitchVariantCache::Renderer& renderer) {
+                     std::lock_guard<std::mutex> lock(mutex_);
+                     const std::shared_ptr<PadSound>& sound = sounds_[pad];
+                     if (!sound || source < 0 || static_cast<size_t>(source) >= sound->sources.size()) {
+                       return false;
+                     }
+                     original = sound->sources[source];
+                     renderer = variantRenderer(sound->definition.options.pitch_mode);
+                     return true;
+                   }),
+      output_latency_seconds_(0.0),
+      closed_underruns_(0),
+      prefaulted_bytes_(0),
+      dropped_notes_(0) {
+}
+
 AudioProcessor::~AudioProcessor() {
-  // Copy the pipelines and release the lock before stopping them
-  // This prevents deadlock if GStreamer callbacks try to acquire the lock
-  std::map<char, std::unique_ptr<AudioPipeline>> pipelines_to_stop;
+  // The cache's worker resolves requests against sounds_ under mutex_
+  pitch_cache_.stop();
+
+  // Stop the output first so the streaming thread no longer renders
+  // voices that point into the sample buffers freed below
+  std::unique_ptr<AudioOutput> output_to_stop;
   {
     std::lock_guard<std::mutex> lock(mutex_);
-    pipelines_to_stop = std::move(pipelines_);
+    output_to_stop = std::move(output_);
+  }
+
+  if (output_to_stop) {
+    output_to_stop->destroy();
+  }
+
+  // The table can outlive the processor: leave nothing in it pointing at freed sounds
+  for (size_t pad = 0; pad < kMaxPads; ++pad) {
+    (*pads_)[static_cast<PadId>(pad)].sound.store(nullptr, std::memory_order_release);
+  }
+}
+
+void AudioProcessor::registerSample(PadId pad, const std::string& audio_file, const SampleOptions& options) {
+  SampleLayer layer;
+  layer.files.push_back(audio_file);
+  registerSample(pad, std::vector<SampleLayer>{layer}, options);
+}
+
+void AudioProcessor::registerSample(PadId pad, const std::vector<SampleLayer>& layers, const SampleOptions& options) {
+  std::lock_guard<std::mutex> update_lock(update_mutex_);
+  std::shared_ptr<PadSound> sound = prepareSound(pad, {layers, options});
+  if (!sound) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  installSoundLocked(pad, std::move(sound));
+}
+
+std::shared_ptr<PadSound> AudioProcessor::prepareSound(PadId pad, const SampleDefinition& definition) {
+  constexpr int kVelocityLevels = PadSound::kVelocityLevels;
+  if (pad >= kMaxPads) {
+    std::cerr << "Pad " << pad << " is out of range (at most " << kMaxPads << " pads)" << std::endl;
+    return nullptr;
+  }
+
+  auto sound = std::make_shared<PadSound>();
+  sound->definition = definition;
+  const std::vector<SampleLayer>& layers = definition.layers;
+
+  try {
+    // Decode into memory once; every trigger reads from these buffers
+    for (const SampleLayer& layer : layers) {
+      if (layer.files.empty()) {
+        continue;
+      }
+      PadSound::Layer sound_layer;
+      sound_layer.first_source = static_cast<int>(sound->sources.size());
+      for (const std::string& file : layer.files) {
+        sound_layer.alternates.push_back(loadFile(file));
+        sound->sources.push_back(sound_layer.alternates.back());
+      }
+      sound->layers.push_back(std::move(sound_layer));
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Failed to load sample: " << e.what() << std::endl;
+    return nullptr;
   }
 
-  // Now stop all pipelines without holding the lock
-  for (auto& [key, pipeline] : pipelines_to_stop) {
-    if (pipeline) {
-      pipeline->destroy();
+  if (sound->layers.empty()) {
+    std::cerr << "No audio files given for pad " << pad << std::endl;
+    return nullptr;
+  }
+  sound->next_alternate = std::make_unique<std::atomic<uint32_t>[]>(sound->layers.size());
+
+  // Mapped kit audio is only read from disk when first touched: do it here, not on the audio thread
+  if (realtime_.prefault) {
+    for (const auto& source : sound->sources) {
+      prefaultMemory(source->data(), source->size() * sizeof(float));
+      prefaulted_bytes_.fetch_add(source->size() * sizeof(float), std::memory_order_relaxed);
     }
   }
+
+  // Resolve every velocity to a layer and gain up front so triggering is a table lookup.
+  // The first layer covering a velocity wins; gaps use the nearest layer below (or above).
+  constexpr uint8_t kUnassigned = 0xFF;
+  std::array<uint8_t, kVelocityLevels> layer_for_velocity;
+  layer_for_velocity.fill(kUnassigned);
+  size_t index = 0;
+  for (const SampleLayer& layer : layers) {
+    if (layer.files.empty()) {
+      continue;
+    }
+    const int low = std::clamp(layer.velocity_low, 0, kVelocityLevels - 1);
+    const int high = std::clamp(layer.velocity_high, 0, kVelocityLevels - 1);
+    for (int v = low; v <= high; ++v) {
+      if (layer_for_velocity[v] == kUnassigned) {
+        layer_for_velocity[v] = static_cast<uint8_t>(index);
+      }
+    }
+    ++index;
+  }
+  uint8_t previous = kUnassigned;
+  for (uint8_t& layer : layer_for_velocity) {
+    layer = layer == kUnassigned ? previous : layer;
+    previous = layer;
+  }
+  for (int v = kVelocityLevels - 1; v >= 0; --v) {
+    if (layer_for_velocity[v] == kUnassigned) {
+      layer_for_velocity[v] = v + 1 < kVelocityLevels ? layer_for_velocity[v + 1] : 0;
+    }
+  }
+
+  for (int v = 0; v < kVelocityLevels; ++v) {
+    sound->velocity_map[v].layer = layer_for_velocity[v];
+    sound->velocity_map[v].gain = static_cast<float>(definition.options.volume) * velocityGain(v);
+  }
+
+  return sound;
 }
 
-void AudioProcessor::setAmplitudeCallback(AmplitudeUpdateCallback callback) {
+void AudioProcessor::installSoundLocked(PadId pad, std::shared_ptr<PadSound> sound) {
+  // Publish first, then retire: triggers pinned from the retirement on only see the new
+  // sound. Those that loaded the old one, the notes they queued and the voices (and
+  // scheduled notes) playing it keep it alive until they are done.
+  std::shared_ptr<PadSound> replaced = std::move(sounds_[pad]);
+  sounds_[pad] = std::move(sound);
+  const PadSound& installed = *sounds_[pad];
+  (*pads_)[pad].sound.store(&installed, std::memory_order_seq_cst);
+  // After publishing, so a variant of the old sample rendered meanwhile is discarded
+  pitch_cache_.invalidate(pad);
+  if (replaced) {
+    retired_.push_back({std::move(replaced), engine_.epochs().retire()});
+  } else {
+    ++registered_count_;
+  }
+  releaseRetiredLocked();
+  const SampleOptions& options = installed.definition.options;
+
+  // Pre-render the notes reachable in pitch mode without an octave shift
+  if (options.pitch_mode == PitchMode::Stretch && options.precompute_pitches) {
+    prefetchPitches(pad, installed, 0, 12);
+  }
+
+  const size_t file_count = installed.sources.size();
+  std::cout << "Registered pad " << pad << " -> " << installed.definition.layers.front().files.front();
+  if (file_count > 1) {
+    std::cout << " (+" << file_count - 1 << " more in " << installed.layers.size() << " layers)";
+  }
+  std::cout << " (volume: " << options.volume
+            << (options.pitch_mode == PitchMode::Stretch ? ", pitch: stretch" : "")
+            << (options.envelope ? ", envelope" : "") << ")" << std::endl;
+}
+
+void AudioProcessor::removeSoundLocked(PadId pad) {
+  (*pads_)[pad].sound.store(nullptr, std::memory_order_seq_cst);
+  retired_.push_back({std::move(sounds_[pad]), engine_.epochs().retire()});
+  pitch_cache_.invalidate(pad);
+  --registered_count_;
+}
+
+bool AudioProcessor::reloadSample(PadId pad) {
+  std::lock_guard<std::mutex> update_lock(update_mutex_);
+
+  SampleDefinition definition;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pad >= kMaxPads || !sounds_[pad]) {
+      return false;
+    }
+    definition = sounds_[pad]->definition;
+  }
+
+  // Force a fresh decode instead of reusing the cached buffers
+  for (const SampleLayer& layer : definition.layers) {
+    for (const std::string& file : layer.files) {
+      decoded_files_.erase(file);
+    }
+  }
+
+  std::shared_ptr<PadSound> sound = prepareSound(pad, definition);
+  if (!sound) {
+    return false;
+  }
+
   std::lock_guard<std::mutex> lock(mutex_);
-  amplitude_callback_ = std::move(callback);
+  installSoundLocked(pad, std::move(sound));
+  return true;
+}
 
-  // Set callbacks for all existing pipelines
-  for (auto& [k, pipeline] : pipelines_) {
-    if (pipeline) {
-      pipeline->setAmplitudeCallback([this, k](float amplitude) {
-        if (this->amplitude_callback_) {
-          this->amplitude_callback_(k, amplitude);
-        }
-      });
+SampleUpdateSummary AudioProcessor::updateSamples(const std::map<PadId, SampleDefinition>& samples,
+                                                  const std::set<std::string>& changed_files) {
+  std::lock_guard<std::mutex> update_lock(update_mutex_);
+  SampleUpdateSummary summary;
+
+  // Edited files must be decoded again rather than taken from the cache
+  for (const std::string& file : changed_files) {
+    decoded_files_.erase(file);
+  }
+
+  std::vector<std::pair<PadId, const SampleDefinition*>> to_load;
+  std::vector<PadId> to_remove;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [pad, definition] : samples) {
+      const PadSound* sound = pad < kMaxPads ? sounds_[pad].get() : nullptr;
+      if (sound && sound->definition == definition && !usesAnyFile(definition, changed_files)) {
+        ++summary.unchanged;
+      } else {
+        to_load.emplace_back(pad, &definition);
+      }
     }
+    for (size_t pad = 0; pad < kMaxPads; ++pad) {
+      if (sounds_[pad] && samples.find(static_cast<PadId>(pad)) == samples.end()) {
+        to_remove.push_back(static_cast<PadId>(pad));
+      }
+    }
+  }
+
+  // Decode without holding mutex_, so the current samples keep triggering meanwhile
+  std::vector<std::pair<PadId, std::shared_ptr<PadSound>>> prepared;
+  for (const auto& [pad, definition] : to_load) {
+    if (std::shared_ptr<PadSound> sound = prepareSound(pad, *definition)) {
+      prepared.emplace_back(pad, std::move(sound));
+    } else {
+      ++summary.failed;
+    }
+  }
+
+  // Publish every pad in one critical section. The engine only starts queued notes at the
+  // beginning of a block, so the new kit takes effect at a buffer boundary; voices already
+  // playing keep the buffers they started with.
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& [pad, sound] : prepared) {
+    installSoundLocked(pad, std::move(sound));
+    ++summary.loaded;
+  }
+  for (PadId pad : to_remove) {
+    removeSoundLocked(pad);
+    ++summary.removed;
+  }
+  releaseRetiredLocked();
+
+  return summary;
+}
+
+void AudioProcessor::provideDecodedFiles(
+    const std::unordered_map<std::string, std::shared_ptr<const SampleBuffer>>& files) {
+  std::lock_guard<std::mutex> update_lock(update_mutex_);
+  for (const auto& [path, buffer] : files) {
+    decoded_files_[path] = buffer;
   }
 }
 
-void AudioProcessor::registerSample(char key, const std::string& audio_file, double volume) {
+std::vector<PadId> AudioProcessor::registeredPads() const {
   std::lock_guard<std::mutex> lock(mutex_);
-  sample_map_[key] = audio_file;
+  std::vector<PadId> pads;
+  for (size_t pad = 0; pad < kMaxPads; ++pad) {
+    if (sounds_[pad]) {
+      pads.push_back(static_cast<PadId>(pad));
+    }
+  }
+  return pads;
+}
 
-  try {
-    // Create a new pipeline with volume control
-    pipelines_[key] = std::make_unique<AudioPipeline>(audio_file, nullptr, volume);
+void AudioProcessor::releaseRetiredLocked() {
+  const ReclaimEpochs& epochs = engine_.epochs();
+  retired_.erase(std::remove_if(retired_.begin(), retired_.end(),
+                                [&](RetiredSound& r) { return epochs.reclaimable(r.retirement); }),
+                 retired_.end());
+}
 
-    // Set amplitude callback if we have one
-    if (amplitude_callback_) {
-      pipelines_[key]->setAmplitudeCallback([this, key](float amplitude) {
-        if (this->amplitude_callback_) {
-          this->amplitude_callback_(key, amplitude);
-        }
-      });
+std::shared_ptr<const SampleBuffer> AudioProcessor::loadFile(const std::string& path) {
+  auto it = decoded_files_.find(path);
+  if (it != decoded_files_.end()) {
+    if (auto buffer = it->second.lock()) {
+      return buffer;
     }
-  } catch (const std::exception& e) {
-    std::cerr << "Failed to create pipeline: " << e.what() << std::endl;
   }
 
-  std::cout << "Registered key '" << key << "' -> " << audio_file << " (volume: " << volume << ")" << std::endl;
+  auto buffer = std::make_shared<const SampleBuffer>(decodeAudioFile(path, engine_.sampleRate(), engine_.channels()));
+  decoded_files_[path] = buffer;
+  return buffer;
 }
 
-bool AudioProcessor::playSample(char key) {
+void AudioProcessor::setResamplerQuality(ResamplerQuality quality) {
+  engine_.setResamplerQuality(quality);
+}
+
+void AudioProcessor::setMixer(const MixerRouting& routing) {
+  std::lock_guard<std::mutex> update_lock(update_mutex_);
+  routing_ = routing;
+  auto mixer = std::make_unique<MixerGraph>(routing, engine_.sampleRate(), engine_.channels(),
+                                            AudioEngine::kMaxBlockFrames, engine_.renderThreads());
+  std::cout << "Mixer: " << mixer->channelCount() << " pad channels (" << mixer->effectCount()
+            << " with effects), " << mixer->busCount() << " buses" << std::endl;
+  engine_.setMixer(std::move(mixer));
+}
+
+bool AudioProcessor::setOutput(const OutputSettings& settings) {
+  std::lock_guard<std::mutex> update_lock(update_mutex_);
+  std::unique_ptr<AudioOutput> output_to_stop;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    output_settings_ = settings;
+    output_to_stop = std::move(output_);
+  }
+
+  // The engine can only change rate while nothing renders
+  const bool was_open = output_to_stop != nullptr;
+  if (was_open) {
+    output_to_stop->destroy();
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_underruns_ += output_to_stop->underruns();
+    output_to_stop.reset();
+  }
+  if (settings.sample_rate != engine_.sampleRate()) {
+    engine_.setSampleRate(settings.sample_rate);
+    engine_.setMixer(std::make_unique<MixerGraph>(routing_, engine_.sampleRate(), engine_.channels(),
+                                                  AudioEngine::kMaxBlockFrames, engine_.renderThreads()));
+  }
+  return was_open ? start() : true;
+}
+
+OutputSettings AudioProcessor::outputSettings() const {
   std::lock_guard<std::mutex> lock(mutex_);
+  return output_settings_;
+}
 
-  // Find the pipeline for this key
-  auto it = pipelines_.find(key);
-  if (it == pipelines_.end()) {
-    std::cout << "No sample registered for key: " << key << std::endl;
-    return false;
+void AudioProcessor::setTempo(double bpm) {
+  engine_.setTempo(bpm);
+}
+
+void AudioProcessor::setRenderThreads(size_t threads) {
+  std::lock_guard<std::mutex> update_lock(update_mutex_);
+  engine_.setRenderThreads(threads);
+  std::cout << "Render threads: " << engine_.renderThreads() << std::endl;
+}
+
+void AudioProcessor::setRealtime(const RealtimeSettings& realtime) {
+  std::lock_guard<std::mutex> update_lock(update_mutex_);
+  realtime_ = realtime;
+  if (realtime_.setsUpAudioThreads()) {
+    engine_.setWorkerSetup([this, realtime](size_t worker) {
+      recordThreadSetup(worker, setupCurrentThread(realtime.audio, realtime.prefault, worker));
+    });
+  } else {
+    engine_.setWorkerSetup(nullptr);
   }
+}
 
-  // Reset pitch to original before playing
-  it->second->setPitch(0.0);
+void AudioProcessor::recordThreadSetup(size_t thread, const ThreadSetupResult& result) {
+  ThreadSetupSlot& slot = thread_setups_[thread];
+  if (!slot.ready.load(std::memory_order_acquire)) {
+    slot.result = result;
+    slot.ready.store(true, std::memory_order_release);
+  }
+}
 
-  // Start playback (will seek to beginning if needed)
-  try {
-    if (it->second->start()) {
-      return true;
-    } else {
-      return false;
+std::vector<std::string> AudioProcessor::takeThreadSetupReports() {
+  std::vector<std::string> reports;
+  for (size_t thread = 0; thread < thread_setups_.size(); ++thread) {
+    ThreadSetupSlot& slot = thread_setups_[thread];
+    if (slot.ready.load(std::memory_order_acquire)) {
+      const std::string name = thread == 0 ? "output thread" : "render worker " + std::to_string(thread);
+      reports.push_back(describeThreadSetup(name, realtime_.audio, slot.result));
+      slot.ready.store(false, std::memory_order_release);
     }
-  } catch (const std::exception& e) {
-    std::cerr << "Failed to play sample: " << e.what() << std::endl;
-    return false;
   }
+  return reports;
 }
 
-bool AudioProcessor::playSampleWithPitch(char key, double semitones) {
+size_t AudioProcessor::sampleBytes() const {
   std::lock_guard<std::mutex> lock(mutex_);
+  std::set<const SampleBuffer*> buffers;
+  size_t bytes = 0;
+  for (const auto& sound : sounds_) {
+    if (!sound) {
+      continue;
+    }
+    for (const auto& source : sound->sources) {
+      if (buffers.insert(source.get()).second) {
+        bytes += source->size() * sizeof(float);
+      }
+    }
+  }
+  return bytes;
+}
+
+void AudioProcessor::setPitchCacheBudget(size_t bytes) {
+  pitch_cache_.setBudget(bytes);
+}
 
-  // Find the pipeline for this key
-  auto it = pipelines_.find(key);
-  if (it == pipelines_.end()) {
-    std::cout << "No sample registered for key: " << key << std::endl;
+void AudioProcessor::preparePitchMode(PadId pad, int octave_offset) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (pad < kMaxPads && sounds_[pad]) {
+    prefetchPitches(pad, *sounds_[pad], octave_offset, octave_offset + 12);
+  }
+}
+
+void AudioProcessor::prefetchPitches(PadId pad, const PadSound& sound, int lowest, int highest) {
+  std::vector<int> cents;
+  for (int semitones = lowest; semitones <= highest; ++semitones) {
+    if (semitones != 0) {
+      cents.push_back(semitones * 100);
+    }
+  }
+  pitch_cache_.prefetch(pad, cents, sound.sources, variantRenderer(sound.definition.options.pitch_mode));
+}
+
+PitchVariantCache::Renderer AudioProcessor::variantRenderer(PitchMode pitch_mode) {
+  if (pitch_mode == PitchMode::Stretch) {
+    return [](const SampleBuffer& original, double semitones) { return pitchShift(original, semitones); };
+  }
+
+  // Rate mode: resample once with the best kernel, then play it back at step 1.0
+  return [](const SampleBuffer& original, double semitones) {
+    const double step = std::pow(2.0, semitones / 12.0);
+    const size_t frames = static_cast<size_t>(std::ceil(original.frames() / step));
+    return resampleBuffer(original, step, frames, ResamplerQuality::Sinc);
+  };
+}
+
+bool AudioProcessor::start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (output_) {
+    return output_->start();
+  }
+
+  output_ = AudioOutput::create([this](float* output, size_t frames) { renderAudio(output, frames); },
+                                output_settings_, engine_.channels());
+  if (!output_) {
     return false;
   }
+  // Report the buffering the device actually granted
+  output_settings_ = output_->settings();
+  output_latency_seconds_.store(output_->outputLatencySeconds(), std::memory_order_relaxed);
+  return output_->start();
+}
 
-  // Set pitch before playing
-  it->second->setPitch(semitones);
+bool AudioProcessor::playSample(PadId pad) {
+  return playSampleWithPitch(pad, 0.0);
+}
 
-  // Start playback (will seek to beginning if needed)
-  try {
-    if (it->second->start()) {
-      return true;
+bool AudioProcessor::playSampleWithPitch(PadId pad, double semitones, int velocity,
+                                         std::chrono::steady_clock::time_point received,
+                                         std::chrono::steady_clock::time_point play_at, TriggerSource input) {
+  // A timetag far in the future would hold a schedule slot (and the sound it plays) for that long
+  if (play_at != std::chrono::steady_clock::time_point{} &&
+      play_at - std::chrono::steady_clock::now() > kMaxScheduleAhead) {
+    dropped_notes_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  // One indexed load under an epoch pin: a sound (or pitch variant) replaced from here on
+  // isn't freed until this trigger has returned and the note it queues has finished
+  const ReclaimEpochs::Pin pin = engine_.epochs().pin();
+  const PadSound* found = pad < kMaxPads ? (*pads_)[pad].sound.load(std::memory_order_acquire) : nullptr;
+  if (!found) {
+    return false;
+  }
+  const PadSound& sound = *found;
+  const SampleOptions& options = sound.definition.options;
+
+  // Pick the velocity layer, then its next round-robin alternate
+  const PadSound::VelocityEntry& entry =
+      sound.velocity_map[std::clamp(velocity, 0, PadSound::kVelocityLevels - 1)];
+  const PadSound::Layer& layer = sound.layers[entry.layer];
+  const size_t alternate =
+      sound.next_alternate[entry.layer].fetch_add(1, std::memory_order_relaxed) % layer.alternates.size();
+  const std::shared_ptr<const SampleBuffer>& original = layer.alternates[alternate];
+  const int source = layer.first_source + static_cast<int>(alternate);
+
+  const int cents = static_cast<int>(std::lround(semitones * 100.0));
+
+  TriggerEvent event;
+  event.pad = pad;
+  event.cents = cents;
+  event.gain = entry.gain;
+  event.buffer = original.get();
+  event.epoch = pin.epoch();
+  event.step = 1.0;
+  event.choke_group = options.choke_group;
+  event.received = received;
+  event.source = input;
+  if (play_at != std::chrono::steady_clock::time_point{}) {
+    // Frames are rendered ahead of the device by the output latency, and voices reach the
+    // output after the mixer's lookahead
+    const auto latency = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(output_latency_seconds_.load(std::memory_order_relaxed) + mixerLatencySeconds()));
+    event.start_frame = engine_.frameAt(play_at - latency);
+    // A scheduled note's latency counts from when it was due to render, not from arrival
+    if (received != std::chrono::steady_clock::time_point{}) {
+      event.received = std::max(received, play_at - latency);
+    }
+  }
+  if (options.envelope) {
+    event.use_envelope = true;
+    event.envelope = *options.envelope;
+  }
+
+  // A pre-rendered variant plays at step 1.0 just like an unpitched note. Without one the
+  // original is read faster/slower; Stretch mode also queues the variant on the cache's
+  // worker, so the note isn't held up by a whole-sample render and later hits keep their
+  // duration.
+  if (cents != 0) {
+    if (const SampleBuffer* variant = pitch_cache_.find(pad, source, cents)) {
+      event.buffer = variant;
     } else {
-      return false;
+      if (options.pitch_mode == PitchMode::Stretch) {
+        pitch_cache_.request(pad, source, cents);
+      }
+      event.step = std::pow(2.0, semitones / 12.0);
     }
-  } catch (const std::exception& e) {
-    std::cerr << "Failed to play sample: " << e.what() << std::endl;
-    return false;
+  }
+
+  return engine_.trigger(event);
+}
+
+bool AudioProcessor::releaseSample(PadId pad, double semitones) {
+  return engine_.release(pad, static_cast<int>(std::lround(semitones * 100.0)));
+}
+
+LatencyHistogram::Snapshot AudioProcessor::midiLatency() const {
+  return engine_.midiLatency().snapshot();
+}
+
+double AudioProcessor::outputLatencySeconds() const {
+  return output_latency_seconds_.load(std::memory_order_relaxed);
+}
+
+double AudioProcessor::mixerLatencySeconds() const {
+  return static_cast<double>(engine_.mixerLatencyFrames()) / engine_.sampleRate();
+}
+
+RenderLoad AudioProcessor::renderLoad() const {
+  RenderLoad load;
+  load.deadline_ratio = engine_.deadlineRatio().snapshot();
+  load.overruns = engine_.lateRenders();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  load.underruns = closed_underruns_ + (output_ ? output_->underruns() : 0);
+  return load;
+}
+
+EngineStats AudioProcessor::stats() const {
+  EngineStats stats;
+  stats.active_voices = engine_.activeVoices();
+  stats.late_renders = engine_.lateRenders();
+  stats.dropped_notes = engine_.droppedScheduled() + dropped_notes_.load(std::memory_order_relaxed);
+  stats.render_time = engine_.renderTime().snapshot();
+  stats.trigger_latency = engine_.triggerLatency().snapshot();
+  stats.midi_latency = engine_.midiLatency().snapshot();
+  stats.reverb_time = engine_.reverbTime().snapshot();
+  stats.delay_time = engine_.delayTime().snapshot();
+  stats.load = renderLoad();
+  stats.pitch_cache_bytes = pitch_cache_.memoryUsage();
+
+  stats.output_latency_seconds = output_latency_seconds_.load(std::memory_order_relaxed);
+  stats.limiter_latency_seconds = mixerLatencySeconds();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats.registered_samples = registered_count_;
+  stats.output = output_settings_;
+  return stats;
+}
+
+void AudioProcessor::renderAudio(float* output, size_t frames) {
+  // Each new output thread (after start() or reopening the output) takes the real-time
+  // policy before its first render
+  if (realtime_output_thread_ != std::this_thread::get_id()) {
+    realtime_output_thread_ = std::this_thread::get_id();
+    if (realtime_.setsUpAudioThreads()) {
+      recordThreadSetup(0, setupCurrentThread(realtime_.audio, realtime_.prefault));
+    }
+  }
+
+  engine_.render(output, frames);
+
+  // Meter the pads that sounded in this block
+  for (const PadLevel& level : engine_.padLevels()) {
+    (*pads_)[level.pad].level.store(level.level, std::memory_order_relaxed);
   }
 }
 
@@ -1,48 +1,330 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <string>
 #include <functional>
-#include "../gstreamer/gst_pipeline.h"
+#include <optional>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "pitch_variant_cache.h"
+#include "../output/audio_output.h"
+#include "../realtime/realtime.h"
+#include "../engine/audio_engine.h"
+#include "../dsp/resampler.h"
+#include "../dsp/sample_buffer.h"
+#include "../kit/pad.h"
+#include "../kit/pad_table.h"
 
 namespace mpccli {
 
-// Amplitude callback type for visualization
-using AmplitudeUpdateCallback = std::function<void(char key, float amplitude)>;
+// How a sample produces pitch shifts
+enum class PitchMode {
+  Rate,     // Read the sample faster/slower (pitch and tempo change together)
+  Stretch,  // WSOLA pitch shift that keeps the original duration
+};
+
+// Per-sample playback settings (from samples.yaml)
+struct SampleOptions {
+  double volume = 1.0;                  // 0.0 (muted) to 1.0 (full volume)
+  PitchMode pitch_mode = PitchMode::Rate;
+  bool precompute_pitches = false;      // Pre-render the chromatic octave (0..+12) for Stretch mode
+  std::optional<AdsrParams> envelope;   // If set, pad release starts the envelope's release stage
+  int choke_group = 0;                  // Samples sharing a group cut each other off (0 = none)
+
+  bool operator==(const SampleOptions&) const = default;
+};
+
+// One velocity layer of a pad: plays for velocities in [velocity_low, velocity_high] and
+// cycles through its files (round-robin alternates) on successive hits
+struct SampleLayer {
+  int velocity_low = 0;
+  int velocity_high = 127;
+  std::vector<std::string> files;
+
+  bool operator==(const SampleLayer&) const = default;
+};
+
+// Everything the configuration says about how one pad sounds
+struct SampleDefinition {
+  std::vector<SampleLayer> layers;
+  SampleOptions options;
+
+  bool operator==(const SampleDefinition&) const = default;
+};
+
+// Outcome of AudioProcessor::updateSamples()
+struct SampleUpdateSummary {
+  size_t loaded = 0;     // New or changed pads, decoded and swapped in
+  size_t unchanged = 0;  // Kept as they were (buffers and pitch variants reused)
+  size_t removed = 0;
+  size_t failed = 0;     // Could not be decoded; the pad keeps its previous sample, if any
+};
+
+// A pad's decoded sample with everything a trigger decides resolved at registration, so
+// triggering is a table lookup. Published through the PadTable and read by triggers
+// without locking (under a ReclaimEpochs pin): nothing changes after publication except
+// the round-robin counters.
+struct PadSound {
+  static constexpr int kVelocityLevels = 128;
+
+  struct Layer {
+    std::vector<std::shared_ptr<const SampleBuffer>> alternates;
+    int first_source;  // Pitch cache source index of alternates[0]
+  };
+
+  // Everything a velocity decides
+  struct VelocityEntry {
+    uint8_t layer;  // Index into layers
+    float gain;     // Sample volume times the velocity curve
+  };
+
+  SampleDefinition definition;  // As registered, for reloads and kit updates
+  std::vector<Layer> layers;
+  std::array<VelocityEntry, kVelocityLevels> velocity_map;
+  std::vector<std::shared_ptr<const SampleBuffer>> sources;  // Every buffer, by pitch cache source index
 
-// Manages multiple audio pipelines, playing samples based on key presses
+  // Updated by triggers (through the const pointer they load)
+  std::unique_ptr<std::atomic<uint32_t>[]> next_alternate;  // Round-robin position per layer
+};
+
+// Render time against each buffer's deadline, and the dropouts it caused
+struct RenderLoad {
+  DeadlineHistogram::Snapshot deadline_ratio;  // Render time over the duration rendered
+  uint64_t overruns = 0;   // Renders slower than real time
+  uint64_t underruns = 0;  // Buffers that reached the device too late (every output opened so far)
+};
+
+// Snapshot of engine health for the control API
+struct EngineStats {
+  size_t active_voices = 0;
+  uint64_t late_renders = 0;  // Renders slower than real time (output underruns)
+  uint64_t dropped_notes = 0;  // Scheduled notes too far ahead, or past the engine's schedule
+  LatencyHistogram::Snapshot render_time;
+  LatencyHistogram::Snapshot trigger_latency;  // Input arrival to render (timestamped triggers)
+  LatencyHistogram::Snapshot midi_latency;     // The same for MIDI notes only
+  LatencyHistogram::Snapshot reverb_time;      // Send reverbs, per buffer
+  LatencyHistogram::Snapshot delay_time;       // Send delays, per buffer
+  RenderLoad load;
+  OutputSettings output;
+  double output_latency_seconds = 0.0;
+  double limiter_latency_seconds = 0.0;  // Master limiter lookahead (constant while the mixer is)
+  size_t pitch_cache_bytes = 0;
+  size_t registered_samples = 0;
+};
+
+// Loads samples into memory and plays them through the engine, one sample per pad
 class AudioProcessor {
  public:
+  // Furthest ahead a note can be scheduled (see playSampleWithPitch)
+  static constexpr std::chrono::seconds kMaxScheduleAhead{10};
+
+  // `pads` is shared with whatever shows or sequences the pads (a private table is used if null).
+  // The processor publishes each pad's sound there and the audio thread stores its levels.
+  explicit AudioProcessor(std::shared_ptr<PadTable> pads = nullptr);
   ~AudioProcessor();
 
-  // Set amplitude callback for visualization
-  void setAmplitudeCallback(AmplitudeUpdateCallback callback);
+  // Register an audio file for a pad (below kMaxPads)
+  // The file is decoded (and sample-rate converted) into memory up front.
+  void registerSample(PadId pad, const std::string& audio_file, const SampleOptions& options = {});
+
+  // Register velocity layers (each with round-robin alternates) for a pad.
+  // Every file is decoded up front; files shared between pads are decoded once.
+  // Re-registering a pad lets its playing voices finish on the old buffers, which are
+  // freed once no voice can still be reading them.
+  void registerSample(PadId pad, const std::vector<SampleLayer>& layers, const SampleOptions& options = {});
+
+  // Decode a pad's files again from disk (e.g. after editing them).
+  // Returns false if the pad is unknown or its files can't be decoded.
+  bool reloadSample(PadId pad);
+
+  // Replace the whole set of samples (e.g. samples.yaml changed). Pads whose definition is
+  // unchanged and whose files are not in `changed_files` are kept as they are. The others
+  // are decoded on the calling thread while the current samples keep playing, then every
+  // pad is swapped in one step, so a trigger sees either the old kit or the new one.
+  // Pads missing from `samples` are removed.
+  SampleUpdateSummary updateSamples(const std::map<PadId, SampleDefinition>& samples,
+                                    const std::set<std::string>& changed_files = {});
+
+  // Use already decoded audio (e.g. views into a mapped kit file) for these paths instead of
+  // decoding them. Only held weakly: the caller keeps them alive until the samples using
+  // them are registered.
+  void provideDecodedFiles(const std::unordered_map<std::string, std::shared_ptr<const SampleBuffer>>& files);
+
+  // Pads with a registered sample
+  std::vector<PadId> registeredPads() const;
+
+  // Interpolation used when reading samples at a different pitch
+  void setResamplerQuality(ResamplerQuality quality);
+
+  // Memory budget for pre-rendered pitch variants (least recently used are evicted)
+  void setPitchCacheBudget(size_t bytes);
+
+  // Route pads through group buses and aux sends into the master bus. The schedule is
+  // compiled here and handed to the audio thread, which switches to it between blocks.
+  void setMixer(const MixerRouting& routing);
 
-  // Register an audio file for a specific key with volume (0.0 to 1.0)
-  void registerSample(char key, const std::string& audio_file, double volume = 1.0);
+  // Tempo the send delays lock to
+  void setTempo(double bpm);
 
-  // Play the sample associated with a key
-  // Returns true if playback was started, false if no sample registered or all pipelines busy
-  bool playSample(char key);
+  // Threads rendering each audio buffer, including the output thread. Call before
+  // setMixer() and start().
+  void setRenderThreads(size_t threads);
 
-  // Play the sample with pitch shift (in semitones)
+  // Schedule the output thread and render workers with `realtime.audio` (each thread applies
+  // it before its first render and records the result for takeThreadSetupReports()) and,
+  // with `realtime.prefault`, touch every sample's audio in as it loads. Call before
+  // setRenderThreads(), registering samples and start().
+  void setRealtime(const RealtimeSettings& realtime);
+
+  // Bytes of sample audio prefaulted so far
+  size_t prefaultedBytes() const { return prefaulted_bytes_.load(std::memory_order_relaxed); }
+
+  // The audio threads' real-time setup recorded since the last call, as describeThreadSetup()
+  // lines. The threads only record it (they must not print); call this from one that may.
+  std::vector<std::string> takeThreadSetupReports();
+
+  // Bytes of sample audio the registered pads hold (files shared between pads counted once)
+  size_t sampleBytes() const;
+
+  size_t renderThreads() const { return engine_.renderThreads(); }
+
+  // Start rendering pitch variants of a pad in the background for one octave of
+  // pitch mode (octave_offset + 0..12 semitones), so those notes play at step 1.0
+  void preparePitchMode(PadId pad, int octave_offset);
+
+  // Open the audio output and start rendering (call after registering samples)
+  bool start();
+
+  // Output rate and buffering. Before start() this only picks the settings (call it before
+  // registering samples so they decode at that rate). With the output open, it is closed
+  // and reopened with the new settings; changing the rate stops every playing note.
+  // Returns false if the output couldn't be reopened.
+  bool setOutput(const OutputSettings& settings);
+  OutputSettings outputSettings() const;
+
+  // Play the sample of a pad
+  // Returns true if playback was started, false if no sample registered or the trigger queue is full
+  bool playSample(PadId pad);
+
+  // Play the sample with pitch shift (in semitones). Lock-free for unpitched notes: an
+  // epoch pin, one pad table load, then the engine's trigger queue.
   // semitones: 0 = original pitch, +12 = octave up, -12 = octave down
-  bool playSampleWithPitch(char key, double semitones);
+  // velocity (1-127) selects the velocity layer and scales the gain
+  // received: when the input arrived, to measure input-to-audio latency (epoch = don't measure)
+  // play_at: when the note should be heard, scheduled to the sample (epoch = immediately).
+  //   Notes more than kMaxScheduleAhead away are dropped (counted in stats()).
+  // input: where the note came from (MIDI notes are also counted in midiLatency())
+  bool playSampleWithPitch(PadId pad, double semitones, int velocity = 127,
+                           std::chrono::steady_clock::time_point received = {},
+                           std::chrono::steady_clock::time_point play_at = {},
+                           TriggerSource input = TriggerSource::Local);
+
+  // Note-off for a pad (and the pitch it was played at): voices with an envelope
+  // fade out over its release time and are freed; samples without one play on
+  bool releaseSample(PadId pad, double semitones = 0.0);
+
+  // Arrival-to-render latency of timestamped MIDI notes (see playSampleWithPitch)
+  LatencyHistogram::Snapshot midiLatency() const;
+
+  // Time from render to the device (0 before start())
+  double outputLatencySeconds() const;
+
+  // Delay the mixer adds between the voices and the output (the master limiter's lookahead)
+  double mixerLatencySeconds() const;
+
+  // Render time over deadline, overruns and underruns (safe from any thread)
+  RenderLoad renderLoad() const;
+
+  // Voice count, render timing and latency histograms (safe from any thread)
+  EngineStats stats() const;
 
  private:
-  // Map of key -> audio file path
-  std::map<char, std::string> sample_map_;
+  // One audio thread's setup result, waiting for takeThreadSetupReports() while `ready`
+  struct ThreadSetupSlot {
+    std::atomic<bool> ready{false};
+    ThreadSetupResult result;
+  };
+
+  // A replaced sound, kept until no trigger, queued note or voice can still be using it
+  struct RetiredSound {
+    std::shared_ptr<PadSound> sound;
+    ReclaimEpochs::Retirement retirement;
+  };
 
-  // Map of key -> audio pipeline
-  std::map<char, std::unique_ptr<AudioPipeline>> pipelines_;
+  // Decoded file from the shared cache, decoding it if no other sound holds it (requires update_mutex_)
+  std::shared_ptr<const SampleBuffer> loadFile(const std::string& path);
 
-  // Amplitude callback for visualization
-  AmplitudeUpdateCallback amplitude_callback_;
+  // Decode a pad's files and resolve its velocity map, without touching the playing
+  // samples (requires update_mutex_). Null if the files can't be decoded.
+  std::shared_ptr<PadSound> prepareSound(PadId pad, const SampleDefinition& definition);
 
+  // Publish a prepared sound, retiring the one it replaces (requires mutex_)
+  void installSoundLocked(PadId pad, std::shared_ptr<PadSound> sound);
+
+  // Unpublish a pad's sound and retire it (requires mutex_)
+  void removeSoundLocked(PadId pad);
+
+  // Free retired sounds the engine's epochs say are unreachable (requires mutex_)
+  void releaseRetiredLocked();
+
+  // Renders a pitch variant the way the sound's pitch mode sounds
+  static PitchVariantCache::Renderer variantRenderer(PitchMode pitch_mode);
+
+  // Queue background renders of whole-semitone variants
+  void prefetchPitches(PadId pad, const PadSound& sound, int lowest, int highest);
+
+  // Audio threads: hand a setup result to takeThreadSetupReports() without blocking (a
+  // newer result is dropped while the last one is still untaken)
+  void recordThreadSetup(size_t thread, const ThreadSetupResult& result);
+
+  // Output thread: mix all voices and store per-pad levels in the pad table
+  void renderAudio(float* output, size_t frames);
+
+  // Published sounds (what triggers read) and their owners, indexed by PadId (guarded by mutex_)
+  std::shared_ptr<PadTable> pads_;
+  std::vector<std::shared_ptr<PadSound>> sounds_;
+  size_t registered_count_;
+
+  // Decoded files by path, shared between pads and layers (expire once no sound uses them).
+  // Guarded by update_mutex_.
+  std::unordered_map<std::string, std::weak_ptr<const SampleBuffer>> decoded_files_;
+
+  std::vector<RetiredSound> retired_;
+
+  AudioEngine engine_;
+
+  // Pre-rendered pitch variants for both pitch modes
+  PitchVariantCache pitch_cache_;
+
+  // Single output pipeline fed by the engine
+  std::unique_ptr<AudioOutput> output_;
+  OutputSettings output_settings_;              // Used whenever output_ is opened
+  std::atomic<double> output_latency_seconds_;  // Of output_, readable without mutex_
+  uint64_t closed_underruns_;                   // Of the outputs closed so far (mutex_)
+
+  // Real-time policy of the audio threads (set before start()), and the output thread it
+  // was last applied to (only touched by the output thread)
+  RealtimeSettings realtime_;
+  std::thread::id realtime_output_thread_;
+  std::array<ThreadSetupSlot, AudioEngine::kMaxRenderThreads> thread_setups_;  // Output thread, then worker N
+  std::atomic<size_t> prefaulted_bytes_;
+  std::atomic<uint64_t> dropped_notes_;         // Scheduled beyond kMaxScheduleAhead
+  MixerRouting routing_;                        // Last setMixer() routing, recompiled on rate changes (update_mutex_)
+
+  // Guards publishing sounds and the output (triggers never take it)
   mutable std::mutex mutex_;
+
+  // Serializes registering and reloading. Held while decoding, so publishing (under mutex_)
+  // never waits for the disk.
+  std::mutex update_mutex_;
 };
 
 }  // namespace mpccli
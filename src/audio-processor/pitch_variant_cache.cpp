@@ -0,0 +1,304 @@
+#include "pitch_variant_cache.h"
+#include <algorithm>
+#include <bit>
+
+namespace mpccli {
+
+namespace {
+
+constexpr size_t kMinTableSlots = 16;
+
+}  // namespace
+
+PitchVariantCache::PitchVariantCache(size_t budget_bytes, ReclaimEpochs& epochs, SourceResolver resolve)
+    : epochs_(epochs),
+      resolve_(std::move(resolve)),
+      budget_bytes_(budget_bytes),
+      used_bytes_(0),
+      retired_bytes_(0),
+      tables_(kMaxPads),
+      tick_(1),
+      generations_(kMaxPads, 0),
+      stopping_(false) {
+  worker_ = std::thread([this]() { workerLoop(); });
+}
+
+PitchVariantCache::~PitchVariantCache() {
+  stop();
+  for (std::atomic<Table*>& table : tables_) {
+    delete table.load(std::memory_order_relaxed);
+  }
+}
+
+void PitchVariantCache::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    jobs_.clear();
+  }
+  jobs_cv_.notify_one();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+uint64_t PitchVariantCache::makeKey(int source, int cents) {
+  return (static_cast<uint64_t>(static_cast<uint16_t>(source)) << 32) | static_cast<uint32_t>(cents);
+}
+
+size_t PitchVariantCache::bufferBytes(const SampleBuffer& buffer) {
+  return buffer.size() * sizeof(float);
+}
+
+const PitchVariantCache::Slot* PitchVariantCache::probe(const Table& table, uint64_t key) {
+  // Fibonacci hashing spreads the (source, cents) keys, which differ only in a few bits
+  for (size_t i = (key * 0x9E3779B97F4A7C15ull) >> 32, probes = 0; probes <= table.mask; ++i, ++probes) {
+    const Slot& slot = table.slots[i & table.mask];
+    const uint64_t found = slot.key.load(std::memory_order_acquire);
+    if (found == key || found == kEmptyKey) {
+      return &slot;
+    }
+  }
+  return nullptr;
+}
+
+const SampleBuffer* PitchVariantCache::find(PadId pad, int source, int cents) const {
+  const Table* table = pad < kMaxPads ? tables_[pad].load(std::memory_order_acquire) : nullptr;
+  if (!table) {
+    return nullptr;
+  }
+  const uint64_t key = makeKey(source, cents);
+  const Slot* slot = probe(*table, key);
+  if (!slot || slot->key.load(std::memory_order_relaxed) != key) {
+    return nullptr;
+  }
+  const SampleBuffer* buffer = slot->buffer.load(std::memory_order_acquire);
+  if (buffer) {
+    const_cast<Slot*>(slot)->last_used.store(tick_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+  return buffer;
+}
+
+void PitchVariantCache::request(PadId pad, int source, int cents) {
+  if (pad < kMaxPads) {
+    requests_.push({pad, source, cents});
+  }
+}
+
+void PitchVariantCache::prefetch(PadId pad, const std::vector<int>& cents,
+                                 const std::vector<std::shared_ptr<const SampleBuffer>>& sources, Renderer renderer) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.clear();
+    for (int c : cents) {
+      for (size_t source = 0; source < sources.size(); ++source) {
+        if (!cachedLocked(pad, makeKey(static_cast<int>(source), c))) {
+          jobs_.push_back({pad, static_cast<int>(source), c, sources[source], renderer, generations_[pad]});
+        }
+      }
+    }
+  }
+  jobs_cv_.notify_one();
+}
+
+void PitchVariantCache::invalidate(PadId pad) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++generations_[pad];
+  jobs_.erase(std::remove_if(jobs_.begin(), jobs_.end(), [pad](const Job& job) { return job.pad == pad; }),
+              jobs_.end());
+
+  auto it = entries_.find(pad);
+  if (it != entries_.end()) {
+    while (!it->second.empty()) {
+      retireEntryLocked(pad, it->second.begin()->first);
+    }
+    entries_.erase(it);
+  }
+  retireTableLocked(pad);
+  releaseRetiredLocked();
+}
+
+void PitchVariantCache::setBudget(size_t budget_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  budget_bytes_ = budget_bytes;
+  releaseRetiredLocked();
+  evictLocked(0);
+}
+
+size_t PitchVariantCache::memoryUsage() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return used_bytes_ + retired_bytes_;
+}
+
+bool PitchVariantCache::cachedLocked(PadId pad, uint64_t key) const {
+  auto it = entries_.find(pad);
+  return it != entries_.end() && it->second.count(key) != 0;
+}
+
+bool PitchVariantCache::insertLocked(PadId pad, uint64_t key, const std::shared_ptr<const SampleBuffer>& buffer) {
+  // Another job may have rendered the same variant meanwhile
+  if (cachedLocked(pad, key)) {
+    return true;
+  }
+  const size_t bytes = bufferBytes(*buffer);
+  releaseRetiredLocked();
+  evictLocked(bytes);
+  if (used_bytes_ + retired_bytes_ + bytes > budget_bytes_) {
+    return false;
+  }
+
+  // A table stays at most half full (evicted keys included), so probes stay short and
+  // always end at an empty slot; past that the live variants move to a bigger one
+  Table* table = tables_[pad].load(std::memory_order_relaxed);
+  auto& entries = entries_[pad];
+  if (!table || (table->keys + 1) * 2 > table->mask + 1) {
+    auto replacement = std::make_unique<Table>(std::bit_ceil(std::max(kMinTableSlots, (entries.size() + 1) * 4)));
+    for (const auto& [entry_key, entry_buffer] : entries) {
+      Slot& slot = const_cast<Slot&>(*probe(*replacement, entry_key));
+      slot.buffer.store(entry_buffer.get(), std::memory_order_relaxed);
+      slot.last_used.store(table ? probe(*table, entry_key)->last_used.load(std::memory_order_relaxed) : 0,
+                           std::memory_order_relaxed);
+      slot.key.store(entry_key, std::memory_order_relaxed);
+      ++replacement->keys;
+    }
+    retireTableLocked(pad);
+    table = replacement.release();
+    tables_[pad].store(table, std::memory_order_release);
+  }
+
+  // Fill the slot before publishing its key (an evicted key's slot is reused as it is)
+  Slot& slot = const_cast<Slot&>(*probe(*table, key));
+  slot.last_used.store(tick_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  slot.buffer.store(buffer.get(), std::memory_order_release);
+  if (slot.key.load(std::memory_order_relaxed) != key) {
+    slot.key.store(key, std::memory_order_release);
+    ++table->keys;
+  }
+  used_bytes_ += bytes;
+  entries[key] = buffer;
+  return true;
+}
+
+void PitchVariantCache::retireEntryLocked(PadId pad, uint64_t key) {
+  auto& entries = entries_[pad];
+  auto it = entries.find(key);
+  std::shared_ptr<const SampleBuffer> buffer = std::move(it->second);
+  entries.erase(it);
+
+  // Unpublish before retiring: triggers pinned after this can no longer find it
+  if (Table* table = tables_[pad].load(std::memory_order_relaxed)) {
+    const_cast<Slot*>(probe(*table, key))->buffer.store(nullptr, std::memory_order_seq_cst);
+  }
+  const size_t bytes = bufferBytes(*buffer);
+  used_bytes_ -= bytes;
+  retired_bytes_ += bytes;
+  retired_.push_back({std::move(buffer), nullptr, epochs_.retire(), bytes});
+}
+
+void PitchVariantCache::retireTableLocked(PadId pad) {
+  if (Table* table = tables_[pad].exchange(nullptr, std::memory_order_seq_cst)) {
+    retired_.push_back({nullptr, std::unique_ptr<Table>(table), epochs_.retire(), 0});
+  }
+}
+
+void PitchVariantCache::evictLocked(size_t incoming_bytes) {
+  // Retired buffers take memory until the epochs let them go, so they count too
+  const size_t reserved = retired_bytes_ + incoming_bytes;
+  const size_t live_budget = budget_bytes_ > reserved ? budget_bytes_ - reserved : 0;
+  if (used_bytes_ <= live_budget) {
+    return;
+  }
+
+  // Least recently found first
+  struct Candidate {
+    uint64_t last_used;
+    PadId pad;
+    uint64_t key;
+  };
+  std::vector<Candidate> candidates;
+  for (const auto& [pad, entries] : entries_) {
+    const Table* table = tables_[pad].load(std::memory_order_relaxed);
+    for (const auto& entry : entries) {
+      candidates.push_back({probe(*table, entry.first)->last_used.load(std::memory_order_relaxed), pad, entry.first});
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate& a, const Candidate& b) { return a.last_used < b.last_used; });
+  for (const Candidate& candidate : candidates) {
+    if (used_bytes_ <= live_budget) {
+      break;
+    }
+    retireEntryLocked(candidate.pad, candidate.key);
+  }
+}
+
+void PitchVariantCache::releaseRetiredLocked() {
+  retired_.erase(std::remove_if(retired_.begin(), retired_.end(),
+                                [this](Retired& r) {
+                                  if (!epochs_.reclaimable(r.retirement)) {
+                                    return false;
+                                  }
+                                  retired_bytes_ -= r.bytes;
+                                  return true;
+                                }),
+                 retired_.end());
+}
+
+void PitchVariantCache::workerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  Job job;
+  std::shared_ptr<const SampleBuffer> rendered;  // Waiting for evicted variants to be freed
+  while (true) {
+    // Requests come without a wakeup (triggers don't touch the lock), hence the timeout
+    jobs_cv_.wait_for(lock, kPollInterval, [&] { return stopping_ || (!rendered && !jobs_.empty()); });
+    if (stopping_) {
+      return;
+    }
+    tick_.fetch_add(1, std::memory_order_relaxed);
+    releaseRetiredLocked();
+
+    // Evicting only retires, so a full cache takes a few renders to make room. Nothing
+    // else is rendered meanwhile; a variant bigger than the whole budget is dropped.
+    if (rendered) {
+      if (job.generation != generations_[job.pad] ||
+          insertLocked(job.pad, makeKey(job.source, job.cents), rendered) || retired_.empty()) {
+        rendered.reset();
+      }
+      continue;
+    }
+
+    // A note waiting on a variant goes before prefetches
+    bool found = false;
+    Request request;
+    while (!found && requests_.pop(request)) {
+      if (!cachedLocked(request.pad, makeKey(request.source, request.cents))) {
+        job = {request.pad, request.source, request.cents, nullptr, nullptr, generations_[request.pad]};
+        found = true;
+      }
+    }
+    while (!found && !jobs_.empty()) {
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+      found = !cachedLocked(job.pad, makeKey(job.source, job.cents));
+    }
+    if (!found) {
+      continue;
+    }
+
+    lock.unlock();
+    if (job.original || resolve_(job.pad, job.source, job.original, job.renderer)) {
+      rendered = std::make_shared<const SampleBuffer>(job.renderer(*job.original, job.cents / 100.0));
+    }
+    // The original may be a replaced sample's: let it go now rather than with the next job
+    job.original.reset();
+    job.renderer = nullptr;
+    lock.lock();
+
+    if (rendered && (stopping_ || job.generation != generations_[job.pad] ||
+                     insertLocked(job.pad, makeKey(job.source, job.cents), rendered))) {
+      rendered.reset();
+    }
+  }
+}
+
+}  // namespace mpccli
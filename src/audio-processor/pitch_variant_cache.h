@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../dsp/sample_buffer.h"
+#include "../engine/lockfree_queue.h"
+#include "../engine/reclaim_epochs.h"
+#include "../kit/pad.h"
+
+namespace mpccli {
+
+// Cache of pre-rendered pitch variants (one buffer per source file and pitch), so a pitched
+// note can be played at step 1.0 and costs the same as an unpitched one.
+//
+// Variants are rendered on a background thread, either ahead of time (prefetch) or when a
+// note first asks for one (request), and evicted least-recently-used once the memory
+// budget is exceeded. Each pad's variants are published in a table of atomic slots, so
+// find() and request() are lock-free and never allocate: a trigger reads the table under
+// its ReclaimEpochs::Pin and hands misses to the worker through a lock-free queue. Engine
+// voices read variants through raw pointers, so evicted buffers (and replaced tables) are
+// retired rather than freed: they are released once the engine's epochs say no trigger,
+// scheduled note or voice that could have found them is left.
+class PitchVariantCache {
+ public:
+  // Renders `original` shifted by `semitones`
+  using Renderer = std::function<SampleBuffer(const SampleBuffer& original, double semitones)>;
+
+  // Current original and renderer of a pad's source, for request()ed variants. False if the
+  // pad has no such source any more. Called on the worker thread without the cache's lock.
+  using SourceResolver = std::function<bool(PadId pad, int source, std::shared_ptr<const SampleBuffer>& original,
+                                            Renderer& renderer)>;
+
+  // Most misses waiting for the worker (more are dropped; a later note asks again)
+  static constexpr size_t kMaxRequests = 256;
+
+  // `epochs` (the engine's) must outlive the cache
+  PitchVariantCache(size_t budget_bytes, ReclaimEpochs& epochs, SourceResolver resolve);
+  ~PitchVariantCache();
+
+  PitchVariantCache(const PitchVariantCache&) = delete;
+  PitchVariantCache& operator=(const PitchVariantCache&) = delete;
+
+  // Stop the worker, before whatever the resolver reads goes away (the destructor also does)
+  void stop();
+
+  // Ready variant for a pad's source buffer (layer/alternate index) and pitch (in cents),
+  // or nullptr if it hasn't been rendered. Marks the variant as recently used. Lock-free;
+  // call under a ReclaimEpochs::Pin held for as long as the result is used.
+  const SampleBuffer* find(PadId pad, int source, int cents) const;
+
+  // Ask for a variant find() missed to be rendered, ahead of prefetched ones (a note is
+  // waiting for it). Lock-free: the worker picks it up within kPollInterval and skips it
+  // if it has been rendered meanwhile.
+  void request(PadId pad, int source, int cents);
+
+  // Render variants of every source of a pad in the background, lowest pitch first.
+  // `sources[i]` is the original for source index i. Replaces any pending prefetches
+  // (only the most recent pitch-mode sample is worth preparing).
+  void prefetch(PadId pad, const std::vector<int>& cents,
+                const std::vector<std::shared_ptr<const SampleBuffer>>& sources, Renderer renderer);
+
+  // Drop every variant of a pad (call after its sample was replaced), and discard renders
+  // of it that are queued or in progress. Other pads' renders are unaffected.
+  void invalidate(PadId pad);
+
+  void setBudget(size_t budget_bytes);
+
+  // Bytes of cached variants, plus evicted ones not yet freed (both count against the budget)
+  size_t memoryUsage() const;
+
+ private:
+  // How often the worker looks for requests and frees retired buffers when otherwise idle
+  static constexpr std::chrono::milliseconds kPollInterval{5};
+
+  // A published variant. `key` is written once; `buffer` is cleared when it is evicted.
+  struct Slot {
+    std::atomic<uint64_t> key{kEmptyKey};
+    std::atomic<const SampleBuffer*> buffer{nullptr};
+    std::atomic<uint64_t> last_used{0};  // tick_ when last found (approximate LRU)
+  };
+
+  // A pad's open-addressed slots (linear probing, at most half full). Replaced rather than
+  // grown, so readers never see it change size.
+  struct Table {
+    explicit Table(size_t capacity) : mask(capacity - 1), keys(0), slots(new Slot[capacity]) {}
+
+    size_t mask;
+    size_t keys;  // Slots with a key, including evicted ones (worker side only)
+    std::unique_ptr<Slot[]> slots;
+  };
+
+  // An evicted variant or a replaced table (one of the two is set)
+  struct Retired {
+    std::shared_ptr<const SampleBuffer> buffer;
+    std::unique_ptr<Table> table;
+    ReclaimEpochs::Retirement retirement;
+    size_t bytes;
+  };
+
+  struct Job {
+    PadId pad;
+    int source;
+    int cents;
+    std::shared_ptr<const SampleBuffer> original;  // Resolved by the worker for requests
+    Renderer renderer;
+    uint64_t generation;  // Of the pad; results from before an invalidate() of it are discarded
+  };
+
+  struct Request {
+    PadId pad = kNoPad;
+    int source = 0;
+    int cents = 0;
+  };
+
+  static constexpr uint64_t kEmptyKey = UINT64_MAX;
+
+  static uint64_t makeKey(int source, int cents);
+  static size_t bufferBytes(const SampleBuffer& buffer);
+  static const Slot* probe(const Table& table, uint64_t key);
+
+  // All of the following require mutex_ to be held
+  bool cachedLocked(PadId pad, uint64_t key) const;
+  // False if it doesn't fit until evicted variants are freed
+  bool insertLocked(PadId pad, uint64_t key, const std::shared_ptr<const SampleBuffer>& buffer);
+  void retireEntryLocked(PadId pad, uint64_t key);
+  void retireTableLocked(PadId pad);
+  void evictLocked(size_t incoming_bytes);
+  void releaseRetiredLocked();
+
+  void workerLoop();
+
+  ReclaimEpochs& epochs_;
+  SourceResolver resolve_;
+  size_t budget_bytes_;
+  size_t used_bytes_;
+  size_t retired_bytes_;
+
+  // Published tables by pad (nullptr = no variants), owned by the cache
+  std::vector<std::atomic<Table*>> tables_;
+  std::atomic<uint64_t> tick_;  // Advanced by the worker; what find() stamps slots with
+
+  // What the tables point into, by pad and key
+  std::unordered_map<PadId, std::unordered_map<uint64_t, std::shared_ptr<const SampleBuffer>>> entries_;
+  std::vector<Retired> retired_;
+
+  LockFreeQueue<Request, kMaxRequests> requests_;
+  std::deque<Job> jobs_;               // Prefetches
+  std::vector<uint64_t> generations_;  // Per pad, bumped by invalidate()
+  bool stopping_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable jobs_cv_;
+  std::thread worker_;
+};
+
+}  // namespace mpccli
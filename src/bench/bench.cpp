@@ -0,0 +1,528 @@
+#include "bench.h"
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "../audio-processor/audio_processor.h"
+#include "../config/kit_config.h"
+#include "../dsp/channel_effects.h"
+#include "../dsp/limiter.h"
+#include "../dsp/resampler.h"
+#include "../dsp/sample_buffer.h"
+#include "../engine/audio_engine.h"
+#include "../kit/kit_file.h"
+#include "../kit/pad_table.h"
+
+namespace mpccli {
+
+namespace {
+
+constexpr size_t kBenchBlockFrames = 256;
+
+// Stereo white noise at the engine rate
+SampleBuffer makeNoise(double seconds) {
+  SampleBuffer buffer;
+  buffer.samples.resize(static_cast<size_t>(seconds * buffer.sample_rate) * buffer.channels);
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+  for (float& s : buffer.samples) {
+    s = dist(rng);
+  }
+  return buffer;
+}
+
+// Voices-per-core for each resampler quality: how many pitched voices one core
+// can render in real time at a 256-frame block size
+int benchResampler() {
+  const Resampler& resampler = defaultResampler();
+  SampleBuffer source = makeNoise(2.0);
+  std::vector<float> output(kBenchBlockFrames * source.channels);
+  const double step = std::pow(2.0, 7.0 / 12.0);  // A fifth up: every frame interpolates
+  const double block_seconds = kBenchBlockFrames / source.sample_rate;
+
+  std::printf("Resampler: %zu-frame blocks at %.0f Hz, step %.4f\n", kBenchBlockFrames, source.sample_rate, step);
+  std::printf("%-8s %14s %16s\n", "quality", "ns/voice-block", "voices-per-core");
+
+  for (ResamplerQuality quality : {ResamplerQuality::Linear, ResamplerQuality::Cubic, ResamplerQuality::Sinc}) {
+    size_t blocks = 0;
+    double position = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed{};
+    // Run for at least half a second of wall time
+    while (elapsed.count() < 0.5) {
+      for (int i = 0; i < 100; ++i) {
+        position = resampler.process(quality, source, position, step, 0.5f, output.data(), kBenchBlockFrames);
+        if (position >= source.frames()) {
+          position = 0.0;
+        }
+      }
+      blocks += 100;
+      elapsed = std::chrono::steady_clock::now() - start;
+    }
+
+    const double seconds_per_block = elapsed.count() / blocks;
+    std::printf("%-8s %14.0f %16.0f\n", resamplerQualityName(quality), seconds_per_block * 1e9,
+                block_seconds / seconds_per_block);
+  }
+
+  // Keep the output observable so the loop can't be optimised away
+  return output[0] == 12345.0f ? 1 : 0;
+}
+
+// Median wall time of `runs` calls, in milliseconds
+double medianMilliseconds(int runs, const std::function<void()>& body) {
+  std::vector<double> times;
+  for (int i = 0; i < runs; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+  }
+  std::sort(times.begin(), times.end());
+  return times[times.size() / 2];
+}
+
+// Startup cost of a 500-sample kit: samples.yaml against a compiled kit file.
+// The YAML path is measured as parse + stat + reading raw PCM, a lower bound for the real
+// startup, which also decodes and resamples every file with GStreamer.
+int benchKit() {
+  constexpr int kPads = 50;
+  constexpr int kLayers = 10;  // Velocity layers per pad: 500 files in all
+  constexpr double kSampleSeconds = 0.1;
+  constexpr int kRuns = 5;
+  const std::string keys = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+  namespace fs = std::filesystem;
+  const fs::path dir = fs::temp_directory_path() / ("mpc-cli-bench-kit-" + std::to_string(getpid()));
+  fs::create_directories(dir);
+  const std::string yaml_path = (dir / "samples.yaml").string();
+  const std::string kit_path = (dir / "samples.kit").string();
+
+  // Synthetic kit: every file holds the same noise, stored as raw engine-format PCM
+  auto noise = std::make_shared<const SampleBuffer>(makeNoise(kSampleSeconds));
+  DecodedFiles files;
+  {
+    std::ofstream yaml(yaml_path);
+    yaml << "samples:\n";
+    for (int pad = 0; pad < kPads; ++pad) {
+      yaml << "  pad" << pad << ":\n    key: \"" << keys[pad] << "\"\n    layers:\n";
+      for (int layer = 0; layer < kLayers; ++layer) {
+        const std::string path = (dir / ("pad" + std::to_string(pad) + "_" + std::to_string(layer) + ".pcm")).string();
+        std::ofstream(path, std::ios::binary)
+            .write(reinterpret_cast<const char*>(noise->data()), static_cast<std::streamsize>(noise->size() * sizeof(float)));
+        files[path] = noise;
+        const int low = layer * 128 / kLayers;
+        const int high = (layer + 1) * 128 / kLayers - 1;
+        yaml << "      - path: " << path << "\n        velocity: [" << low << ", " << high << "]\n";
+      }
+    }
+  }
+  if (!writeKitFile(kit_path, loadSamplesFromYaml(yaml_path), {}, {}, {}, files)) {
+    return 1;
+  }
+
+  size_t loaded_files = 0;
+  const double yaml_ms = medianMilliseconds(kRuns, [&]() {
+    KitLayout layout = loadSamplesFromYaml(yaml_path);
+    std::vector<SampleBuffer> buffers;
+    for (const auto& [pad, spec] : layout.pads) {
+      for (const SampleLayer& layer : spec.layers) {
+        for (const std::string& path : layer.files) {
+          if (!fs::exists(path)) {
+            continue;
+          }
+          SampleBuffer buffer;
+          buffer.samples.resize(fs::file_size(path) / sizeof(float));
+          std::ifstream(path, std::ios::binary)
+              .read(reinterpret_cast<char*>(buffer.samples.data()), static_cast<std::streamsize>(buffer.samples.size() * sizeof(float)));
+          buffers.push_back(std::move(buffer));
+        }
+      }
+    }
+    loaded_files = buffers.size();
+  });
+
+  size_t mapped_files = 0;
+  const double kit_ms = medianMilliseconds(kRuns, [&]() {
+    LoadedKit kit = loadKitFile(kit_path);
+    mapped_files = kit.files.size();
+  });
+
+  std::printf("Kit startup: %d pads x %d layers, %.1f s stereo files, median of %d runs (warm page cache)\n", kPads,
+              kLayers, kSampleSeconds, kRuns);
+  std::printf("%-34s %8s %10s\n", "source", "files", "ms");
+  std::printf("%-34s %8zu %10.2f\n", "samples.yaml (parse+stat+read)", loaded_files, yaml_ms);
+  std::printf("%-34s %8zu %10.2f\n", "kit file (map+index)", mapped_files, kit_ms);
+  std::printf("speedup: %.0fx (before decoding, which the kit also skips)\n", yaml_ms / std::max(kit_ms, 1e-6));
+
+  fs::remove_all(dir);
+  return loaded_files == mapped_files ? 0 : 1;
+}
+
+// Trigger-path bookkeeping, the previous layout against the pad table. Both sides do what
+// a trigger does before it reaches the engine queue (find the pad, advance its round-robin
+// alternate, read its gain) and what the audio thread does per sounding pad to meter it.
+// Before: per-pad slots behind the processor mutex; levels pushed through a callback into
+// the visualizer's mutex-guarded map. After: one load from the cache-line-aligned pad
+// table; levels stored straight into it.
+namespace trigger_bench {
+
+constexpr int kPads = 64;
+constexpr int kAlternates = 4;
+
+struct LockedSlot {
+  size_t next_alternate = 0;
+  float gain = 1.0f;
+};
+
+struct LockedPads {
+  std::mutex mutex;
+  std::vector<std::optional<LockedSlot>> slots;
+  std::mutex meter_mutex;
+  std::map<PadId, float> levels;
+};
+
+float triggerLocked(LockedPads& pads, PadId pad) {
+  std::lock_guard<std::mutex> lock(pads.mutex);
+  if (pad >= pads.slots.size() || !pads.slots[pad]) {
+    return 0.0f;
+  }
+  LockedSlot& slot = *pads.slots[pad];
+  const size_t alternate = slot.next_alternate;
+  slot.next_alternate = alternate + 1 < kAlternates ? alternate + 1 : 0;
+  return slot.gain + static_cast<float>(alternate);
+}
+
+void meterLocked(LockedPads& pads, PadId pad, float level) {
+  std::lock_guard<std::mutex> lock(pads.meter_mutex);
+  auto it = pads.levels.find(pad);
+  if (it != pads.levels.end()) {
+    it->second = level;
+  }
+}
+
+// As AudioProcessor::playSampleWithPitch does it
+float triggerTable(ReclaimEpochs& epochs, const PadTable& table, PadId pad, int velocity) {
+  const ReclaimEpochs::Pin pin = epochs.pin();
+  const PadSound* sound = table[pad].sound.load(std::memory_order_acquire);
+  if (!sound) {
+    return 0.0f;
+  }
+  const PadSound::VelocityEntry& entry = sound->velocity_map[velocity];
+  const PadSound::Layer& layer = sound->layers[entry.layer];
+  const size_t alternate =
+      sound->next_alternate[entry.layer].fetch_add(1, std::memory_order_relaxed) % layer.alternates.size();
+  return entry.gain + static_cast<float>(alternate);
+}
+
+void meterTable(PadTable& table, PadId pad, float level) {
+  table[pad].level.store(level, std::memory_order_relaxed);
+}
+
+// Nanoseconds per call of `body(thread, i)` with `threads` threads calling it concurrently
+double nsPerCall(int threads, const std::function<float(int, size_t)>& body) {
+  constexpr size_t kCalls = 2000000;
+  std::atomic<bool> go(false);
+  std::vector<std::thread> workers;
+  std::vector<float> sinks(threads);
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t]() {
+      while (!go.load()) {
+      }
+      float sink = 0.0f;
+      for (size_t i = 0; i < kCalls; ++i) {
+        sink += body(t, i);
+      }
+      sinks[t] = sink;
+    });
+  }
+  const auto start = std::chrono::steady_clock::now();
+  go = true;
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  const double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  return elapsed / kCalls;  // Per call on each thread: what one caller waits
+}
+
+}  // namespace trigger_bench
+
+int benchTrigger() {
+  using namespace trigger_bench;
+
+  LockedPads locked;
+  locked.slots.resize(kPads);
+  PadTable table;
+  ReclaimEpochs epochs;
+  std::vector<PadSound> sounds(kPads);
+  for (int pad = 0; pad < kPads; ++pad) {
+    locked.slots[pad].emplace();
+    locked.levels[static_cast<PadId>(pad)] = 0.0f;
+
+    PadSound& sound = sounds[pad];
+    sound.layers.resize(1);
+    sound.layers[0].alternates.resize(kAlternates);
+    sound.velocity_map.fill({0, 1.0f});
+    sound.next_alternate = std::make_unique<std::atomic<uint32_t>[]>(1);
+    table[static_cast<PadId>(pad)].sound.store(&sound);
+  }
+
+  // Each thread plays its own run of pads, as separate inputs (keys, MIDI, OSC, sequencer) do
+  auto pad_for = [](int thread, size_t i) { return static_cast<PadId>((thread * 16 + i % 16) % kPads); };
+
+  std::printf("Trigger path: %d pads, ns per call on each thread (before: mutex + slot vector + meter map;\n"
+              "after: pad table)\n", kPads);
+  std::printf("%-22s %8s %10s %10s %8s\n", "operation", "threads", "before", "after", "speedup");
+  for (int threads : {1, 4}) {
+    const double before = nsPerCall(threads, [&](int t, size_t i) { return triggerLocked(locked, pad_for(t, i)); });
+    const double after = nsPerCall(threads, [&](int t, size_t i) { return triggerTable(epochs, table, pad_for(t, i), 100); });
+    std::printf("%-22s %8d %10.1f %10.1f %7.1fx\n", "trigger", threads, before, after, before / after);
+  }
+
+  // Metering: the audio thread stores levels while the visualizer reads (and decays) them
+  for (int threads : {1, 2}) {
+    const double before = nsPerCall(threads, [&](int t, size_t i) {
+      const PadId pad = static_cast<PadId>(i % kPads);
+      if (t == 0) {
+        meterLocked(locked, pad, 0.5f);
+        return 0.0f;
+      }
+      std::lock_guard<std::mutex> lock(locked.meter_mutex);
+      float& level = locked.levels[pad];
+      level *= 0.95f;
+      return level;
+    });
+    const double after = nsPerCall(threads, [&](int t, size_t i) {
+      const PadId pad = static_cast<PadId>(i % kPads);
+      if (t == 0) {
+        meterTable(table, pad, 0.5f);
+        return 0.0f;
+      }
+      std::atomic<float>& level = table[pad].level;
+      float value = level.load(std::memory_order_relaxed);
+      level.compare_exchange_strong(value, value * 0.95f, std::memory_order_relaxed);
+      return value;
+    });
+    std::printf("%-22s %8d %10.1f %10.1f %7.1fx\n", threads == 1 ? "meter" : "meter (+ visualizer)", threads,
+                before, after, before / after);
+  }
+
+  // Clear the table's pointers into `sounds` before they go out of scope
+  for (int pad = 0; pad < kPads; ++pad) {
+    table[static_cast<PadId>(pad)].sound.store(nullptr);
+  }
+  return 0;
+}
+
+// Cost of the channel insert effects on a 64-frame stereo block, and how many channels
+// one core could run them on in real time
+int benchEffects() {
+  constexpr size_t kBlockFrames = 64;
+  const SampleBuffer source = makeNoise(1.0);
+  std::vector<float> block(kBlockFrames * source.channels);
+  const double block_seconds = kBlockFrames / source.sample_rate;
+
+  ChannelEffectParams filter;
+  filter.filter.type = FilterType::LowPass;
+  filter.filter.cutoff_hz = 2000.0f;
+  filter.filter.resonance = 2.0f;
+  ChannelEffectParams compressor;
+  compressor.compressor.enabled = true;
+  compressor.compressor.threshold_db = -18.0f;
+  ChannelEffectParams saturator;
+  saturator.saturator.enabled = true;
+  ChannelEffectParams all{filter.filter, compressor.compressor, saturator.saturator};
+
+  std::printf("Channel effects: %zu-frame stereo blocks at %.0f Hz\n", kBlockFrames, source.sample_rate);
+  std::printf("%-12s %14s %18s\n", "effect", "ns/block", "channels-per-core");
+  const std::pair<const char*, ChannelEffectParams> cases[] = {
+      {"filter", filter}, {"compressor", compressor}, {"saturator", saturator}, {"all three", all}};
+  for (const auto& [name, params] : cases) {
+    ChannelEffects effects(params, source.sample_rate, source.channels);
+    size_t blocks = 0;
+    size_t offset = 0;
+    const auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed{};
+    while (elapsed.count() < 0.5) {
+      for (int i = 0; i < 1000; ++i) {
+        std::copy_n(source.samples.data() + offset, block.size(), block.data());
+        offset = (offset + block.size()) % (source.samples.size() - block.size());
+        effects.process(block.data(), kBlockFrames);
+      }
+      blocks += 1000;
+      elapsed = std::chrono::steady_clock::now() - start;
+    }
+    const double seconds_per_block = elapsed.count() / blocks;
+    std::printf("%-12s %14.0f %18.0f\n", name, seconds_per_block * 1e9, block_seconds / seconds_per_block);
+  }
+  return block[0] == 12345.0f ? 1 : 0;
+}
+
+// Cost of the master limiter on a 64-frame stereo block for a short and a long lookahead
+// (the sliding maximum keeps it flat), on audio under the ceiling and audio it limits
+int benchLimiter() {
+  constexpr size_t kBlockFrames = 64;
+  const SampleBuffer source = makeNoise(1.0);
+  std::vector<float> block(kBlockFrames * source.channels);
+
+  std::printf("Master limiter: %zu-frame stereo blocks at %.0f Hz\n", kBlockFrames, source.sample_rate);
+  std::printf("%-10s %-10s %14s %16s\n", "lookahead", "input", "ns/block", "latency frames");
+  for (float lookahead_ms : {1.5f, 5.0f, 20.0f}) {
+    for (float gain : {0.25f, 4.0f}) {
+      LimiterParams params;
+      params.lookahead_ms = lookahead_ms;
+      TruePeakLimiter limiter(params, source.sample_rate, source.channels);
+      size_t blocks = 0;
+      size_t offset = 0;
+      const auto start = std::chrono::steady_clock::now();
+      std::chrono::duration<double> elapsed{};
+      while (elapsed.count() < 0.5) {
+        for (int i = 0; i < 1000; ++i) {
+          for (size_t s = 0; s < block.size(); ++s) {
+            block[s] = source.samples[offset + s] * gain;
+          }
+          offset = (offset + block.size()) % (source.samples.size() - block.size());
+          limiter.process(block.data(), kBlockFrames);
+        }
+        blocks += 1000;
+        elapsed = std::chrono::steady_clock::now() - start;
+      }
+      std::printf("%7.1f ms %-10s %14.0f %16zu\n", lookahead_ms, gain < 1.0f ? "quiet" : "limited",
+                  elapsed.count() / blocks * 1e9, limiter.latencyFrames());
+    }
+  }
+  return block[0] == 12345.0f ? 1 : 0;
+}
+
+// Scaling of the block render over render threads: a dense kit (every voice busy, pitched,
+// through group buses and aux sends) rendered in 64-frame blocks
+int benchRender() {
+  constexpr size_t kBlockFrames = 64;
+  constexpr int kPads = 32;
+  constexpr int kGroups = 8;
+  constexpr int kBlocks = 3000;
+  const SampleBuffer source = makeNoise(4.0);
+
+  MixerRouting routing;
+  auto add_bus = [&routing](std::string name, float gain, SendEffectType effect) {
+    MixerRouting::Bus& bus = routing.buses.emplace_back();
+    bus.name = std::move(name);
+    bus.gain = gain;
+    bus.effect.type = effect;
+  };
+  for (int group = 0; group < kGroups; ++group) {
+    add_bus("group " + std::to_string(group), 0.8f, SendEffectType::None);
+  }
+  add_bus("reverb", 0.3f, SendEffectType::Reverb);
+  add_bus("delay", 0.3f, SendEffectType::Delay);
+  for (int pad = 0; pad < kPads; ++pad) {
+    MixerRouting::Channel& channel = routing.channels.emplace_back();
+    channel.pad = static_cast<PadId>(pad);
+    channel.output = pad % kGroups;
+    channel.sends = {{kGroups, 0.2f}, {kGroups + 1, 0.1f}};
+  }
+
+  const size_t max_threads = std::clamp<size_t>(std::thread::hardware_concurrency(), 4, AudioEngine::kMaxRenderThreads);
+  const double deadline_us = kBlockFrames / kEngineSampleRate * 1e6;
+  std::printf("Render: %zu voices on %d pads (sinc, pitched), %d groups, reverb and delay sends, %zu-frame blocks "
+              "(%.0f us of audio); %u cores\n",
+              AudioEngine::kMaxVoices, kPads, kGroups, kBlockFrames, deadline_us, std::thread::hardware_concurrency());
+  std::printf("%8s %12s %12s %10s %8s\n", "threads", "us/block", "p99 us", "of block", "speedup");
+
+  std::vector<float> output(kBlockFrames * kEngineChannels);
+  double single_thread = 0.0;
+  for (size_t threads = 1; threads <= max_threads; ++threads) {
+    AudioEngine engine;
+    engine.setRenderThreads(threads);
+    engine.setResamplerQuality(ResamplerQuality::Sinc);
+    engine.setMixer(std::make_unique<MixerGraph>(routing, engine.sampleRate(), engine.channels(),
+                                                 AudioEngine::kMaxBlockFrames, threads));
+
+    // Keep every voice busy: retrigger the whole kit well before the samples run out
+    auto trigger_all = [&]() {
+      for (size_t voice = 0; voice < AudioEngine::kMaxVoices; ++voice) {
+        TriggerEvent event{};
+        event.pad = static_cast<PadId>(voice % kPads);
+        event.buffer = &source;
+        event.step = std::pow(2.0, static_cast<double>(voice % 12) / 12.0);
+        event.gain = 0.1f;
+        engine.trigger(event);
+      }
+    };
+
+    std::vector<double> times;
+    times.reserve(kBlocks);
+    for (int block = 0; block < kBlocks; ++block) {
+      if (block % 1000 == 0) {
+        trigger_all();
+      }
+      const auto start = std::chrono::steady_clock::now();
+      engine.render(output.data(), kBlockFrames);
+      times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    const double median = times[times.size() / 2];
+    const double p99 = times[times.size() * 99 / 100];
+    if (threads == 1) {
+      single_thread = median;
+    }
+    std::printf("%8zu %12.1f %12.1f %9.0f%% %7.2fx\n", threads, median, p99, median / deadline_us * 100.0,
+                single_thread / median);
+  }
+  return output[0] == 12345.0f ? 1 : 0;
+}
+
+struct Benchmark {
+  const char* name;
+  const char* description;
+  std::function<int()> run;
+};
+
+const std::vector<Benchmark>& benchmarks() {
+  static const std::vector<Benchmark> list = {
+      {"resampler", "voices-per-core for each resampler quality", benchResampler},
+      {"kit", "startup time of a 500-sample kit: samples.yaml vs compiled kit file", benchKit},
+      {"trigger", "trigger and metering cost: mutex-guarded slots vs the pad table, 1-4 threads", benchTrigger},
+      {"effects", "cost of the channel filter, compressor and saturator per 64-frame block", benchEffects},
+      {"limiter", "master limiter cost per 64-frame block over its lookahead length", benchLimiter},
+      {"render", "block render time of a dense kit over 1-N render threads", benchRender},
+  };
+  return list;
+}
+
+}  // namespace
+
+int runBenchmark(const std::string& name) {
+  for (const Benchmark& bench : benchmarks()) {
+    if (name == bench.name || name == "all") {
+      int result = bench.run();
+      if (result != 0 || name != "all") {
+        return result;
+      }
+    }
+  }
+  if (name == "all") {
+    return 0;
+  }
+
+  std::cerr << "Usage: mpc-cli bench <name>" << std::endl;
+  std::cerr << "Available benchmarks:" << std::endl;
+  std::cerr << "  all" << std::endl;
+  for (const Benchmark& bench : benchmarks()) {
+    std::cerr << "  " << bench.name << " - " << bench.description << std::endl;
+  }
+  return 1;
+}
+
+}  // namespace mpccli
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+
+namespace mpccli {
+
+// Built-in micro-benchmarks, run with `mpc-cli bench <name>`.
+// They use synthetic audio only, so they need neither sample files nor a sound card.
+// Returns a process exit code (prints the available names for an unknown one).
+int runBenchmark(const std::string& name);
+
+}  // namespace mpccli
@@ -0,0 +1,83 @@
+#include "clock.h"
+
+namespace mpccli {
+
+namespace {
+
+// How often a ManualClock wait checks whether the clock was moved
+constexpr std::chrono::milliseconds kManualPollInterval(1);
+
+}  // namespace
+
+bool Clock::waitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, ClockTime timeout,
+                    const std::function<bool()>& woken) const {
+  const ClockTime deadline = now() + timeout;
+  while (!woken()) {
+    const ClockTime remaining = deadline - now();
+    if (remaining <= ClockTime::zero()) {
+      return false;
+    }
+    cv.wait_for(lock, remaining);
+  }
+  return true;
+}
+
+SteadyClock::SteadyClock()
+    : epoch_(std::chrono::steady_clock::now()) {
+}
+
+ClockTime SteadyClock::now() const {
+  return std::chrono::steady_clock::now() - epoch_;
+}
+
+SampleClock::SampleClock(double sample_rate)
+    : frames_(0),
+      sample_rate_(sample_rate) {
+}
+
+ClockTime SampleClock::now() const {
+  return ClockTime(static_cast<double>(frames_.load(std::memory_order_acquire)) / sample_rate_);
+}
+
+void SampleClock::advance(uint64_t frames) {
+  frames_.fetch_add(frames, std::memory_order_release);
+}
+
+ManualClock::ManualClock()
+    : seconds_(0.0) {
+}
+
+ClockTime ManualClock::now() const {
+  return ClockTime(seconds_.load(std::memory_order_acquire));
+}
+
+bool ManualClock::waitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, ClockTime timeout,
+                          const std::function<bool()>& woken) const {
+  const ClockTime deadline = now() + timeout;
+  while (!woken()) {
+    if (now() >= deadline) {
+      return false;
+    }
+    cv.wait_for(lock, kManualPollInterval);
+  }
+  return true;
+}
+
+void ManualClock::set(ClockTime time) {
+  double current = seconds_.load(std::memory_order_relaxed);
+  // Never move backwards - callers rely on monotonic time
+  while (time.count() > current &&
+         !seconds_.compare_exchange_weak(current, time.count(), std::memory_order_release)) {
+  }
+}
+
+void ManualClock::advance(ClockTime delta) {
+  if (delta.count() <= 0.0) {
+    return;
+  }
+  double current = seconds_.load(std::memory_order_relaxed);
+  while (!seconds_.compare_exchange_weak(current, current + delta.count(), std::memory_order_release)) {
+  }
+}
+
+}  // namespace mpccli
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+namespace mpccli {
+
+// Seconds since a clock's epoch, stored as floating point for sub-sample precision
+using ClockTime = std::chrono::duration<double>;
+
+// Monotonic time source used for all musical timing.
+// Every implementation must never go backwards; the epoch is implementation defined,
+// so only differences between two readings of the same clock are meaningful.
+class Clock {
+ public:
+  virtual ~Clock() = default;
+
+  // Current time since this clock's epoch
+  virtual ClockTime now() const = 0;
+
+  // Block on `cv` (with `lock` held, like std::condition_variable::wait_for) until `woken`
+  // returns true or `timeout` of this clock's time has passed. Returns woken().
+  // The default sleeps in wall time and re-reads the clock on waking, which suits any
+  // clock that runs at roughly real time.
+  virtual bool waitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, ClockTime timeout,
+                       const std::function<bool()>& woken) const;
+};
+
+// Wall-time clock backed by std::chrono::steady_clock (immune to NTP/system time changes)
+// Epoch is the moment the clock was constructed
+class SteadyClock : public Clock {
+ public:
+  SteadyClock();
+
+  ClockTime now() const override;
+
+ private:
+  std::chrono::steady_clock::time_point epoch_;
+};
+
+// Clock driven by the number of audio frames rendered, so musical time
+// follows the sound card rather than the CPU clock.
+// The audio thread calls advance() once per buffer; any thread may call now().
+class SampleClock : public Clock {
+ public:
+  explicit SampleClock(double sample_rate);
+
+  ClockTime now() const override;
+
+  // Advance by a number of rendered frames (audio thread only)
+  void advance(uint64_t frames);
+
+  uint64_t frames() const { return frames_.load(std::memory_order_acquire); }
+  double sampleRate() const { return sample_rate_; }
+
+ private:
+  std::atomic<uint64_t> frames_;
+  double sample_rate_;
+};
+
+// Clock that only moves when told to, for deterministic tests and offline rendering
+class ManualClock : public Clock {
+ public:
+  ManualClock();
+
+  ClockTime now() const override;
+
+  // Polls the clock (it doesn't follow wall time), so waits end shortly after set() or
+  // advance() moves it past the timeout
+  bool waitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, ClockTime timeout,
+               const std::function<bool()>& woken) const override;
+
+  // Jump to an absolute time (ignored if it would move the clock backwards)
+  void set(ClockTime time);
+
+  // Move the clock forward by a duration
+  void advance(ClockTime delta);
+
+ private:
+  std::atomic<double> seconds_;
+};
+
+}  // namespace mpccli
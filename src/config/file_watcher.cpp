@@ -0,0 +1,67 @@
+#include "file_watcher.h"
+#include <filesystem>
+
+namespace mpccli {
+
+FileWatcher::FileWatcher()
+    : generation_(0) {
+}
+
+void FileWatcher::watch(const std::vector<std::string>& paths) {
+  std::map<std::string, std::string> watched;
+  for (const std::string& path : paths) {
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::absolute(path, error);
+    if (!error) {
+      watched[absolute.lexically_normal().string()] = path;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  watched_ = std::move(watched);
+  ++generation_;
+}
+
+void FileWatcher::setChangeCallback(FileChangeCallback callback) {
+  callback_ = callback;
+}
+
+std::map<std::string, std::string> FileWatcher::watchedPaths() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return watched_;
+}
+
+uint64_t FileWatcher::watchGeneration() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return generation_;
+}
+
+void FileWatcher::addPendingChange(const std::string& absolute_path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = watched_.find(absolute_path);
+  if (it != watched_.end()) {
+    pending_.insert(it->second);
+    last_change_ = std::chrono::steady_clock::now();
+  }
+}
+
+std::chrono::milliseconds FileWatcher::flushPendingChanges() {
+  if (pending_.empty()) {
+    return std::chrono::milliseconds(-1);
+  }
+
+  const auto quiet = std::chrono::steady_clock::now() - last_change_;
+  if (quiet < kSettleTime) {
+    return std::chrono::ceil<std::chrono::milliseconds>(kSettleTime - quiet);
+  }
+
+  // The callback may call watch(), so no lock is held while it runs
+  std::set<std::string> changed;
+  changed.swap(pending_);
+  if (callback_) {
+    callback_(changed);
+  }
+  return std::chrono::milliseconds(-1);
+}
+
+}  // namespace mpccli
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace mpccli {
+
+// Called with every watched path that changed (as passed to watch())
+using FileChangeCallback = std::function<void(const std::set<std::string>& changed_paths)>;
+
+// Watches a set of files for being written, replaced, created or removed.
+// Changes are batched: the callback runs once no watched file has changed for
+// kSettleTime, so an editor's save or a sample export arrives as one event.
+// Backends are platform specific; create() returns the one for this platform.
+class FileWatcher {
+ public:
+  static constexpr std::chrono::milliseconds kSettleTime{250};
+
+  virtual ~FileWatcher() = default;
+
+  // Platform backend (inotify on Linux, polling elsewhere)
+  static std::unique_ptr<FileWatcher> create();
+
+  // Replace the set of watched files (call before start() or from the change callback)
+  void watch(const std::vector<std::string>& paths);
+
+  // Set the callback for changes (called on the watcher thread)
+  void setChangeCallback(FileChangeCallback callback);
+
+  // Start watching on a background thread. Returns false if watching is unavailable.
+  virtual bool start() = 0;
+
+  // Stop watching (no callbacks are made once this returns)
+  virtual void stop() = 0;
+
+ protected:
+  FileWatcher();
+
+  // Watched files by absolute path, mapped to the path as given to watch()
+  std::map<std::string, std::string> watchedPaths() const;
+
+  // Incremented by every watch() call, so backends can tell when to re-read watchedPaths()
+  uint64_t watchGeneration() const;
+
+  // Record a change to a watched file (by absolute path; other paths are ignored)
+  void addPendingChange(const std::string& absolute_path);
+
+  // Report pending changes once they have settled. Returns how long to wait before calling
+  // again, or a negative duration if nothing is pending.
+  std::chrono::milliseconds flushPendingChanges();
+
+ private:
+  std::map<std::string, std::string> watched_;
+  uint64_t generation_;
+  mutable std::mutex mutex_;
+
+  // Only touched by the backend thread
+  std::set<std::string> pending_;
+  std::chrono::steady_clock::time_point last_change_;
+
+  FileChangeCallback callback_;
+};
+
+}  // namespace mpccli
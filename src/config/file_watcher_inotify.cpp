@@ -0,0 +1,167 @@
+#include "file_watcher.h"
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+namespace mpccli {
+
+namespace {
+
+// Watches the directories holding the files rather than the files themselves: editors and
+// exporters often save by writing a new file and renaming it over the old one, which
+// would silently end a watch on the old file.
+constexpr uint32_t kDirectoryEvents =
+    IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_ATTRIB;
+
+class InotifyFileWatcher : public FileWatcher {
+ public:
+  InotifyFileWatcher() : inotify_fd_(-1), running_(false) {
+    stop_pipe_[0] = -1;
+    stop_pipe_[1] = -1;
+  }
+
+  ~InotifyFileWatcher() override {
+    stop();
+  }
+
+  bool start() override {
+    if (running_) {
+      return true;
+    }
+
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ < 0 || pipe(stop_pipe_) != 0) {
+      std::cerr << "Failed to start file watcher: " << std::strerror(errno) << std::endl;
+      closeAll();
+      return false;
+    }
+
+    running_ = true;
+    thread_ = std::thread([this]() { watchLoop(); });
+    return true;
+  }
+
+  void stop() override {
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+
+    // Wake the poll() in watchLoop
+    const char wake = 0;
+    (void)write(stop_pipe_[1], &wake, 1);
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    closeAll();
+  }
+
+ private:
+  void watchLoop() {
+    pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {stop_pipe_[0], POLLIN, 0}};
+    uint64_t synced_generation = ~uint64_t{0};
+    std::chrono::milliseconds timeout(-1);
+
+    while (running_) {
+      if (watchGeneration() != synced_generation) {
+        synced_generation = watchGeneration();
+        syncDirectories();
+      }
+
+      // Sleep until something changes, or until pending changes have settled
+      if (poll(fds, 2, static_cast<int>(timeout.count())) < 0) {
+        continue;  // Interrupted by a signal
+      }
+      if (!running_) {
+        break;
+      }
+
+      if (fds[0].revents & POLLIN) {
+        readEvents();
+      }
+      timeout = flushPendingChanges();
+    }
+  }
+
+  // Watch exactly the directories that hold watched files
+  void syncDirectories() {
+    std::set<std::string> wanted;
+    for (const auto& entry : watchedPaths()) {
+      wanted.insert(std::filesystem::path(entry.first).parent_path().string());
+    }
+
+    for (auto it = directories_.begin(); it != directories_.end();) {
+      if (!wanted.count(it->second)) {
+        inotify_rm_watch(inotify_fd_, it->first);
+        it = directories_.erase(it);
+      } else {
+        wanted.erase(it->second);
+        ++it;
+      }
+    }
+
+    for (const std::string& directory : wanted) {
+      const int wd = inotify_add_watch(inotify_fd_, directory.c_str(), kDirectoryEvents);
+      if (wd < 0) {
+        std::cerr << "Cannot watch " << directory << ": " << std::strerror(errno) << std::endl;
+        continue;
+      }
+      directories_[wd] = directory;
+    }
+  }
+
+  void readEvents() {
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+      const ssize_t size = read(inotify_fd_, buffer, sizeof(buffer));
+      if (size <= 0) {
+        return;  // EAGAIN: drained
+      }
+
+      for (ssize_t offset = 0; offset < size;) {
+        const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+        offset += sizeof(inotify_event) + event->len;
+
+        auto directory = directories_.find(event->wd);
+        if (directory == directories_.end() || event->len == 0) {
+          continue;
+        }
+        addPendingChange(directory->second + "/" + event->name);
+      }
+    }
+  }
+
+  void closeAll() {
+    if (inotify_fd_ >= 0) {
+      close(inotify_fd_);  // Also drops every watch
+      inotify_fd_ = -1;
+    }
+    for (int& fd : stop_pipe_) {
+      if (fd >= 0) {
+        close(fd);
+        fd = -1;
+      }
+    }
+    directories_.clear();
+  }
+
+  int inotify_fd_;
+  int stop_pipe_[2];
+  std::map<int, std::string> directories_;  // Watch descriptor -> directory
+  std::atomic<bool> running_;
+  std::thread thread_;
+};
+
+}  // namespace
+
+std::unique_ptr<FileWatcher> FileWatcher::create() {
+  return std::make_unique<InotifyFileWatcher>();
+}
+
+}  // namespace mpccli
@@ -0,0 +1,104 @@
+#include "file_watcher.h"
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <thread>
+
+namespace mpccli {
+
+namespace {
+
+// How often watched files are checked
+constexpr std::chrono::milliseconds kPollInterval(250);
+
+// Portable backend: compares each file's modification time and size every kPollInterval
+class PollingFileWatcher : public FileWatcher {
+ public:
+  PollingFileWatcher() : running_(false) {}
+
+  ~PollingFileWatcher() override {
+    stop();
+  }
+
+  bool start() override {
+    if (running_) {
+      return true;
+    }
+    running_ = true;
+    thread_ = std::thread([this]() { watchLoop(); });
+    return true;
+  }
+
+  void stop() override {
+    {
+      std::lock_guard<std::mutex> lock(stop_mutex_);
+      if (!running_) {
+        return;
+      }
+      running_ = false;
+    }
+    stop_cv_.notify_one();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+ private:
+  // What a change looks like from the outside (a missing file has no time)
+  struct FileState {
+    std::filesystem::file_time_type modified{};
+    uintmax_t size = 0;
+    bool exists = false;
+
+    bool operator==(const FileState&) const = default;
+  };
+
+  static FileState readState(const std::string& path) {
+    FileState state;
+    std::error_code error;
+    state.modified = std::filesystem::last_write_time(path, error);
+    if (!error) {
+      state.size = std::filesystem::file_size(path, error);
+      state.exists = !error;
+    }
+    return state;
+  }
+
+  void watchLoop() {
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    while (running_) {
+      lock.unlock();
+
+      // Files new to the watch list start from their current state
+      std::map<std::string, FileState> states;
+      for (const auto& entry : watchedPaths()) {
+        FileState state = readState(entry.first);
+        auto previous = states_.find(entry.first);
+        if (previous != states_.end() && !(previous->second == state)) {
+          addPendingChange(entry.first);
+        }
+        states[entry.first] = state;
+      }
+      states_ = std::move(states);
+
+      flushPendingChanges();
+
+      lock.lock();
+      stop_cv_.wait_for(lock, kPollInterval, [this] { return !running_; });
+    }
+  }
+
+  std::map<std::string, FileState> states_;  // Last seen state by absolute path
+  bool running_;
+  std::mutex stop_mutex_;
+  std::condition_variable stop_cv_;
+  std::thread thread_;
+};
+
+}  // namespace
+
+std::unique_ptr<FileWatcher> FileWatcher::create() {
+  return std::make_unique<PollingFileWatcher>();
+}
+
+}  // namespace mpccli
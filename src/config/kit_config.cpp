@@ -0,0 +1,697 @@
+#include "kit_config.h"
+#include <algorithm>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <yaml-cpp/yaml.h>
+
+namespace mpccli {
+
+namespace {
+
+// Files of one layer: a single 'path' or a list of round-robin 'paths'
+std::vector<std::string> loadLayerFiles(const YAML::Node& node) {
+  std::vector<std::string> files;
+  if (node["path"]) {
+    files.push_back(node["path"].as<std::string>());
+  }
+  if (node["paths"]) {
+    for (const auto& path : node["paths"]) {
+      files.push_back(path.as<std::string>());
+    }
+  }
+  return files;
+}
+
+// Index of a bank by name, adding it if there is room. Returns false if there isn't.
+bool findOrAddBank(std::vector<std::string>& banks, const std::string& name, size_t& index) {
+  auto it = std::find(banks.begin(), banks.end(), name);
+  if (it == banks.end()) {
+    if (banks.size() >= kMaxBanks) {
+      return false;
+    }
+    it = banks.insert(banks.end(), name);
+  }
+  index = static_cast<size_t>(it - banks.begin());
+  return true;
+}
+
+// Buses of a 'mixer' subsection ('groups' or 'sends'), in file order
+std::vector<BusSettings> loadBuses(const YAML::Node& node) {
+  std::vector<BusSettings> buses;
+  for (const auto& entry : node) {
+    BusSettings bus;
+    bus.name = entry.first.as<std::string>();
+    if (entry.second["volume"]) {
+      bus.volume = entry.second["volume"].as<double>();
+    }
+    if (entry.second["output"]) {
+      bus.output = entry.second["output"].as<std::string>();
+    }
+    if (YAML::Node reverb = entry.second["reverb"]) {
+      bus.effect.type = SendEffectType::Reverb;
+      if (reverb["size"]) {
+        bus.effect.reverb.size = reverb["size"].as<float>();
+      }
+      if (reverb["decay"]) {
+        bus.effect.reverb.decay = reverb["decay"].as<float>();
+      }
+      if (reverb["damping"]) {
+        bus.effect.reverb.damping = reverb["damping"].as<float>();
+      }
+    }
+    if (YAML::Node delay = entry.second["delay"]) {
+      if (bus.effect.type != SendEffectType::None) {
+        std::cerr << "Warning: Mixer bus '" << bus.name << "' has a reverb and a delay, using the delay" << std::endl;
+      }
+      bus.effect.type = SendEffectType::Delay;
+      if (delay["beats"]) {
+        bus.effect.delay.beats = delay["beats"].as<float>();
+      }
+      if (delay["feedback"]) {
+        bus.effect.delay.feedback = delay["feedback"].as<float>();
+      }
+      if (delay["damping"]) {
+        bus.effect.delay.damping = delay["damping"].as<float>();
+      }
+      if (delay["ping_pong"]) {
+        bus.effect.delay.ping_pong = delay["ping_pong"].as<bool>();
+      }
+    }
+    buses.push_back(std::move(bus));
+  }
+  return buses;
+}
+
+// A sample's 'filter', 'compressor' and 'saturation' keys
+ChannelEffectParams loadChannelEffects(const YAML::Node& sample, const std::string& name) {
+  ChannelEffectParams effects;
+  if (YAML::Node filter = sample["filter"]) {
+    effects.filter.type = FilterType::LowPass;
+    if (filter["type"]) {
+      const std::string type = filter["type"].as<std::string>();
+      if (!parseFilterType(type, effects.filter.type)) {
+        std::cerr << "Warning: Sample '" << name << "' has unknown filter type '" << type
+                  << "' (use lowpass, highpass or bandpass), using lowpass" << std::endl;
+        effects.filter.type = FilterType::LowPass;
+      }
+    }
+    if (filter["cutoff"]) {
+      effects.filter.cutoff_hz = filter["cutoff"].as<float>();
+    }
+    if (filter["resonance"]) {
+      effects.filter.resonance = filter["resonance"].as<float>();
+    }
+  }
+  if (YAML::Node compressor = sample["compressor"]) {
+    effects.compressor.enabled = true;
+    if (compressor["threshold"]) {
+      effects.compressor.threshold_db = compressor["threshold"].as<float>();
+    }
+    if (compressor["ratio"]) {
+      effects.compressor.ratio = compressor["ratio"].as<float>();
+    }
+    if (compressor["attack"]) {
+      effects.compressor.attack_ms = compressor["attack"].as<float>();
+    }
+    if (compressor["release"]) {
+      effects.compressor.release_ms = compressor["release"].as<float>();
+    }
+    if (compressor["makeup"]) {
+      effects.compressor.makeup_db = compressor["makeup"].as<float>();
+    }
+  }
+  if (YAML::Node saturation = sample["saturation"]) {
+    effects.saturator.enabled = true;
+    if (saturation["drive"]) {
+      effects.saturator.drive_db = saturation["drive"].as<float>();
+    }
+    if (saturation["mix"]) {
+      effects.saturator.mix = saturation["mix"].as<float>();
+    }
+  }
+  return effects;
+}
+
+LimiterParams loadLimiter(const YAML::Node& node) {
+  LimiterParams limiter;
+  if (node.IsScalar()) {
+    limiter.enabled = node.as<bool>();
+    return limiter;
+  }
+  if (node["ceiling"]) {
+    limiter.ceiling_db = node["ceiling"].as<float>();
+    if (limiter.ceiling_db > 0.0f) {
+      std::cerr << "Warning: Limiter ceiling must be at most 0 dB, using 0" << std::endl;
+      limiter.ceiling_db = 0.0f;
+    }
+  }
+  if (node["lookahead"]) {
+    limiter.lookahead_ms = node["lookahead"].as<float>();
+    if (limiter.lookahead_ms < 0.1f || limiter.lookahead_ms > 20.0f) {
+      std::cerr << "Warning: Limiter lookahead must be 0.1-20 ms, using 1.5" << std::endl;
+      limiter.lookahead_ms = 1.5f;
+    }
+  }
+  if (node["release"]) {
+    limiter.release_ms = node["release"].as<float>();
+  }
+  return limiter;
+}
+
+// A thread class of the 'realtime' section: '<name>_priority' and '<name>_cores'
+ThreadPolicy loadThreadPolicy(const YAML::Node& node, const std::string& name) {
+  ThreadPolicy policy;
+  if (YAML::Node priority = node[name + "_priority"]) {
+    policy.priority = priority.as<int>();
+    if (policy.priority < 0 || policy.priority > ThreadPolicy::kMaxPriority) {
+      std::cerr << "Warning: " << name << "_priority must be 0-" << ThreadPolicy::kMaxPriority
+                << ", using normal scheduling" << std::endl;
+      policy.priority = 0;
+    }
+  }
+  if (YAML::Node cores = node[name + "_cores"]) {
+    // A list of CPUs, or just one
+    std::vector<int> listed;
+    if (cores.IsSequence()) {
+      for (const auto& core : cores) {
+        listed.push_back(core.as<int>());
+      }
+    } else {
+      listed.push_back(cores.as<int>());
+    }
+    for (int core : listed) {
+      if (core < 0) {
+        std::cerr << "Warning: Ignoring CPU " << core << " in " << name << "_cores" << std::endl;
+        continue;
+      }
+      policy.cores.push_back(core);
+    }
+  }
+  return policy;
+}
+
+RealtimeSettings loadRealtime(const YAML::Node& node) {
+  if (node.IsScalar()) {
+    return node.as<bool>() ? RealtimeSettings::recommended() : RealtimeSettings{};
+  }
+  RealtimeSettings realtime;
+  realtime.audio = loadThreadPolicy(node, "audio");
+  realtime.scheduler = loadThreadPolicy(node, "scheduler");
+  if (node["lock_memory"]) {
+    realtime.lock_memory = node["lock_memory"].as<bool>();
+  }
+  if (node["prefault"]) {
+    realtime.prefault = node["prefault"].as<bool>();
+  }
+  return realtime;
+}
+
+MixerSettings loadMixerSettings(const YAML::Node& config) {
+  MixerSettings settings;
+  if (YAML::Node mixer = config["mixer"]) {
+    if (mixer["master"] && mixer["master"]["volume"]) {
+      settings.master_volume = mixer["master"]["volume"].as<double>();
+    }
+    if (mixer["master"] && mixer["master"]["limiter"]) {
+      settings.limiter = loadLimiter(mixer["master"]["limiter"]);
+    }
+    if (mixer["tempo"]) {
+      settings.tempo = mixer["tempo"].as<double>();
+    }
+    if (mixer["groups"]) {
+      settings.groups = loadBuses(mixer["groups"]);
+    }
+    if (mixer["sends"]) {
+      settings.sends = loadBuses(mixer["sends"]);
+    }
+  }
+
+  if (YAML::Node samples = config["samples"]) {
+    for (const auto& sample : samples) {
+      ChannelSettings channel;
+      if (sample.second["group"]) {
+        channel.group = sample.second["group"].as<std::string>();
+      }
+      if (YAML::Node sends = sample.second["sends"]) {
+        for (const auto& send : sends) {
+          channel.sends[send.first.as<std::string>()] = send.second.as<double>();
+        }
+      }
+      channel.effects = loadChannelEffects(sample.second, sample.first.as<std::string>());
+      if (!channel.group.empty() || !channel.sends.empty() || channel.effects.enabled()) {
+        settings.channels[sample.first.as<std::string>()] = std::move(channel);
+      }
+    }
+  }
+  return settings;
+}
+
+void emitChannelEffects(YAML::Emitter& out, const ChannelEffectParams& effects) {
+  if (effects.filter.type != FilterType::Off) {
+    out << YAML::Key << "filter" << YAML::Value << YAML::BeginMap;
+    out << YAML::Key << "type" << YAML::Value << filterTypeName(effects.filter.type);
+    out << YAML::Key << "cutoff" << YAML::Value << effects.filter.cutoff_hz;
+    out << YAML::Key << "resonance" << YAML::Value << effects.filter.resonance;
+    out << YAML::EndMap;
+  }
+  if (effects.compressor.enabled) {
+    out << YAML::Key << "compressor" << YAML::Value << YAML::BeginMap;
+    out << YAML::Key << "threshold" << YAML::Value << effects.compressor.threshold_db;
+    out << YAML::Key << "ratio" << YAML::Value << effects.compressor.ratio;
+    out << YAML::Key << "attack" << YAML::Value << effects.compressor.attack_ms;
+    out << YAML::Key << "release" << YAML::Value << effects.compressor.release_ms;
+    out << YAML::Key << "makeup" << YAML::Value << effects.compressor.makeup_db;
+    out << YAML::EndMap;
+  }
+  if (effects.saturator.enabled) {
+    out << YAML::Key << "saturation" << YAML::Value << YAML::BeginMap;
+    out << YAML::Key << "drive" << YAML::Value << effects.saturator.drive_db;
+    out << YAML::Key << "mix" << YAML::Value << effects.saturator.mix;
+    out << YAML::EndMap;
+  }
+}
+
+void emitBuses(YAML::Emitter& out, const char* key, const std::vector<BusSettings>& buses) {
+  out << YAML::Key << key << YAML::Value << YAML::BeginMap;
+  for (const BusSettings& bus : buses) {
+    out << YAML::Key << bus.name << YAML::Value << YAML::BeginMap;
+    out << YAML::Key << "volume" << YAML::Value << bus.volume;
+    if (!bus.output.empty()) {
+      out << YAML::Key << "output" << YAML::Value << bus.output;
+    }
+    if (bus.effect.type == SendEffectType::Reverb) {
+      out << YAML::Key << "reverb" << YAML::Value << YAML::BeginMap;
+      out << YAML::Key << "size" << YAML::Value << bus.effect.reverb.size;
+      out << YAML::Key << "decay" << YAML::Value << bus.effect.reverb.decay;
+      out << YAML::Key << "damping" << YAML::Value << bus.effect.reverb.damping;
+      out << YAML::EndMap;
+    } else if (bus.effect.type == SendEffectType::Delay) {
+      out << YAML::Key << "delay" << YAML::Value << YAML::BeginMap;
+      out << YAML::Key << "beats" << YAML::Value << bus.effect.delay.beats;
+      out << YAML::Key << "feedback" << YAML::Value << bus.effect.delay.feedback;
+      out << YAML::Key << "damping" << YAML::Value << bus.effect.delay.damping;
+      out << YAML::Key << "ping_pong" << YAML::Value << bus.effect.delay.ping_pong;
+      out << YAML::EndMap;
+    }
+    out << YAML::EndMap;
+  }
+  out << YAML::EndMap;
+}
+
+}  // namespace
+
+KitLayout loadSamplesFromYaml(const std::string& yaml_path) {
+  KitLayout layout;
+  std::map<std::string, int> choke_groups;  // Group name -> engine group ID (from 1)
+  std::set<std::pair<size_t, char>> used_keys;  // (bank, key)
+
+  try {
+    YAML::Node config = YAML::LoadFile(yaml_path);
+
+    if (!config["samples"]) {
+      throw std::runtime_error("YAML file missing 'samples' key");
+    }
+
+    // Optional bank order; samples without a 'bank' go to the first one
+    if (YAML::Node banks = config["banks"]) {
+      for (const auto& bank : banks) {
+        size_t index;
+        if (!findOrAddBank(layout.banks, bank.as<std::string>(), index)) {
+          std::cerr << "Warning: More than " << kMaxBanks << " banks, ignoring '" << bank.as<std::string>() << "'"
+                    << std::endl;
+        }
+      }
+    }
+    if (layout.banks.empty()) {
+      layout.banks.push_back("main");
+    }
+
+    for (const auto& sample : config["samples"]) {
+      std::string sample_name = sample.first.as<std::string>();
+      YAML::Node sample_data = sample.second;
+
+      // Either one layer given directly (path/paths) or a list of velocity layers
+      std::vector<SampleLayer> layers;
+      if (sample_data["layers"]) {
+        for (const auto& layer_data : sample_data["layers"]) {
+          SampleLayer layer;
+          layer.files = loadLayerFiles(layer_data);
+          if (layer_data["velocity"]) {
+            layer.velocity_low = layer_data["velocity"][0].as<int>();
+            layer.velocity_high = layer_data["velocity"][1].as<int>();
+          }
+          if (!layer.files.empty()) {
+            layers.push_back(std::move(layer));
+          }
+        }
+      } else {
+        SampleLayer layer;
+        layer.files = loadLayerFiles(sample_data);
+        if (!layer.files.empty()) {
+          layers.push_back(std::move(layer));
+        }
+      }
+
+      if (layers.empty()) {
+        std::cerr << "Warning: Sample '" << sample_name << "' missing 'path', skipping" << std::endl;
+        continue;
+      }
+
+      if (layout.pads.size() >= kMaxPads) {
+        std::cerr << "Warning: More than " << kMaxPads << " samples, skipping '" << sample_name << "'" << std::endl;
+        continue;
+      }
+
+      size_t bank = 0;
+      if (sample_data["bank"]) {
+        const std::string bank_name = sample_data["bank"].as<std::string>();
+        if (!findOrAddBank(layout.banks, bank_name, bank)) {
+          std::cerr << "Warning: More than " << kMaxBanks << " banks, sample '" << sample_name
+                    << "' goes to bank '" << layout.banks.front() << "'" << std::endl;
+        }
+      }
+
+      // Optional keyboard key within the bank. Samples without one are still played
+      // by name (OSC, control socket) or MIDI note.
+      char key = 0;
+      if (sample_data["key"]) {
+        const std::string key_str = sample_data["key"].as<std::string>();
+        if (key_str.length() != 1) {
+          std::cerr << "Warning: Sample '" << sample_name << "' key must be a single character, "
+                    << "it can only be played by name or MIDI" << std::endl;
+        } else if (!used_keys.emplace(bank, key_str[0]).second) {
+          std::cerr << "Warning: Key '" << key_str << "' is already used in bank '" << layout.banks[bank]
+                    << "', sample '" << sample_name << "' can only be played by name or MIDI" << std::endl;
+        } else {
+          key = key_str[0];
+        }
+      }
+
+      SampleOptions options;
+      options.volume = sample_data["volume"] ? sample_data["volume"].as<double>() : 1.0;
+
+      // Optional pitch shifting settings: "rate" (default) or "stretch" (keeps duration)
+      if (sample_data["pitch_mode"]) {
+        std::string mode_str = sample_data["pitch_mode"].as<std::string>();
+        if (mode_str == "stretch") {
+          options.pitch_mode = PitchMode::Stretch;
+        } else if (mode_str != "rate") {
+          std::cerr << "Warning: Sample '" << sample_name << "' has unknown pitch_mode '" << mode_str
+                    << "', using 'rate'" << std::endl;
+        }
+      }
+      options.precompute_pitches = sample_data["precompute_pitches"] ? sample_data["precompute_pitches"].as<bool>() : false;
+
+      // Optional ADSR envelope (times in seconds); without one the sample plays to its end
+      if (YAML::Node envelope = sample_data["envelope"]) {
+        AdsrParams adsr;
+        adsr.attack = envelope["attack"] ? envelope["attack"].as<float>() : adsr.attack;
+        adsr.decay = envelope["decay"] ? envelope["decay"].as<float>() : adsr.decay;
+        adsr.sustain = envelope["sustain"] ? envelope["sustain"].as<float>() : adsr.sustain;
+        adsr.release = envelope["release"] ? envelope["release"].as<float>() : adsr.release;
+        options.envelope = adsr;
+      }
+
+      // Optional choke group: triggering a sample cuts off the others with the same group name
+      if (sample_data["choke_group"]) {
+        std::string group = sample_data["choke_group"].as<std::string>();
+        auto inserted = choke_groups.emplace(group, static_cast<int>(choke_groups.size()) + 1);
+        options.choke_group = inserted.first->second;
+      }
+
+      // Optional MIDI note number (0-127) for controller pads
+      int midi_note = sample_data["note"] ? sample_data["note"].as<int>() : -1;
+
+      const PadId pad = static_cast<PadId>(layout.pads.size());
+      layout.pads[pad] = {std::move(layers), sample_name, options, midi_note, key, bank};
+    }
+  } catch (const YAML::Exception& e) {
+    std::cerr << "Error loading YAML file: " << e.what() << std::endl;
+    throw;
+  }
+
+  return layout;
+}
+
+KitLayout keepPadIds(const KitLayout& previous, const KitLayout& next) {
+  std::map<std::string, PadId> previous_ids;
+  for (const auto& [pad, spec] : previous.pads) {
+    previous_ids[spec.name] = pad;
+  }
+
+  KitLayout renumbered;
+  renumbered.banks = next.banks;
+  std::vector<const SampleSpec*> added;
+  for (const auto& [pad, spec] : next.pads) {
+    auto it = previous_ids.find(spec.name);
+    if (it != previous_ids.end()) {
+      renumbered.pads[it->second] = spec;
+    } else {
+      added.push_back(&spec);
+    }
+  }
+
+  PadId free_pad = 0;
+  for (const SampleSpec* spec : added) {
+    while (renumbered.pads.count(free_pad)) {
+      ++free_pad;
+    }
+    renumbered.pads[free_pad] = *spec;
+  }
+  return renumbered;
+}
+
+EngineSettings loadEngineSettingsFromYaml(const std::string& yaml_path) {
+  EngineSettings settings;
+
+  try {
+    YAML::Node config = YAML::LoadFile(yaml_path);
+    YAML::Node engine = config["engine"];
+    if (!engine) {
+      return settings;
+    }
+
+    if (engine["resampler"]) {
+      std::string quality = engine["resampler"].as<std::string>();
+      if (!parseResamplerQuality(quality, settings.resampler_quality)) {
+        std::cerr << "Warning: Unknown resampler '" << quality << "' (use linear, cubic or sinc), using "
+                  << resamplerQualityName(settings.resampler_quality) << std::endl;
+      }
+    }
+
+    if (engine["pitch_cache_mb"]) {
+      settings.pitch_cache_mb = engine["pitch_cache_mb"].as<size_t>();
+    }
+
+    if (engine["render_threads"]) {
+      settings.render_threads = engine["render_threads"].as<size_t>();
+      if (settings.render_threads < 1 || settings.render_threads > AudioEngine::kMaxRenderThreads) {
+        std::cerr << "Warning: render_threads must be 1-" << AudioEngine::kMaxRenderThreads << ", using 1" << std::endl;
+        settings.render_threads = 1;
+      }
+    }
+
+    if (engine["realtime"]) {
+      settings.realtime = loadRealtime(engine["realtime"]);
+    }
+
+    if (engine["output"]) {
+      std::string backend = engine["output"].as<std::string>();
+      if (!parseOutputBackend(backend, settings.output.backend)) {
+        std::cerr << "Warning: Unknown output '" << backend << "' (use coreaudio, alsa, auto, file or null), using "
+                  << outputBackendName(settings.output.backend) << std::endl;
+      }
+    }
+
+    if (engine["output_device"]) {
+      settings.output.device = engine["output_device"].as<std::string>();
+    }
+
+    if (engine["sample_rate"]) {
+      settings.output.sample_rate = engine["sample_rate"].as<double>();
+      if (settings.output.sample_rate < OutputSettings::kMinSampleRate ||
+          settings.output.sample_rate > OutputSettings::kMaxSampleRate) {
+        std::cerr << "Warning: sample_rate must be 8000-192000, using " << kEngineSampleRate << std::endl;
+        settings.output.sample_rate = kEngineSampleRate;
+      }
+    }
+
+    if (engine["buffer_frames"]) {
+      settings.output.buffer_frames = engine["buffer_frames"].as<size_t>();
+      if (settings.output.buffer_frames < OutputSettings::kMinBufferFrames ||
+          settings.output.buffer_frames > OutputSettings::kMaxBufferFrames) {
+        std::cerr << "Warning: buffer_frames must be " << OutputSettings::kMinBufferFrames << "-"
+                  << OutputSettings::kMaxBufferFrames << ", using " << OutputSettings{}.buffer_frames << std::endl;
+        settings.output.buffer_frames = OutputSettings{}.buffer_frames;
+      }
+    }
+
+    if (engine["periods"]) {
+      settings.output.periods = engine["periods"].as<size_t>();
+      if (settings.output.periods < OutputSettings::kMinPeriods || settings.output.periods > OutputSettings::kMaxPeriods) {
+        std::cerr << "Warning: periods must be " << OutputSettings::kMinPeriods << "-" << OutputSettings::kMaxPeriods
+                  << ", using " << OutputSettings{}.periods << std::endl;
+        settings.output.periods = OutputSettings{}.periods;
+      }
+    }
+  } catch (const YAML::Exception& e) {
+    std::cerr << "Error loading YAML file: " << e.what() << std::endl;
+    throw;
+  }
+
+  return settings;
+}
+
+std::vector<std::string> kitFiles(const std::string& yaml_path, const KitLayout& layout) {
+  std::vector<std::string> files{yaml_path};
+  for (const auto& [pad, spec] : layout.pads) {
+    for (const SampleLayer& layer : spec.layers) {
+      files.insert(files.end(), layer.files.begin(), layer.files.end());
+    }
+  }
+  return files;
+}
+
+MixerSettings loadMixerSettingsFromYaml(const std::string& yaml_path) {
+  try {
+    return loadMixerSettings(YAML::LoadFile(yaml_path));
+  } catch (const YAML::Exception& e) {
+    std::cerr << "Error loading YAML file: " << e.what() << std::endl;
+    throw;
+  }
+}
+
+std::string mixerSettingsToYaml(const MixerSettings& settings) {
+  YAML::Emitter out;
+  out << YAML::BeginMap;
+  out << YAML::Key << "mixer" << YAML::Value << YAML::BeginMap;
+  out << YAML::Key << "master" << YAML::Value << YAML::BeginMap;
+  out << YAML::Key << "volume" << YAML::Value << settings.master_volume;
+  out << YAML::Key << "limiter" << YAML::Value;
+  if (settings.limiter.enabled) {
+    out << YAML::BeginMap;
+    out << YAML::Key << "ceiling" << YAML::Value << settings.limiter.ceiling_db;
+    out << YAML::Key << "lookahead" << YAML::Value << settings.limiter.lookahead_ms;
+    out << YAML::Key << "release" << YAML::Value << settings.limiter.release_ms;
+    out << YAML::EndMap;
+  } else {
+    out << false;
+  }
+  out << YAML::EndMap;
+  out << YAML::Key << "tempo" << YAML::Value << settings.tempo;
+  emitBuses(out, "groups", settings.groups);
+  emitBuses(out, "sends", settings.sends);
+  out << YAML::EndMap;
+
+  out << YAML::Key << "samples" << YAML::Value << YAML::BeginMap;
+  for (const auto& [name, channel] : settings.channels) {
+    out << YAML::Key << name << YAML::Value << YAML::BeginMap;
+    if (!channel.group.empty()) {
+      out << YAML::Key << "group" << YAML::Value << channel.group;
+    }
+    out << YAML::Key << "sends" << YAML::Value << YAML::BeginMap;
+    for (const auto& [bus, level] : channel.sends) {
+      out << YAML::Key << bus << YAML::Value << level;
+    }
+    out << YAML::EndMap;
+    emitChannelEffects(out, channel.effects);
+    out << YAML::EndMap;
+  }
+  out << YAML::EndMap << YAML::EndMap;
+  return out.c_str();
+}
+
+MixerSettings parseMixerSettings(const std::string& yaml_text) {
+  return loadMixerSettings(YAML::Load(yaml_text));
+}
+
+MixerRouting mixerRouting(const MixerSettings& settings, const KitLayout& layout) {
+  MixerRouting routing;
+  routing.master_gain = static_cast<float>(settings.master_volume);
+  routing.limiter = settings.limiter;
+
+  // Group and aux buses share one name space
+  std::map<std::string, int> groups;
+  std::map<std::string, int> sends;
+  std::vector<const BusSettings*> added;  // Settings of each routing bus
+  auto add_buses = [&](const std::vector<BusSettings>& buses, std::map<std::string, int>& index) {
+    for (const BusSettings& bus : buses) {
+      if (groups.count(bus.name) || sends.count(bus.name)) {
+        std::cerr << "Warning: Mixer bus '" << bus.name << "' is defined twice, ignoring the second" << std::endl;
+        continue;
+      }
+      index[bus.name] = static_cast<int>(routing.buses.size());
+      added.push_back(&bus);
+      routing.buses.push_back({bus.name, static_cast<float>(bus.volume), MixerRouting::kMasterBus, bus.effect});
+    }
+  };
+  add_buses(settings.groups, groups);
+  add_buses(settings.sends, sends);
+
+  // Any bus may feed a group bus
+  auto find_group = [&groups](const std::string& name, const std::string& user) {
+    auto it = groups.find(name);
+    if (it == groups.end()) {
+      std::cerr << "Warning: " << user << " feeds unknown group '" << name << "', routing it to master" << std::endl;
+      return static_cast<int>(MixerRouting::kMasterBus);
+    }
+    return it->second;
+  };
+  for (size_t b = 0; b < added.size(); ++b) {
+    if (!added[b]->output.empty()) {
+      routing.buses[b].output = find_group(added[b]->output, "Mixer bus '" + added[b]->name + "'");
+    }
+  }
+
+  for (const auto& [pad, spec] : layout.pads) {
+    auto it = settings.channels.find(spec.name);
+    if (it == settings.channels.end()) {
+      continue;
+    }
+    const ChannelSettings& settings_channel = it->second;
+    MixerRouting::Channel channel;
+    channel.pad = pad;
+    channel.effects = settings_channel.effects;
+    if (!settings_channel.group.empty()) {
+      channel.output = find_group(settings_channel.group, "Sample '" + spec.name + "'");
+    }
+    for (const auto& [bus, level] : settings_channel.sends) {
+      auto send = sends.find(bus);
+      if (send == sends.end()) {
+        std::cerr << "Warning: Sample '" << spec.name << "' sends to unknown aux bus '" << bus << "', ignoring it"
+                  << std::endl;
+        continue;
+      }
+      channel.sends.push_back({send->second, static_cast<float>(level)});
+    }
+    routing.channels.push_back(std::move(channel));
+  }
+  return routing;
+}
+
+ControlSettings loadControlSettingsFromYaml(const std::string& yaml_path) {
+  ControlSettings settings;
+
+  try {
+    YAML::Node config = YAML::LoadFile(yaml_path);
+    YAML::Node control = config["control"];
+    if (!control) {
+      return settings;
+    }
+
+    if (control["osc_port"]) {
+      settings.osc_port = control["osc_port"].as<int>();
+    }
+    if (control["socket"]) {
+      settings.socket_path = control["socket"].as<std::string>();
+    }
+  } catch (const YAML::Exception& e) {
+    std::cerr << "Error loading YAML file: " << e.what() << std::endl;
+    throw;
+  }
+
+  return settings;
+}
+
+}  // namespace mpccli
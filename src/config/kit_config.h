@@ -0,0 +1,98 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include "../audio-processor/audio_processor.h"
+#include "../dsp/resampler.h"
+#include "../engine/mixer_graph.h"
+#include "../kit/pad.h"
+#include "../realtime/realtime.h"
+
+namespace mpccli {
+
+// One sample of the kit as configured in samples.yaml
+struct SampleSpec {
+  std::vector<SampleLayer> layers;
+  std::string name;
+  SampleOptions options;
+  int midi_note = -1;  // MIDI note that plays this sample (-1 = none)
+  char key = 0;        // Keyboard key within its bank (0 = none, played by name or MIDI only)
+  size_t bank = 0;     // Index into KitLayout::banks
+};
+
+// Every pad of a kit and the banks its keyboard keys are grouped in. Pads are numbered
+// in samples.yaml order; all banks stay loaded, switching one only changes what the keys play.
+struct KitLayout {
+  std::vector<std::string> banks;  // Bank names, at least one
+  std::map<PadId, SampleSpec> pads;
+};
+
+// Engine-wide settings from the optional top-level 'engine' section
+struct EngineSettings {
+  ResamplerQuality resampler_quality = ResamplerQuality::Cubic;
+  size_t pitch_cache_mb = 128;
+  size_t render_threads = 1;  // Threads rendering each audio buffer (startup only)
+  OutputSettings output;      // From 'output', 'output_device', 'sample_rate', 'buffer_frames' and 'periods'
+  RealtimeSettings realtime;  // From 'realtime' (true for RealtimeSettings::recommended())
+};
+
+// A bus of the optional top-level 'mixer' section
+struct BusSettings {
+  std::string name;
+  double volume = 1.0;
+  std::string output;       // Group bus it feeds (empty = master)
+  SendEffectParams effect;  // From a 'reverb' or 'delay' key
+};
+
+// A sample's own channel, from its 'group', 'sends', 'filter', 'compressor' and 'saturation' keys
+struct ChannelSettings {
+  std::string group;                    // Group bus (empty = master)
+  std::map<std::string, double> sends;  // Aux bus name -> send level
+  ChannelEffectParams effects;
+};
+
+// Mixer buses and routing. Samples with no group, sends or effects mix straight into the master.
+struct MixerSettings {
+  double master_volume = 1.0;
+  LimiterParams limiter;  // From 'master: limiter' (a map, or false to turn it off)
+  double tempo = 120.0;  // BPM the send delays start at (the sequencer can change it)
+  std::vector<BusSettings> groups;
+  std::vector<BusSettings> sends;  // Aux buses fed by the samples' send levels
+  std::map<std::string, ChannelSettings> channels;  // By sample name
+};
+
+// Remote control settings from the optional top-level 'control' section
+struct ControlSettings {
+  int osc_port = 0;         // UDP port for the OSC server on localhost (0 = disabled)
+  std::string socket_path;  // Unix socket for the control/stats API (empty = disabled)
+};
+
+// Pads from the 'samples' section, grouped into the banks named by the optional top-level
+// 'banks' list and each sample's 'bank'. Invalid entries are skipped with a warning;
+// throws if the file can't be read or parsed.
+KitLayout loadSamplesFromYaml(const std::string& yaml_path);
+
+// Renumber `next` so samples that are also in `previous` (by name) keep their pad ID,
+// e.g. across a hot reload; new samples take the lowest free IDs.
+KitLayout keepPadIds(const KitLayout& previous, const KitLayout& next);
+
+EngineSettings loadEngineSettingsFromYaml(const std::string& yaml_path);
+
+ControlSettings loadControlSettingsFromYaml(const std::string& yaml_path);
+
+// The 'mixer' section plus each sample's 'group' and 'sends'. Unknown bus names are
+// reported and routed to the master.
+MixerSettings loadMixerSettingsFromYaml(const std::string& yaml_path);
+
+// Mixer settings as a YAML document of the same shape, and back (for compiled kits)
+std::string mixerSettingsToYaml(const MixerSettings& settings);
+MixerSettings parseMixerSettings(const std::string& yaml_text);
+
+// Resolve bus and sample names to the engine's routing for the pads of `layout`
+MixerRouting mixerRouting(const MixerSettings& settings, const KitLayout& layout);
+
+// Files a kit is built from: the YAML file itself and every sample it references
+std::vector<std::string> kitFiles(const std::string& yaml_path, const KitLayout& layout);
+
+}  // namespace mpccli
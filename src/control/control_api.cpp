@@ -0,0 +1,296 @@
+#include "control_api.h"
+#include <chrono>
+#include <cmath>
+#include <sstream>
+
+namespace mpccli {
+
+namespace {
+
+// Histogram as JSON, in milliseconds, with the raw bucket counts
+std::string histogramJson(const LatencyHistogram::Snapshot& snapshot) {
+  std::ostringstream json;
+  json << "{\"count\":" << snapshot.count
+       << ",\"mean_ms\":" << snapshot.mean_seconds * 1000.0
+       << ",\"p50_ms\":" << snapshot.percentileSeconds(0.5) * 1000.0
+       << ",\"p99_ms\":" << snapshot.percentileSeconds(0.99) * 1000.0
+       << ",\"max_ms\":" << snapshot.max_seconds * 1000.0
+       << ",\"buckets\":[";
+  for (size_t i = 0; i < snapshot.buckets.size(); ++i) {
+    // Each bucket as [upper bound in us, count]; the last one is unbounded (-1)
+    const long long upper_us = i + 1 < snapshot.buckets.size()
+                                   ? static_cast<long long>(LatencyHistogram::bucketUpperSeconds(i) * 1e6 + 0.5)
+                                   : -1;
+    json << (i ? "," : "") << "[" << upper_us << "," << snapshot.buckets[i] << "]";
+  }
+  json << "]}";
+  return json.str();
+}
+
+// Render time over deadline as JSON, in percent, with the dropouts and raw bucket counts
+std::string renderLoadJson(const RenderLoad& load) {
+  const DeadlineHistogram::Snapshot& ratio = load.deadline_ratio;
+  std::ostringstream json;
+  json << "{\"overruns\":" << load.overruns
+       << ",\"underruns\":" << load.underruns
+       << ",\"count\":" << ratio.count
+       << ",\"mean_pct\":" << ratio.mean_ratio * 100.0
+       << ",\"p50_pct\":" << ratio.percentileRatio(0.5) * 100.0
+       << ",\"p99_pct\":" << ratio.percentileRatio(0.99) * 100.0
+       << ",\"max_pct\":" << ratio.max_ratio * 100.0
+       << ",\"buckets\":[";
+  for (size_t i = 0; i < ratio.buckets.size(); ++i) {
+    // Each bucket as [upper bound in percent, count]; the last one is unbounded (-1)
+    const long long upper_pct =
+        i + 1 < ratio.buckets.size() ? std::llround(DeadlineHistogram::bucketUpperRatio(i) * 100.0) : -1;
+    json << (i ? "," : "") << "[" << upper_pct << "," << ratio.buckets[i] << "]";
+  }
+  json << "]}";
+  return json.str();
+}
+
+// Input arrival to the device: the measured arrival-to-render time plus the fixed limiter
+// and output delays
+std::string roundTripJson(const EngineStats& stats) {
+  const double fixed_ms = (stats.limiter_latency_seconds + stats.output_latency_seconds) * 1000.0;
+  const LatencyHistogram::Snapshot& trigger = stats.trigger_latency;
+  std::ostringstream json;
+  json << "{\"count\":" << trigger.count
+       << ",\"mean_ms\":" << (trigger.count ? trigger.mean_seconds * 1000.0 + fixed_ms : 0.0)
+       << ",\"p99_ms\":" << (trigger.count ? trigger.percentileSeconds(0.99) * 1000.0 + fixed_ms : 0.0)
+       << ",\"max_ms\":" << (trigger.count ? trigger.max_seconds * 1000.0 + fixed_ms : 0.0) << "}";
+  return json.str();
+}
+
+// "on"/"off"/"1"/"0"; false if the word isn't a state
+bool parseState(const std::string& word, bool& state) {
+  if (word == "on" || word == "1" || word == "true") {
+    state = true;
+    return true;
+  }
+  if (word == "off" || word == "0" || word == "false") {
+    state = false;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+ControlApi::ControlApi(AudioProcessor& audio_processor, Sequencer& sequencer, PadBanks& banks)
+    : audio_processor_(audio_processor),
+      sequencer_(sequencer),
+      banks_(banks) {
+}
+
+std::string ControlApi::handle(const std::string& request) {
+  std::istringstream stream(request);
+  std::string command;
+  stream >> command;
+  std::string arguments;
+  std::getline(stream, arguments);
+
+  if (command == "trigger") return trigger(arguments);
+  if (command == "release") return release(arguments);
+  if (command == "seq") return sequencer(arguments);
+  if (command == "bank") return bank(arguments);
+  if (command == "reload") return reload(arguments);
+  if (command == "audio") return audio(arguments);
+  if (command == "stats") return stats();
+  if (command == "help") {
+    return "ok commands: trigger <pad> [velocity] [pitch], release <pad> [pitch], "
+           "seq record|play [on|off], seq status, seq tempo [bpm], bank [name|index], reload [pad], "
+           "audio [rate] [buffer] [periods], stats";
+  }
+  if (command.empty()) {
+    return "error empty request";
+  }
+  return "error unknown command '" + command + "' (try help)";
+}
+
+std::string ControlApi::trigger(const std::string& arguments) {
+  const auto received = std::chrono::steady_clock::now();
+
+  std::istringstream stream(arguments);
+  std::string name;
+  int velocity = 127;
+  double pitch = 0.0;
+  if (!(stream >> name)) {
+    return "error usage: trigger <pad> [velocity] [pitch]";
+  }
+  if (!(stream >> std::ws).eof() && !(stream >> velocity)) {
+    return "error velocity must be a number";
+  }
+  if (!(stream >> std::ws).eof() && !(stream >> pitch)) {
+    return "error pitch must be a number";
+  }
+  if (velocity < 1 || velocity > 127) {
+    return "error velocity must be 1-127";
+  }
+
+  const PadId pad = banks_.find(name);
+  if (pad == kNoPad || !audio_processor_.playSampleWithPitch(pad, pitch, velocity, received, {}, TriggerSource::Remote)) {
+    return "error no sample for '" + name + "' (or trigger queue full)";
+  }
+  sequencer_.recordPad(pad, pitch, velocity);
+  return "ok";
+}
+
+std::string ControlApi::release(const std::string& arguments) {
+  std::istringstream stream(arguments);
+  std::string name;
+  double pitch = 0.0;
+  if (!(stream >> name)) {
+    return "error usage: release <pad> [pitch]";
+  }
+  stream >> pitch;
+
+  const PadId pad = banks_.find(name);
+  if (pad == kNoPad) {
+    return "error no sample for '" + name + "'";
+  }
+  return audio_processor_.releaseSample(pad, pitch) ? "ok" : "error trigger queue full";
+}
+
+std::string ControlApi::sequencer(const std::string& arguments) {
+  std::istringstream stream(arguments);
+  std::string what;
+  std::string state_word;
+  stream >> what >> state_word;
+
+  if (what == "status") {
+    return std::string("ok recording=") + (sequencer_.isRecording() ? "on" : "off") +
+           " playing=" + (sequencer_.isPlaying() ? "on" : "off");
+  }
+  if (what == "tempo") {
+    if (!state_word.empty()) {
+      double bpm = 0.0;
+      std::istringstream value(state_word);
+      if (!(value >> bpm) || bpm <= 0.0) {
+        return "error tempo must be a positive BPM";
+      }
+      sequencer_.setTempo(bpm);
+    }
+    std::ostringstream reply;
+    reply << "ok tempo=" << sequencer_.tempo();
+    return reply.str();
+  }
+  if (what != "record" && what != "play") {
+    return "error usage: seq record|play [on|off], seq status, seq tempo [bpm]";
+  }
+
+  bool state = false;
+  const bool has_state = !state_word.empty();
+  if (has_state && !parseState(state_word, state)) {
+    return "error state must be on or off";
+  }
+
+  if (what == "record") {
+    if (!has_state || state != sequencer_.isRecording()) {
+      sequencer_.toggleRecording();
+    }
+    return std::string("ok recording=") + (sequencer_.isRecording() ? "on" : "off");
+  }
+
+  if (!has_state || state != sequencer_.isPlaying()) {
+    sequencer_.togglePlaying();
+  }
+  return std::string("ok playing=") + (sequencer_.isPlaying() ? "on" : "off");
+}
+
+std::string ControlApi::bank(const std::string& arguments) {
+  std::istringstream stream(arguments);
+  std::string name;
+  stream >> name;
+
+  if (!name.empty() && !banks_.selectBank(name)) {
+    return "error no bank '" + name + "'";
+  }
+  const size_t current = banks_.currentBank();
+  return "ok bank=" + banks_.bankName(current) + " index=" + std::to_string(current) +
+         " banks=" + std::to_string(banks_.bankCount());
+}
+
+std::string ControlApi::reload(const std::string& arguments) {
+  std::istringstream stream(arguments);
+  std::string name;
+  stream >> name;
+
+  if (!name.empty()) {
+    const PadId pad = banks_.find(name);
+    if (pad == kNoPad || !audio_processor_.reloadSample(pad)) {
+      return "error no sample for '" + name + "'";
+    }
+    return "ok reloaded 1";
+  }
+
+  size_t reloaded = 0;
+  for (PadId pad : audio_processor_.registeredPads()) {
+    reloaded += audio_processor_.reloadSample(pad);
+  }
+  return "ok reloaded " + std::to_string(reloaded);
+}
+
+std::string ControlApi::audio(const std::string& arguments) {
+  std::istringstream stream(arguments);
+  OutputSettings settings = audio_processor_.outputSettings();
+  if (!(stream >> std::ws).eof()) {
+    if (!(stream >> settings.sample_rate)) {
+      return "error usage: audio [rate] [buffer] [periods]";
+    }
+    if (!(stream >> std::ws).eof() && !(stream >> settings.buffer_frames)) {
+      return "error buffer must be a frame count";
+    }
+    if (!(stream >> std::ws).eof() && !(stream >> settings.periods)) {
+      return "error periods must be a number";
+    }
+    if (settings.sample_rate < OutputSettings::kMinSampleRate || settings.sample_rate > OutputSettings::kMaxSampleRate) {
+      return "error rate must be 8000-192000";
+    }
+    if (settings.buffer_frames < OutputSettings::kMinBufferFrames ||
+        settings.buffer_frames > OutputSettings::kMaxBufferFrames) {
+      return "error buffer must be 16-8192 frames";
+    }
+    if (settings.periods < OutputSettings::kMinPeriods || settings.periods > OutputSettings::kMaxPeriods) {
+      return "error periods must be 2-16";
+    }
+    if (!audio_processor_.setOutput(settings)) {
+      return "error failed to reopen the audio output";
+    }
+  }
+
+  const EngineStats stats = audio_processor_.stats();
+  std::ostringstream reply;
+  reply << "ok rate=" << stats.output.sample_rate << " buffer=" << stats.output.buffer_frames
+        << " periods=" << stats.output.periods << " output_latency_ms=" << stats.output_latency_seconds * 1000.0
+        << " limiter_latency_ms=" << stats.limiter_latency_seconds * 1000.0;
+  return reply.str();
+}
+
+std::string ControlApi::stats() const {
+  const EngineStats stats = audio_processor_.stats();
+
+  std::ostringstream json;
+  json << "{\"voices\":" << stats.active_voices
+       << ",\"xruns\":" << stats.late_renders
+       << ",\"dropped_notes\":" << stats.dropped_notes
+       << ",\"samples\":" << stats.registered_samples
+       << ",\"pitch_cache_bytes\":" << stats.pitch_cache_bytes
+       << ",\"output\":{\"backend\":\"" << outputBackendName(stats.output.backend) << "\""
+       << ",\"sample_rate\":" << stats.output.sample_rate
+       << ",\"buffer_frames\":" << stats.output.buffer_frames
+       << ",\"periods\":" << stats.output.periods << "}"
+       << ",\"output_latency_ms\":" << stats.output_latency_seconds * 1000.0
+       << ",\"limiter_latency_ms\":" << stats.limiter_latency_seconds * 1000.0
+       << ",\"round_trip_ms\":" << roundTripJson(stats)
+       << ",\"render_time\":" << histogramJson(stats.render_time)
+       << ",\"deadline\":" << renderLoadJson(stats.load)
+       << ",\"trigger_latency\":" << histogramJson(stats.trigger_latency)
+       << ",\"midi_latency\":" << histogramJson(stats.midi_latency)
+       << ",\"reverb_time\":" << histogramJson(stats.reverb_time)
+       << ",\"delay_time\":" << histogramJson(stats.delay_time)
+       << "}";
+  return json.str();
+}
+
+}  // namespace mpccli
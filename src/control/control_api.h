@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include "../audio-processor/audio_processor.h"
+#include "../kit/pad_banks.h"
+#include "../sequencer/sequencer.h"
+
+namespace mpccli {
+
+// Text commands for the control socket. Every request gets a one-line reply:
+// "ok ...", "error ..." or a JSON object (stats).
+//
+// Pads are named by sample name or by key in the current bank.
+//
+//   trigger <pad> [velocity] [pitch]   play a sample (recorded like a key press)
+//   release <pad> [pitch]              note-off
+//   seq record|play [on|off]           toggle, or set, recording/playback
+//   seq status                         recording/playback state
+//   seq tempo [bpm]                    set, or show, the tempo synced effects follow
+//   bank [name|index]                  switch banks, or show the current one
+//   reload [pad]                       decode one pad (or every pad) from disk again
+//   audio [rate] [buffer] [periods]    reopen the output with new settings, or show them
+//   stats                              voices, xruns, render, effect and latency histograms
+//   help                               list commands
+//
+// Commands only reach the audio thread through the engine's lock-free trigger queue
+// and its atomic counters.
+class ControlApi {
+ public:
+  ControlApi(AudioProcessor& audio_processor, Sequencer& sequencer, PadBanks& banks);
+
+  std::string handle(const std::string& request);
+
+ private:
+  std::string trigger(const std::string& arguments);
+  std::string release(const std::string& arguments);
+  std::string sequencer(const std::string& arguments);
+  std::string bank(const std::string& arguments);
+  std::string reload(const std::string& arguments);
+  std::string audio(const std::string& arguments);
+  std::string stats() const;
+
+  AudioProcessor& audio_processor_;
+  Sequencer& sequencer_;
+  PadBanks& banks_;
+};
+
+}  // namespace mpccli
@@ -0,0 +1,217 @@
+#include "control_server.h"
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// macOS has no MSG_NOSIGNAL; SO_NOSIGPIPE is set on each client socket instead
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace mpccli {
+
+ControlServer::ControlServer(std::string path, ControlRequestHandler handler)
+    : path_(std::move(path)),
+      handler_(std::move(handler)),
+      listen_fd_(-1),
+      running_(false) {
+  stop_pipe_[0] = -1;
+  stop_pipe_[1] = -1;
+}
+
+ControlServer::~ControlServer() {
+  stop();
+}
+
+bool ControlServer::start() {
+  if (running_) {
+    return true;
+  }
+
+  sockaddr_un address{};
+  if (path_.size() >= sizeof(address.sun_path)) {
+    std::cerr << "Control socket path too long: " << path_ << std::endl;
+    return false;
+  }
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, path_.c_str(), sizeof(address.sun_path) - 1);
+
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) {
+    std::cerr << "Failed to create control socket: " << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  // A socket file left behind by a previous run would make bind() fail. Anything else
+  // at the path is the user's, and a socket something still accepts on is another
+  // instance's, so only a socket that refuses connections is replaced.
+  struct stat existing;
+  if (lstat(path_.c_str(), &existing) == 0) {
+    if (!S_ISSOCK(existing.st_mode)) {
+      std::cerr << "Not replacing " << path_ << " with the control socket: it is not a socket" << std::endl;
+      close(listen_fd_);
+      listen_fd_ = -1;
+      return false;
+    }
+    std::string reason;
+    const int probe_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe_fd < 0) {
+      reason = std::strerror(errno);
+    } else {
+      if (connect(probe_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+        reason = "another instance is listening on it";
+      } else if (errno != ECONNREFUSED) {
+        reason = std::strerror(errno);
+      }
+      close(probe_fd);
+    }
+    if (!reason.empty()) {
+      std::cerr << "Not replacing control socket " << path_ << ": " << reason << std::endl;
+      close(listen_fd_);
+      listen_fd_ = -1;
+      return false;
+    }
+    unlink(path_.c_str());
+  }
+  if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+      listen(listen_fd_, static_cast<int>(kMaxClients)) != 0 || pipe(stop_pipe_) != 0) {
+    std::cerr << "Failed to listen on " << path_ << ": " << std::strerror(errno) << std::endl;
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+
+  std::cout << "Control socket listening on " << path_ << std::endl;
+
+  running_ = true;
+  thread_ = std::thread([this]() { serveLoop(); });
+  return true;
+}
+
+void ControlServer::stop() {
+  if (!running_) {
+    return;
+  }
+  running_ = false;
+
+  // Wake the poll() in serveLoop
+  const char wake = 0;
+  (void)write(stop_pipe_[1], &wake, 1);
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+
+  close(listen_fd_);
+  close(stop_pipe_[0]);
+  close(stop_pipe_[1]);
+  listen_fd_ = -1;
+  stop_pipe_[0] = -1;
+  stop_pipe_[1] = -1;
+  unlink(path_.c_str());
+}
+
+void ControlServer::serveLoop() {
+  std::array<Client, kMaxClients> clients;
+  std::vector<pollfd> fds;
+
+  while (running_) {
+    // Listening socket, stop pipe, then one entry per connected client
+    fds.clear();
+    fds.push_back({listen_fd_, POLLIN, 0});
+    fds.push_back({stop_pipe_[0], POLLIN, 0});
+    for (const Client& client : clients) {
+      if (client.fd >= 0) {
+        fds.push_back({client.fd, POLLIN, 0});
+      }
+    }
+
+    if (poll(fds.data(), fds.size(), -1) < 0) {
+      continue;  // Interrupted by a signal
+    }
+    if (!running_) {
+      break;
+    }
+
+    // Serve existing clients before accepting, so fds and clients stay in step
+    size_t next_fd = 2;
+    for (Client& client : clients) {
+      if (client.fd < 0) {
+        continue;
+      }
+      const short events = fds[next_fd++].revents;
+      if (events && !serviceClient(client)) {
+        close(client.fd);
+        client.fd = -1;
+        client.pending.clear();
+      }
+    }
+
+    if (fds[0].revents & POLLIN) {
+      const int fd = accept(listen_fd_, nullptr, nullptr);
+      if (fd >= 0) {
+        Client* free_slot = nullptr;
+        for (Client& client : clients) {
+          if (client.fd < 0) {
+            free_slot = &client;
+            break;
+          }
+        }
+        if (free_slot) {
+#ifdef SO_NOSIGPIPE
+          int on = 1;
+          setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+          free_slot->fd = fd;
+        } else {
+          const char busy[] = "error too many clients\n";
+          (void)send(fd, busy, sizeof(busy) - 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+          close(fd);
+        }
+      }
+    }
+  }
+
+  for (Client& client : clients) {
+    if (client.fd >= 0) {
+      close(client.fd);
+    }
+  }
+}
+
+bool ControlServer::serviceClient(Client& client) {
+  char buffer[1024];
+  const ssize_t size = read(client.fd, buffer, sizeof(buffer));
+  if (size <= 0) {
+    return false;
+  }
+  client.pending.append(buffer, static_cast<size_t>(size));
+
+  size_t newline;
+  while ((newline = client.pending.find('\n')) != std::string::npos) {
+    std::string request = client.pending.substr(0, newline);
+    client.pending.erase(0, newline + 1);
+    if (!request.empty() && request.back() == '\r') {
+      request.pop_back();
+    }
+
+    std::string reply = handler_ ? handler_(request) : "error no handler";
+    reply += '\n';
+    // Every client is served from this thread, so one that doesn't read its replies is
+    // dropped once its socket buffer is full rather than stalling the others
+    if (send(client.fd, reply.data(), reply.size(), MSG_DONTWAIT | MSG_NOSIGNAL) !=
+        static_cast<ssize_t>(reply.size())) {
+      return false;
+    }
+  }
+
+  return client.pending.size() <= kMaxRequestBytes;
+}
+
+}  // namespace mpccli
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace mpccli {
+
+// Handles one request line and returns the reply (a single line, without the newline)
+using ControlRequestHandler = std::function<std::string(const std::string& request)>;
+
+// Line-oriented request/response server on a Unix domain socket.
+// Each newline-terminated request gets exactly one newline-terminated reply, so it can be
+// driven with `socat - UNIX-CONNECT:<path>` or `nc -U <path>`. Requests are handled one at
+// a time on the server thread; a few clients may be connected at once.
+class ControlServer {
+ public:
+  static constexpr size_t kMaxClients = 8;
+  static constexpr size_t kMaxRequestBytes = 4096;  // Longer lines drop the client
+
+  ControlServer(std::string path, ControlRequestHandler handler);
+  ~ControlServer();
+
+  ControlServer(const ControlServer&) = delete;
+  ControlServer& operator=(const ControlServer&) = delete;
+
+  // Create the socket (replacing a stale one) and start serving. Returns false on failure.
+  bool start();
+
+  // Stop serving, disconnect clients and remove the socket file
+  void stop();
+
+  const std::string& path() const { return path_; }
+
+ private:
+  struct Client {
+    int fd = -1;
+    std::string pending;  // Bytes received after the last complete line
+  };
+
+  void serveLoop();
+
+  // Read from a client and answer every complete line; false once it should be closed
+  bool serviceClient(Client& client);
+
+  std::string path_;
+  ControlRequestHandler handler_;
+  int listen_fd_;
+  int stop_pipe_[2];
+  std::atomic<bool> running_;
+  std::thread thread_;
+};
+
+}  // namespace mpccli
@@ -0,0 +1,177 @@
+#include "osc.h"
+#include <cstring>
+
+namespace mpccli {
+
+namespace {
+
+// Seconds between the NTP epoch (1900) and the Unix epoch (1970)
+constexpr uint64_t kNtpToUnixSeconds = 2208988800ULL;
+
+uint32_t readUint32(const char* data) {
+  const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+  return (uint32_t{bytes[0]} << 24) | (uint32_t{bytes[1]} << 16) | (uint32_t{bytes[2]} << 8) | uint32_t{bytes[3]};
+}
+
+uint64_t readUint64(const char* data) {
+  return (uint64_t{readUint32(data)} << 32) | readUint32(data + 4);
+}
+
+// Length of a padded OSC string starting at `offset`, or 0 if it is unterminated
+size_t paddedStringSize(const char* data, size_t size, size_t offset) {
+  const void* end = std::memchr(data + offset, '\0', size - offset);
+  if (!end) {
+    return 0;
+  }
+  const size_t length = static_cast<const char*>(end) - (data + offset);
+  return (length + 4) & ~size_t{3};
+}
+
+}  // namespace
+
+bool OscMessage::getInt(size_t index, int64_t& value) const {
+  if (index >= argument_count) {
+    return false;
+  }
+  const OscArgument& arg = arguments[index];
+  switch (arg.type) {
+    case 'i': case 'h': case 'c': case 'T': case 'F':
+      value = arg.int_value;
+      return true;
+    case 'f': case 'd':
+      value = static_cast<int64_t>(arg.float_value);
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool OscMessage::getFloat(size_t index, double& value) const {
+  if (index >= argument_count) {
+    return false;
+  }
+  const OscArgument& arg = arguments[index];
+  switch (arg.type) {
+    case 'f': case 'd':
+      value = arg.float_value;
+      return true;
+    case 'i': case 'h': case 'T': case 'F':
+      value = static_cast<double>(arg.int_value);
+      return true;
+    default:
+      return false;
+  }
+}
+
+const char* OscMessage::getString(size_t index) const {
+  if (index >= argument_count) {
+    return nullptr;
+  }
+  const OscArgument& arg = arguments[index];
+  return arg.type == 's' || arg.type == 'S' ? arg.string_value : nullptr;
+}
+
+bool parseOscMessage(const char* data, size_t size, OscMessage& message) {
+  if (size < 4 || size % 4 != 0 || data[0] != '/') {
+    return false;
+  }
+
+  size_t offset = paddedStringSize(data, size, 0);
+  if (offset == 0) {
+    return false;
+  }
+  message.address = data;
+  message.argument_count = 0;
+
+  // Messages without a type tag string have no arguments
+  if (offset == size) {
+    return true;
+  }
+  if (data[offset] != ',') {
+    return false;
+  }
+  const char* tags = data + offset + 1;
+  const size_t tags_size = paddedStringSize(data, size, offset);
+  if (tags_size == 0) {
+    return false;
+  }
+  offset += tags_size;
+
+  for (const char* tag = tags; *tag; ++tag) {
+    OscArgument arg;
+    arg.type = *tag;
+
+    switch (*tag) {
+      case 'i': case 'c': case 'r': case 'm':
+        if (offset + 4 > size) return false;
+        arg.int_value = static_cast<int32_t>(readUint32(data + offset));
+        offset += 4;
+        break;
+      case 'f': {
+        if (offset + 4 > size) return false;
+        const uint32_t bits = readUint32(data + offset);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        arg.float_value = value;
+        offset += 4;
+        break;
+      }
+      case 'h': case 't':
+        if (offset + 8 > size) return false;
+        arg.int_value = static_cast<int64_t>(readUint64(data + offset));
+        offset += 8;
+        break;
+      case 'd': {
+        if (offset + 8 > size) return false;
+        const uint64_t bits = readUint64(data + offset);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        arg.float_value = value;
+        offset += 8;
+        break;
+      }
+      case 's': case 'S': {
+        const size_t string_size = offset < size ? paddedStringSize(data, size, offset) : 0;
+        if (string_size == 0) return false;
+        arg.string_value = data + offset;
+        offset += string_size;
+        break;
+      }
+      case 'b': {
+        if (offset + 4 > size) return false;
+        const size_t blob_size = (readUint32(data + offset) + size_t{3}) & ~size_t{3};
+        if (blob_size > size - offset - 4) return false;
+        offset += 4 + blob_size;
+        break;
+      }
+      case 'T':
+        arg.int_value = 1;
+        break;
+      case 'F': case 'N': case 'I':
+        break;
+      default:
+        // Unknown type: its size is unknown, so nothing after it can be read
+        return false;
+    }
+
+    if (message.argument_count < OscMessage::kMaxArguments) {
+      message.arguments[message.argument_count++] = arg;
+    }
+  }
+  return true;
+}
+
+std::chrono::steady_clock::time_point oscTimetagToSteady(uint64_t timetag) {
+  if (timetag <= kOscImmediately) {
+    return {};
+  }
+
+  const double unix_seconds = static_cast<double>(timetag >> 32) - static_cast<double>(kNtpToUnixSeconds) +
+                              static_cast<double>(timetag & 0xFFFFFFFFULL) / 4294967296.0;
+  const double now_unix = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+  const auto delta = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(unix_seconds - now_unix));
+  return std::chrono::steady_clock::now() + delta;
+}
+
+}  // namespace mpccli
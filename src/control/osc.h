@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace mpccli {
+
+// OSC 1.0 decoding straight out of the receive buffer. Messages are read-only views:
+// strings point into the packet, arguments are kept in a fixed-size array, and nothing
+// is copied or allocated, so the buffer must outlive the message.
+
+// Timetag meaning "as soon as possible"
+constexpr uint64_t kOscImmediately = 1;
+
+struct OscArgument {
+  char type = 0;           // OSC type tag (i, f, s, d, h, T, F, N, ...)
+  int64_t int_value = 0;   // i, h, c (and T/F as 1/0)
+  double float_value = 0;  // f, d
+  const char* string_value = nullptr;  // s, S
+};
+
+struct OscMessage {
+  static constexpr size_t kMaxArguments = 8;  // Extra arguments are ignored
+
+  const char* address = nullptr;
+  size_t argument_count = 0;
+  std::array<OscArgument, kMaxArguments> arguments;
+
+  // Numeric argument as int/float (accepts i, h, f, d, T and F), false if missing or not numeric
+  bool getInt(size_t index, int64_t& value) const;
+  bool getFloat(size_t index, double& value) const;
+
+  // String argument (s or S), nullptr if missing or not a string
+  const char* getString(size_t index) const;
+};
+
+// Decode one message (not a bundle). Returns false if the data is malformed.
+bool parseOscMessage(const char* data, size_t size, OscMessage& message);
+
+// Steady-clock time for an OSC (NTP) timetag; the epoch value for kOscImmediately
+std::chrono::steady_clock::time_point oscTimetagToSteady(uint64_t timetag);
+
+// Decode a packet, calling handler(const OscMessage&, uint64_t timetag) for every message,
+// including those nested in bundles (a bare message gets kOscImmediately).
+// Returns false if the packet is malformed; messages before the error are still delivered.
+template <typename Handler>
+bool parseOscPacket(const char* data, size_t size, Handler&& handler, uint64_t timetag = kOscImmediately,
+                    int depth = 0) {
+  constexpr char kBundleTag[] = "#bundle";
+  constexpr size_t kBundleHeader = 16;  // "#bundle\0" + 8-byte timetag
+  constexpr int kMaxDepth = 4;
+
+  if (size >= kBundleHeader && std::memcmp(data, kBundleTag, sizeof(kBundleTag)) == 0) {
+    if (depth >= kMaxDepth) {
+      return false;
+    }
+
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    uint64_t bundle_timetag = 0;
+    for (size_t i = 8; i < 16; ++i) {
+      bundle_timetag = (bundle_timetag << 8) | bytes[i];
+    }
+
+    // Elements: 4-byte big-endian size followed by a message or nested bundle
+    size_t offset = kBundleHeader;
+    while (offset + 4 <= size) {
+      const uint32_t element_size = (uint32_t{bytes[offset]} << 24) | (uint32_t{bytes[offset + 1]} << 16) |
+                                    (uint32_t{bytes[offset + 2]} << 8) | uint32_t{bytes[offset + 3]};
+      offset += 4;
+      if (element_size > size - offset || element_size % 4 != 0) {
+        return false;
+      }
+      if (!parseOscPacket(data + offset, element_size, handler, bundle_timetag, depth + 1)) {
+        return false;
+      }
+      offset += element_size;
+    }
+    return offset == size;
+  }
+
+  OscMessage message;
+  if (!parseOscMessage(data, size, message)) {
+    return false;
+  }
+  handler(static_cast<const OscMessage&>(message), timetag);
+  return true;
+}
+
+}  // namespace mpccli
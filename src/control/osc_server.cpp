@@ -0,0 +1,179 @@
+#include "osc_server.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+
+namespace mpccli {
+
+OscServer::OscServer(int port)
+    : port_(port),
+      socket_(-1),
+      running_(false) {
+  stop_pipe_[0] = -1;
+  stop_pipe_[1] = -1;
+}
+
+OscServer::~OscServer() {
+  stop();
+}
+
+void OscServer::setTriggerCallback(OscTriggerCallback callback) {
+  trigger_callback_ = callback;
+}
+
+void OscServer::setRecordCallback(OscToggleCallback callback) {
+  record_callback_ = callback;
+}
+
+void OscServer::setPlayCallback(OscToggleCallback callback) {
+  play_callback_ = callback;
+}
+
+void OscServer::setBankCallback(OscBankCallback callback) {
+  bank_callback_ = callback;
+}
+
+bool OscServer::start() {
+  if (running_) {
+    return true;
+  }
+
+  socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+  if (socket_ < 0) {
+    std::cerr << "Failed to create OSC socket: " << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  // Local tools only: never listen on external interfaces
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(static_cast<uint16_t>(port_));
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || pipe(stop_pipe_) != 0) {
+    std::cerr << "Failed to bind OSC port " << port_ << ": " << std::strerror(errno) << std::endl;
+    close(socket_);
+    socket_ = -1;
+    return false;
+  }
+
+  std::cout << "OSC server listening on 127.0.0.1:" << port_ << " (UDP)" << std::endl;
+
+  running_ = true;
+  thread_ = std::thread([this]() { receiveLoop(); });
+  return true;
+}
+
+void OscServer::stop() {
+  if (!running_) {
+    return;
+  }
+  running_ = false;
+
+  // Wake the poll() in receiveLoop
+  const char wake = 0;
+  (void)write(stop_pipe_[1], &wake, 1);
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+
+  close(socket_);
+  close(stop_pipe_[0]);
+  close(stop_pipe_[1]);
+  socket_ = -1;
+  stop_pipe_[0] = -1;
+  stop_pipe_[1] = -1;
+}
+
+void OscServer::receiveLoop() {
+  pollfd fds[2] = {{socket_, POLLIN, 0}, {stop_pipe_[0], POLLIN, 0}};
+
+  while (running_) {
+    if (poll(fds, 2, -1) < 0 || !(fds[0].revents & POLLIN)) {
+      continue;
+    }
+
+    const ssize_t size = recv(socket_, buffer_.data(), buffer_.size(), 0);
+    if (size <= 0) {
+      continue;
+    }
+    const auto received = std::chrono::steady_clock::now();
+
+    const bool ok = parseOscPacket(buffer_.data(), static_cast<size_t>(size),
+                                   [this, received](const OscMessage& message, uint64_t timetag) {
+                                     dispatch(message, timetag, received);
+                                   });
+    if (!ok) {
+      std::cerr << "Ignoring malformed OSC packet (" << size << " bytes)" << std::endl;
+    }
+  }
+}
+
+void OscServer::dispatch(const OscMessage& message, uint64_t timetag,
+                         std::chrono::steady_clock::time_point received) {
+  if (std::strcmp(message.address, "/trigger") == 0) {
+    // Pad as a sample name or key, or a key's character code
+    std::string_view pad;
+    char key = 0;
+    int64_t code = 0;
+    if (const char* pad_string = message.getString(0)) {
+      pad = pad_string;
+    } else if (message.getInt(0, code) && code > 0 && code < 256) {
+      key = static_cast<char>(code);
+      pad = std::string_view(&key, 1);
+    }
+    if (pad.empty() || !trigger_callback_) {
+      return;
+    }
+
+    int64_t velocity = 127;
+    message.getInt(1, velocity);
+    double pitch = 0.0;
+    message.getFloat(2, pitch);
+
+    if (velocity > 0) {
+      trigger_callback_(pad, static_cast<int>(std::min<int64_t>(velocity, 127)), pitch, received,
+                        oscTimetagToSteady(timetag));
+    }
+    return;
+  }
+
+  if (std::strcmp(message.address, "/bank") == 0) {
+    // Bank as a name or an index
+    char digits[24];
+    std::string_view bank;
+    int64_t index = 0;
+    if (const char* name = message.getString(0)) {
+      bank = name;
+    } else if (message.getInt(0, index)) {
+      bank = std::string_view(digits, std::to_chars(digits, digits + sizeof(digits), index).ptr - digits);
+    }
+    if (!bank.empty() && bank_callback_) {
+      bank_callback_(bank);
+    }
+    return;
+  }
+
+  const bool is_record = std::strcmp(message.address, "/seq/record") == 0;
+  const bool is_play = std::strcmp(message.address, "/seq/play") == 0;
+  if (is_record || is_play) {
+    std::optional<bool> state;
+    int64_t value = 0;
+    if (message.getInt(0, value)) {
+      state = value != 0;
+    }
+
+    const OscToggleCallback& callback = is_record ? record_callback_ : play_callback_;
+    if (callback) {
+      callback(state);
+    }
+  }
+}
+
+}  // namespace mpccli
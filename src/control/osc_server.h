@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include "osc.h"
+
+namespace mpccli {
+
+// Callback type for /trigger
+// Parameters: pad (sample name or key, valid during the call), int velocity (1-127),
+// double pitch (semitones), time the packet arrived, time the note should sound (epoch = immediately)
+using OscTriggerCallback = std::function<void(std::string_view pad, int velocity, double pitch,
+                                              std::chrono::steady_clock::time_point received,
+                                              std::chrono::steady_clock::time_point play_at)>;
+
+// Callback type for /bank
+// Parameter: bank name or index (valid during the call)
+using OscBankCallback = std::function<void(std::string_view bank)>;
+
+// Callback type for /seq/record and /seq/play
+// Parameter: requested state, or nullopt to toggle
+using OscToggleCallback = std::function<void(std::optional<bool> state)>;
+
+// OSC-over-UDP control server bound to localhost.
+//
+//   /trigger pad [velocity] [pitch]   sample name ("snare"), key in the current bank ("a") or
+//                                     character code; velocity 1-127 (default 127); pitch in
+//                                     semitones (default 0)
+//   /bank bank                        switch banks, by name or index (from 0)
+//   /seq/record [state]               toggle, or set recording on (1/T) or off (0/F)
+//   /seq/play [state]                 toggle, or set playback on/off
+//
+// Triggers inside bundles are scheduled for the bundle's timetag; sequencer commands
+// apply on arrival. Packets are decoded in the receive buffer without allocating.
+class OscServer {
+ public:
+  explicit OscServer(int port);
+  ~OscServer();
+
+  OscServer(const OscServer&) = delete;
+  OscServer& operator=(const OscServer&) = delete;
+
+  void setTriggerCallback(OscTriggerCallback callback);
+  void setRecordCallback(OscToggleCallback callback);
+  void setPlayCallback(OscToggleCallback callback);
+  void setBankCallback(OscBankCallback callback);
+
+  // Bind 127.0.0.1:port and start the receive thread. Returns false if the port is unavailable.
+  bool start();
+
+  // Stop the receive thread (no callbacks are made once this returns)
+  void stop();
+
+  int port() const { return port_; }
+
+ private:
+  void receiveLoop();
+  void dispatch(const OscMessage& message, uint64_t timetag, std::chrono::steady_clock::time_point received);
+
+  int port_;
+  int socket_;
+  int stop_pipe_[2];
+  std::atomic<bool> running_;
+  std::thread thread_;
+
+  OscTriggerCallback trigger_callback_;
+  OscToggleCallback record_callback_;
+  OscToggleCallback play_callback_;
+  OscBankCallback bank_callback_;
+
+  // Largest UDP payload; packets are decoded in place
+  std::array<char, 65536> buffer_;
+};
+
+}  // namespace mpccli
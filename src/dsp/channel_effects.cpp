@@ -0,0 +1,242 @@
+#include "channel_effects.h"
+#include <algorithm>
+#include <cmath>
+#include "simd.h"
+
+namespace mpccli {
+
+namespace {
+
+using namespace simd;
+
+constexpr float kPi = 3.14159265358979f;
+constexpr float kMinLevel = 1e-6f;  // -120 dB, floor for the compressor's level detector
+constexpr float kDenormal = 1e-15f;
+constexpr float kSettledLevel = 1e-5f;  // -100 dB, filter state treated as silence
+
+float dbToGain(float db) {
+  return std::pow(10.0f, db / 20.0f);
+}
+
+// Rational approximation of tanh, exact at +-3 and clamped beyond
+inline float softClip(float x) {
+  x = std::clamp(x, -3.0f, 3.0f);
+  const float x2 = x * x;
+  return x * (27.0f + x2) / (27.0f + 9.0f * x2);
+}
+
+inline Vec softClip(Vec x) {
+  x = min(max(x, splat(-3.0f)), splat(3.0f));
+  const Vec x2 = mul(x, x);
+  return div(mul(x, add(splat(27.0f), x2)), add(splat(27.0f), mul(splat(9.0f), x2)));
+}
+
+// The filter for N channels, all of a frame's channels in one vector
+template <int N>
+void svf(float* buffer, size_t frames, float a1, float a2, float a3, float m0, float m1, float m2, float* ic1_state,
+         float* ic2_state) {
+  const Vec va1 = splat(a1);
+  const Vec va2 = splat(a2);
+  const Vec va3 = splat(a3);
+  const Vec vm0 = splat(m0);
+  const Vec vm1 = splat(m1);
+  const Vec vm2 = splat(m2);
+  const Vec two = splat(2.0f);
+  Vec ic1 = load(ic1_state);
+  Vec ic2 = load(ic2_state);
+
+  for (size_t f = 0; f < frames; ++f) {
+    float* frame = buffer + f * N;
+    const Vec v0 = loadFrame<N>(frame);
+    const Vec v3 = sub(v0, ic2);
+    const Vec v1 = add(mul(va1, ic1), mul(va2, v3));
+    const Vec v2 = add(add(ic2, mul(va2, ic1)), mul(va3, v3));
+    ic1 = sub(mul(two, v1), ic1);
+    ic2 = sub(mul(two, v2), ic2);
+    storeFrame<N>(frame, add(add(mul(vm0, v0), mul(vm1, v1)), mul(vm2, v2)));
+  }
+
+  store(ic1_state, ic1);
+  store(ic2_state, ic2);
+}
+
+}  // namespace
+
+const char* filterTypeName(FilterType type) {
+  switch (type) {
+    case FilterType::Off: return "off";
+    case FilterType::LowPass: return "lowpass";
+    case FilterType::HighPass: return "highpass";
+    case FilterType::BandPass: return "bandpass";
+  }
+  return "unknown";
+}
+
+bool parseFilterType(const std::string& name, FilterType& type) {
+  if (name == "lowpass") {
+    type = FilterType::LowPass;
+  } else if (name == "highpass") {
+    type = FilterType::HighPass;
+  } else if (name == "bandpass") {
+    type = FilterType::BandPass;
+  } else if (name == "off") {
+    type = FilterType::Off;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+ChannelEffects::ChannelEffects(const ChannelEffectParams& params, double sample_rate, int channels)
+    : channels_(std::clamp(channels, 1, kMaxChannels)),
+      filter_on_(params.filter.type != FilterType::Off),
+      compressor_on_(params.compressor.enabled),
+      saturator_on_(params.saturator.enabled),
+      a1_(0.0f), a2_(0.0f), a3_(0.0f),
+      m0_(1.0f), m1_(0.0f), m2_(0.0f),
+      attack_coeff_(1.0f),
+      release_coeff_(1.0f),
+      threshold_db_(params.compressor.threshold_db),
+      slope_(1.0f - 1.0f / std::max(params.compressor.ratio, 1.0f)),
+      makeup_db_(params.compressor.makeup_db),
+      drive_(dbToGain(params.saturator.drive_db)),
+      mix_(std::clamp(params.saturator.mix, 0.0f, 1.0f)) {
+  // Trapezoidal state-variable filter (Simper): stable at any cutoff below Nyquist
+  const float cutoff = std::clamp(params.filter.cutoff_hz, 10.0f, static_cast<float>(sample_rate * 0.49));
+  const float g = std::tan(kPi * cutoff / static_cast<float>(sample_rate));
+  const float k = 1.0f / std::max(params.filter.resonance, 0.1f);
+  a1_ = 1.0f / (1.0f + g * (g + k));
+  a2_ = g * a1_;
+  a3_ = g * a2_;
+  switch (params.filter.type) {
+    case FilterType::LowPass: m0_ = 0.0f; m1_ = 0.0f; m2_ = 1.0f; break;
+    case FilterType::HighPass: m0_ = 1.0f; m1_ = -k; m2_ = -1.0f; break;
+    case FilterType::BandPass: m0_ = 0.0f; m1_ = 1.0f; m2_ = 0.0f; break;
+    case FilterType::Off: break;
+  }
+
+  // One-pole envelope follower stepped once per control block
+  auto coefficient = [sample_rate](float ms) {
+    const double frames = std::max(ms, 0.01f) * 1e-3 * sample_rate;
+    return static_cast<float>(1.0 - std::exp(-static_cast<double>(kControlFrames) / frames));
+  };
+  attack_coeff_ = coefficient(params.compressor.attack_ms);
+  release_coeff_ = coefficient(params.compressor.release_ms);
+
+  reset();
+}
+
+void ChannelEffects::reset() {
+  std::fill(std::begin(ic1_), std::end(ic1_), 0.0f);
+  std::fill(std::begin(ic2_), std::end(ic2_), 0.0f);
+  envelope_ = 0.0f;
+  gain_ = dbToGain(makeup_db_);
+}
+
+bool ChannelEffects::settled() const {
+  for (int c = 0; c < channels_; ++c) {
+    if (std::fabs(ic1_[c]) > kSettledLevel || std::fabs(ic2_[c]) > kSettledLevel) {
+      return false;
+    }
+  }
+  return !compressor_on_ || 20.0f * std::log10(std::max(envelope_, kMinLevel)) < threshold_db_;
+}
+
+void ChannelEffects::process(float* buffer, size_t frames) {
+  if (filter_on_) {
+    filter(buffer, frames);
+  }
+  if (compressor_on_) {
+    compress(buffer, frames);
+  }
+  if (saturator_on_) {
+    saturate(buffer, frames);
+  }
+}
+
+void ChannelEffects::filter(float* buffer, size_t frames) {
+  switch (channels_) {
+    case 1: svf<1>(buffer, frames, a1_, a2_, a3_, m0_, m1_, m2_, ic1_, ic2_); break;
+    case 2: svf<2>(buffer, frames, a1_, a2_, a3_, m0_, m1_, m2_, ic1_, ic2_); break;
+    case 3: svf<3>(buffer, frames, a1_, a2_, a3_, m0_, m1_, m2_, ic1_, ic2_); break;
+    default: svf<4>(buffer, frames, a1_, a2_, a3_, m0_, m1_, m2_, ic1_, ic2_); break;
+  }
+
+  // Keep a decaying tail out of denormals
+  for (int c = 0; c < kMaxChannels; ++c) {
+    if (std::fabs(ic1_[c]) < kDenormal) {
+      ic1_[c] = 0.0f;
+    }
+    if (std::fabs(ic2_[c]) < kDenormal) {
+      ic2_[c] = 0.0f;
+    }
+  }
+}
+
+void ChannelEffects::compress(float* buffer, size_t frames) {
+  // Vectors hold whole frames when the channel count divides 4; otherwise ramp per sample
+  const bool vector_ramp = 4 % channels_ == 0;
+  const float frames_per_vector = static_cast<float>(4 / channels_);
+  alignas(16) float lane_frames[4];
+  for (int lane = 0; lane < 4; ++lane) {
+    lane_frames[lane] = static_cast<float>(lane / channels_);
+  }
+  const Vec lane_offsets = load(lane_frames);
+
+  for (size_t start = 0; start < frames; start += kControlFrames) {
+    const size_t n = std::min(kControlFrames, frames - start);
+    float* block = buffer + start * channels_;
+    const size_t samples = n * channels_;
+
+    // Peak of the control block across all channels
+    size_t i = 0;
+    Vec peak_vec = splat(0.0f);
+    for (; i + 4 <= samples; i += 4) {
+      peak_vec = max(peak_vec, abs(load(block + i)));
+    }
+    float peak = maxLane(peak_vec);
+    for (; i < samples; ++i) {
+      peak = std::max(peak, std::fabs(block[i]));
+    }
+
+    // Envelope, then the gain computer (hard knee) in dB
+    envelope_ += (peak > envelope_ ? attack_coeff_ : release_coeff_) * (peak - envelope_);
+    const float level_db = 20.0f * std::log10(std::max(envelope_, kMinLevel));
+    const float over = level_db - threshold_db_;
+    const float target = dbToGain(makeup_db_ - (over > 0.0f ? over * slope_ : 0.0f));
+
+    // Ramp from the previous gain to the new one across the block
+    const float increment = (target - gain_) / static_cast<float>(n);
+    i = 0;
+    if (vector_ramp) {
+      Vec gain = add(splat(gain_), mul(lane_offsets, splat(increment)));
+      const Vec step = splat(increment * frames_per_vector);
+      for (; i + 4 <= samples; i += 4) {
+        store(block + i, mul(load(block + i), gain));
+        gain = add(gain, step);
+      }
+    }
+    for (; i < samples; ++i) {
+      block[i] *= gain_ + increment * static_cast<float>(i / channels_);
+    }
+    gain_ = target;
+  }
+}
+
+void ChannelEffects::saturate(float* buffer, size_t frames) {
+  const size_t samples = frames * channels_;
+  const Vec drive = splat(drive_);
+  const Vec mix = splat(mix_);
+  size_t i = 0;
+  for (; i + 4 <= samples; i += 4) {
+    const Vec dry = load(buffer + i);
+    const Vec wet = softClip(mul(dry, drive));
+    store(buffer + i, add(dry, mul(mix, sub(wet, dry))));
+  }
+  for (; i < samples; ++i) {
+    const float dry = buffer[i];
+    buffer[i] = dry + mix_ * (softClip(dry * drive_) - dry);
+  }
+}
+
+}  // namespace mpccli
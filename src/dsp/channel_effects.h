@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace mpccli {
+
+enum class FilterType { Off, LowPass, HighPass, BandPass };
+
+// State-variable filter settings (resonance is the Q; 0.707 is flat at the cutoff)
+struct FilterParams {
+  FilterType type = FilterType::Off;
+  float cutoff_hz = 1000.0f;
+  float resonance = 0.707f;
+
+  bool operator==(const FilterParams&) const = default;
+};
+
+// Feed-forward peak compressor, linked across channels
+struct CompressorParams {
+  bool enabled = false;
+  float threshold_db = -12.0f;
+  float ratio = 4.0f;
+  float attack_ms = 5.0f;
+  float release_ms = 100.0f;
+  float makeup_db = 0.0f;
+
+  bool operator==(const CompressorParams&) const = default;
+};
+
+// Soft-clip saturation: drive into a tanh-shaped curve, blended with the dry signal
+struct SaturatorParams {
+  bool enabled = false;
+  float drive_db = 6.0f;
+  float mix = 1.0f;
+
+  bool operator==(const SaturatorParams&) const = default;
+};
+
+// Insert effects of one mixer channel, applied in this order
+struct ChannelEffectParams {
+  FilterParams filter;
+  CompressorParams compressor;
+  SaturatorParams saturator;
+
+  bool enabled() const { return filter.type != FilterType::Off || compressor.enabled || saturator.enabled; }
+  bool operator==(const ChannelEffectParams&) const = default;
+};
+
+const char* filterTypeName(FilterType type);
+
+// Parse "lowpass", "highpass", "bandpass" or "off". Returns false for anything else.
+bool parseFilterType(const std::string& name, FilterType& type);
+
+// Filter, compressor and saturator of one channel, processing interleaved blocks in place.
+// Coefficients are computed once here; process() never allocates and costs nothing for
+// effects that are off. The kernels work on 4-float vectors (SSE or NEON): the filter
+// runs the channels of a frame side by side, the compressor detects and applies gain a
+// vector at a time with its envelope updated every kControlFrames, and the saturator is
+// a rational tanh approximation over whole vectors.
+class ChannelEffects {
+ public:
+  static constexpr size_t kControlFrames = 16;  // Compressor gain update interval
+  static constexpr int kMaxChannels = 4;
+
+  ChannelEffects(const ChannelEffectParams& params, double sample_rate, int channels);
+
+  // Forget filter and compressor state
+  void reset();
+
+  // Whether the filter has rung out (below -100 dB) and the compressor has released
+  // below its threshold, so processing silence would change nothing audible
+  bool settled() const;
+
+  void process(float* buffer, size_t frames);
+
+ private:
+  void filter(float* buffer, size_t frames);
+  void compress(float* buffer, size_t frames);
+  void saturate(float* buffer, size_t frames);
+
+  int channels_;
+  bool filter_on_;
+  bool compressor_on_;
+  bool saturator_on_;
+
+  // Filter (trapezoidal SVF): coefficients, output mix of input/band/low, per-channel state
+  float a1_, a2_, a3_;
+  float m0_, m1_, m2_;
+  alignas(16) float ic1_[kMaxChannels];
+  alignas(16) float ic2_[kMaxChannels];
+
+  // Compressor: envelope coefficients per control block, gain computer, current state
+  float attack_coeff_;
+  float release_coeff_;
+  float threshold_db_;
+  float slope_;  // 1 - 1/ratio
+  float makeup_db_;
+  float envelope_;
+  float gain_;
+
+  // Saturator
+  float drive_;
+  float mix_;
+};
+
+}  // namespace mpccli
@@ -0,0 +1,139 @@
+#include "envelope.h"
+#include <algorithm>
+
+namespace mpccli {
+
+AdsrEnvelope::AdsrEnvelope()
+    : stage_(Stage::Done),
+      level_(0.0f),
+      attack_step_(1.0f),
+      decay_step_(1.0f),
+      release_step_(1.0f),
+      sustain_(1.0f),
+      release_frames_(0.0f),
+      min_release_level_(0.0f),
+      release_pending_(false) {
+}
+
+void AdsrEnvelope::start(const AdsrParams& params, double sample_rate) {
+  // Zero-length stages complete within a single frame
+  const float attack_frames = std::max(1.0f, static_cast<float>(params.attack * sample_rate));
+  const float decay_frames = std::max(1.0f, static_cast<float>(params.decay * sample_rate));
+
+  sustain_ = std::clamp(params.sustain, 0.0f, 1.0f);
+  attack_step_ = 1.0f / attack_frames;
+  decay_step_ = (1.0f - sustain_) / decay_frames;
+  release_frames_ = std::max(1.0f, static_cast<float>(params.release * sample_rate));
+  min_release_level_ = std::min(1.0f, attack_step_ * static_cast<float>(kMinNoteSeconds * sample_rate));
+  release_pending_ = false;
+  level_ = 0.0f;
+  stage_ = Stage::Attack;
+}
+
+void AdsrEnvelope::release() {
+  if (stage_ == Stage::Release || stage_ == Stage::Done) {
+    return;
+  }
+  if (stage_ == Stage::Attack && level_ < min_release_level_) {
+    release_pending_ = true;  // advance() releases once the attack gets there
+    return;
+  }
+  // Release always takes the configured time, whatever level it starts from
+  release_step_ = level_ / release_frames_;
+  stage_ = Stage::Release;
+}
+
+void AdsrEnvelope::fadeOut(float from_level, float seconds, double sample_rate) {
+  level_ = from_level;
+  release_pending_ = false;
+  release_step_ = level_ / std::max(1.0f, static_cast<float>(seconds * sample_rate));
+  stage_ = Stage::Release;
+}
+
+float AdsrEnvelope::advance(size_t frames) {
+  float remaining = static_cast<float>(frames);
+
+  // Walk through as many stages as this span covers
+  while (remaining > 0.0f) {
+    switch (stage_) {
+      case Stage::Attack: {
+        const float target = release_pending_ ? min_release_level_ : 1.0f;
+        const float needed = (target - level_) / attack_step_;
+        if (needed > remaining) {
+          level_ += attack_step_ * remaining;
+          return level_;
+        }
+        remaining -= needed;
+        level_ = target;
+        if (release_pending_) {
+          release_pending_ = false;
+          release_step_ = level_ / release_frames_;
+          stage_ = Stage::Release;
+        } else {
+          stage_ = Stage::Decay;
+        }
+        break;
+      }
+
+      case Stage::Decay: {
+        const float needed = decay_step_ > 0.0f ? (level_ - sustain_) / decay_step_ : 0.0f;
+        if (needed > remaining) {
+          level_ -= decay_step_ * remaining;
+          return level_;
+        }
+        remaining -= needed;
+        level_ = sustain_;
+        stage_ = Stage::Sustain;
+        break;
+      }
+
+      case Stage::Sustain:
+        return level_;
+
+      case Stage::Release: {
+        const float needed = release_step_ > 0.0f ? level_ / release_step_ : 0.0f;
+        if (needed > remaining) {
+          level_ -= release_step_ * remaining;
+          return level_;
+        }
+        level_ = 0.0f;
+        stage_ = Stage::Done;
+        return level_;
+      }
+
+      case Stage::Done:
+        return level_;
+    }
+  }
+
+  return level_;
+}
+
+float mixWithGainRamp(float* output, const float* input, size_t frames, int channels,
+                      float gain_start, float gain_end) {
+  const float increment = frames > 0 ? (gain_end - gain_start) / frames : 0.0f;
+  float sum_squares = 0.0f;
+
+  // Constant gain is the common case (sustain, or no envelope); keep it a plain loop
+  if (increment == 0.0f) {
+    const size_t samples = frames * channels;
+    for (size_t i = 0; i < samples; ++i) {
+      const float s = input[i] * gain_start;
+      output[i] += s;
+      sum_squares += s * s;
+    }
+    return sum_squares;
+  }
+
+  float gain = gain_start;
+  for (size_t f = 0; f < frames; ++f, gain += increment) {
+    for (int c = 0; c < channels; ++c) {
+      const float s = input[f * channels + c] * gain;
+      output[f * channels + c] += s;
+      sum_squares += s * s;
+    }
+  }
+  return sum_squares;
+}
+
+}  // namespace mpccli
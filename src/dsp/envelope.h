@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+
+namespace mpccli {
+
+// ADSR settings in seconds (sustain is a level, 0.0 to 1.0)
+struct AdsrParams {
+  float attack = 0.0f;
+  float decay = 0.0f;
+  float sustain = 1.0f;
+  float release = 0.0f;
+
+  bool operator==(const AdsrParams&) const = default;
+};
+
+// Per-voice linear ADSR amplitude envelope.
+// It is advanced once per control block rather than per sample; the gain between
+// two block boundaries is linearly interpolated by mixWithGainRamp().
+class AdsrEnvelope {
+ public:
+  static constexpr float kMinNoteSeconds = 0.01f;
+
+  AdsrEnvelope();
+
+  // Begin the attack stage from silence
+  void start(const AdsrParams& params, double sample_rate);
+
+  // Begin the release stage from the current level (no-op once released). A note released
+  // within kMinNoteSeconds of its start keeps attacking until then, so even a note-off
+  // in the same block as its note-on is heard.
+  void release();
+
+  // Fade from `from_level` to silence over `seconds`, whatever stage the envelope is in
+  // (used to choke voices, including ones that were not started with an envelope)
+  void fadeOut(float from_level, float seconds, double sample_rate);
+
+  // Advance by `frames` and return the level at the end of that span
+  float advance(size_t frames);
+
+  float level() const { return level_; }
+  bool releasing() const { return stage_ == Stage::Release || release_pending_; }
+  bool finished() const { return stage_ == Stage::Done; }
+
+ private:
+  enum class Stage { Attack, Decay, Sustain, Release, Done };
+
+  Stage stage_;
+  float level_;
+  float attack_step_;   // Level change per frame in each stage
+  float decay_step_;
+  float release_step_;
+  float sustain_;
+  float release_frames_;
+  float min_release_level_;  // Level the attack reaches after kMinNoteSeconds
+  bool release_pending_;     // Released before reaching min_release_level_
+};
+
+// output += input * gain, with the gain ramping linearly from `gain_start` to `gain_end`
+// across the block. Returns the sum of squares of what was added (for metering).
+float mixWithGainRamp(float* output, const float* input, size_t frames, int channels,
+                      float gain_start, float gain_end);
+
+}  // namespace mpccli
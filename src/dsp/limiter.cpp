@@ -0,0 +1,180 @@
+#include "limiter.h"
+#include <algorithm>
+#include <cmath>
+#include "simd.h"
+
+namespace mpccli {
+
+namespace {
+
+using namespace simd;
+
+constexpr double kPi = 3.14159265358979323846;
+
+}  // namespace
+
+TruePeakLimiter::TruePeakLimiter(const LimiterParams& params, double sample_rate, int channels)
+    : channels_(std::max(channels, 1)),
+      lookahead_(std::max<size_t>(1, static_cast<size_t>(std::lround(params.lookahead_ms * 1e-3 * sample_rate)))),
+      latency_(kTaps / 2 + lookahead_ - 1),
+      ceiling_(std::pow(10.0f, std::min(params.ceiling_db, 0.0f) / 20.0f)),
+      release_coeff_(static_cast<float>(1.0 - std::exp(-1.0 / (std::max(params.release_ms, 1.0f) * 1e-3 * sample_rate)))),
+      history_(static_cast<size_t>(channels_) * 2 * kTaps, 0.0f),
+      history_pos_(0),
+      overshoot_(1.0f),
+      recent_peak_(0.0f),
+      window_mask_(0),
+      window_head_(0),
+      window_count_(0),
+      frame_(0),
+      gain_(1.0f),
+      box_(lookahead_, 1.0f),
+      box_sum_(0.0),
+      box_pos_(0),
+      delay_(latency_ * channels_, 0.0f),
+      delay_pos_(0),
+      silent_frames_(0) {
+  // Hann-windowed sinc for the points 1/4, 2/4 and 3/4 of the way between the two middle
+  // taps, each phase normalized to unity gain at DC
+  for (int phase = 1; phase < 4; ++phase) {
+    double sum = 0.0;
+    for (int tap = 0; tap < kTaps; ++tap) {
+      const double x = kTaps / 2 - 1 + phase / 4.0 - tap;
+      const double sinc = std::sin(kPi * x) / (kPi * x);
+      const double window = 0.5 + 0.5 * std::cos(kPi * x / (kTaps / 2));
+      coefficients_[tap][phase - 1] = static_cast<float>(sinc * window);
+      sum += sinc * window;
+    }
+    for (int tap = 0; tap < kTaps; ++tap) {
+      coefficients_[tap][phase - 1] = static_cast<float>(coefficients_[tap][phase - 1] / sum);
+    }
+  }
+  for (int tap = 0; tap < kTaps; ++tap) {
+    coefficients_[tap][3] = 0.0f;
+  }
+
+  // No point between samples can exceed the largest sample by more than this
+  for (int phase = 0; phase < 3; ++phase) {
+    float gain = 0.0f;
+    for (int tap = 0; tap < kTaps; ++tap) {
+      gain += std::fabs(coefficients_[tap][phase]);
+    }
+    overshoot_ = std::max(overshoot_, gain);
+  }
+
+  // The queue holds at most one entry per frame of the window, plus the one being added
+  size_t capacity = 1;
+  while (capacity <= lookahead_) {
+    capacity <<= 1;
+  }
+  window_frames_.assign(capacity, 0);
+  window_peaks_.assign(capacity, 0.0f);
+  window_mask_ = capacity - 1;
+
+  reset();
+}
+
+void TruePeakLimiter::reset() {
+  std::fill(history_.begin(), history_.end(), 0.0f);
+  recent_peak_ = 0.0f;
+  std::fill(delay_.begin(), delay_.end(), 0.0f);
+  std::fill(box_.begin(), box_.end(), 1.0f);
+  box_sum_ = static_cast<double>(lookahead_);
+  box_pos_ = 0;
+  window_count_ = 0;
+  gain_ = 1.0f;
+}
+
+void TruePeakLimiter::process(float* buffer, size_t frames, bool has_input) {
+  const size_t samples = frames * channels_;
+  if (!has_input) {
+    std::fill(buffer, buffer + samples, 0.0f);
+    if (silent_frames_ >= latency_) {
+      return;  // Nothing left in flight
+    }
+  }
+
+  // While the block and the history it interpolates from stay far enough under the
+  // ceiling, the sample peaks stand in for the true peaks (either way the gain stays at 1)
+  Vec block_peak_vec = splat(0.0f);
+  size_t i = 0;
+  for (; i + 4 <= samples; i += 4) {
+    block_peak_vec = max(block_peak_vec, abs(load(buffer + i)));
+  }
+  float block_peak = maxLane(block_peak_vec);
+  for (; i < samples; ++i) {
+    block_peak = std::max(block_peak, std::fabs(buffer[i]));
+  }
+  const bool interpolate = std::max(block_peak, recent_peak_) * overshoot_ > ceiling_;
+  recent_peak_ = frames >= static_cast<size_t>(kTaps) ? block_peak : std::max(recent_peak_, block_peak);
+
+  const double inverse_lookahead = 1.0 / static_cast<double>(lookahead_);
+  for (size_t f = 0; f < frames; ++f) {
+    float* frame = buffer + f * channels_;
+
+    // True peak of the stretch after the sample kTaps/2 frames back
+    float peak = 0.0f;
+    for (int c = 0; c < channels_; ++c) {
+      float* history = &history_[c * 2 * kTaps];
+      history[history_pos_] = frame[c];
+      history[history_pos_ + kTaps] = frame[c];
+      const float* taps = history + history_pos_ + 1;  // Oldest first
+      if (!interpolate) {
+        peak = std::max(peak, std::fabs(taps[kTaps / 2 - 1]));
+        continue;
+      }
+      Vec even = splat(0.0f);
+      Vec odd = splat(0.0f);
+      for (int tap = 0; tap < kTaps; tap += 2) {
+        even = add(even, mul(load(coefficients_[tap]), splat(taps[tap])));
+        odd = add(odd, mul(load(coefficients_[tap + 1]), splat(taps[tap + 1])));
+      }
+      peak = std::max(peak, std::max(std::fabs(taps[kTaps / 2 - 1]), maxLane(abs(add(even, odd)))));
+    }
+    history_pos_ = history_pos_ + 1 < kTaps ? history_pos_ + 1 : 0;
+
+    // Sliding maximum: drop smaller peaks from the back and expired ones from the front
+    while (window_count_ > 0 && window_peaks_[(window_head_ + window_count_ - 1) & window_mask_] <= peak) {
+      --window_count_;
+    }
+    const size_t back = (window_head_ + window_count_) & window_mask_;
+    window_frames_[back] = frame_;
+    window_peaks_[back] = peak;
+    ++window_count_;
+    if (window_frames_[window_head_] + lookahead_ <= frame_) {
+      window_head_ = (window_head_ + 1) & window_mask_;
+      --window_count_;
+    }
+    ++frame_;
+
+    // Instant reduction, smooth release, then the average over the lookahead
+    const float held = window_peaks_[window_head_];
+    const float target = held > ceiling_ ? ceiling_ / held : 1.0f;
+    gain_ = target < gain_ ? target : gain_ + release_coeff_ * (target - gain_);
+    box_sum_ += gain_ - box_[box_pos_];
+    box_[box_pos_] = gain_;
+    if (++box_pos_ == lookahead_) {
+      box_pos_ = 0;
+      box_sum_ = 0.0;  // Resum once per window so rounding can't build up
+      for (float g : box_) {
+        box_sum_ += g;
+      }
+    }
+    const float gain = static_cast<float>(box_sum_ * inverse_lookahead);
+
+    float* delayed = &delay_[delay_pos_ * channels_];
+    for (int c = 0; c < channels_; ++c) {
+      const float input = frame[c];
+      frame[c] = delayed[c] * gain;
+      delayed[c] = input;
+    }
+    delay_pos_ = delay_pos_ + 1 < latency_ ? delay_pos_ + 1 : 0;
+  }
+
+  silent_frames_ = has_input ? 0 : silent_frames_ + frames;
+  if (silent_frames_ >= latency_) {
+    reset();
+  }
+}
+
+}  // namespace mpccli
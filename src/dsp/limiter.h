@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mpccli {
+
+// Master bus limiter settings
+struct LimiterParams {
+  bool enabled = true;
+  float ceiling_db = -1.0f;    // Highest true peak let through (dBTP)
+  float lookahead_ms = 1.5f;   // Gain reduction starts this long before a peak
+  float release_ms = 60.0f;    // Time to recover most of the gain after a peak
+
+  bool operator==(const LimiterParams&) const = default;
+};
+
+// Lookahead true-peak limiter, processing interleaved blocks in place.
+//
+// The detector estimates the peak between samples with a 4x polyphase interpolator
+// (12 taps per phase, the three new phases computed together in one vector), skipped
+// for blocks too quiet for any point between samples to reach the ceiling. A
+// monotonic queue keeps the maximum of the last `lookahead` frames of detector output,
+// so each frame costs O(1) however long the lookahead is. The gain that keeps that
+// maximum under the ceiling is released smoothly, then averaged over the lookahead
+// window: every output sample is scaled by the average of gains that were all low
+// enough for it, so the gain ramps down ahead of a peak without overshooting it.
+//
+// The audio is delayed by latencyFrames(), which depends only on the lookahead and
+// sample rate. Everything is allocated up front; process() never allocates.
+class TruePeakLimiter {
+ public:
+  static constexpr int kTaps = 12;  // Interpolator taps per phase
+
+  TruePeakLimiter(const LimiterParams& params, double sample_rate, int channels);
+
+  // Forget the audio in flight and return to unity gain
+  void reset();
+
+  // Limit a block. `has_input` is false for a silent block (buffer is then treated as
+  // silence); once the delayed audio has drained, silent blocks cost nothing.
+  void process(float* buffer, size_t frames, bool has_input = true);
+
+  // Delay from input to output: the interpolator's half length plus the lookahead
+  size_t latencyFrames() const { return latency_; }
+
+ private:
+  int channels_;
+  size_t lookahead_;  // Frames
+  size_t latency_;
+  float ceiling_;
+  float release_coeff_;
+
+  // Interpolator: coefficients per tap (lanes are phases 1/4, 2/4, 3/4 and an unused
+  // zero), and each channel's last kTaps samples written twice so a window never wraps
+  alignas(16) float coefficients_[kTaps][4];
+  std::vector<float> history_;  // channels * 2 * kTaps
+  size_t history_pos_;
+  float overshoot_;    // Largest ratio of an interpolated point to the samples around it
+  float recent_peak_;  // Of at least the last kTaps frames of input
+
+  // Sliding maximum of the detector: (frame, peak) pairs with falling peaks
+  std::vector<uint64_t> window_frames_;
+  std::vector<float> window_peaks_;
+  size_t window_mask_;
+  size_t window_head_;
+  size_t window_count_;
+  uint64_t frame_;
+
+  // Released gain and its moving average over the lookahead
+  float gain_;
+  std::vector<float> box_;
+  double box_sum_;
+  size_t box_pos_;
+
+  std::vector<float> delay_;  // Interleaved, latency_ frames
+  size_t delay_pos_;
+  size_t silent_frames_;  // Consecutive frames of silent input
+};
+
+}  // namespace mpccli
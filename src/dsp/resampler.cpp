@@ -0,0 +1,283 @@
+#include "resampler.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define MPCCLI_RESAMPLER_SSE 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define MPCCLI_RESAMPLER_NEON 1
+#endif
+
+namespace mpccli {
+
+namespace {
+
+constexpr int kSincHalfWidth = Resampler::kSincTaps / 2;
+// Passband edge as a fraction of Nyquist (leaves room for the transition band)
+constexpr double kSincCutoff = 0.92;
+constexpr double kKaiserBeta = 8.0;
+
+// Zeroth-order modified Bessel function (for the Kaiser window)
+double besselI0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  for (int k = 1; k < 32; ++k) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+  }
+  return sum;
+}
+
+// Dot product of `taps` interleaved stereo frames with mono coefficients.
+// Every coefficient is applied to both channels, so the SIMD kernels duplicate
+// each coefficient pair (c0 c0 c1 c1) and accumulate L/R lanes side by side.
+// taps must be a multiple of 4.
+inline void dotStereo(const float* frames, const float* coeffs, int taps, float& left, float& right) {
+#if defined(MPCCLI_RESAMPLER_SSE)
+  __m128 acc_lo = _mm_setzero_ps();
+  __m128 acc_hi = _mm_setzero_ps();
+  for (int t = 0; t < taps; t += 4) {
+    __m128 c = _mm_loadu_ps(coeffs + t);
+    acc_lo = _mm_add_ps(acc_lo, _mm_mul_ps(_mm_loadu_ps(frames + 2 * t), _mm_unpacklo_ps(c, c)));
+    acc_hi = _mm_add_ps(acc_hi, _mm_mul_ps(_mm_loadu_ps(frames + 2 * t + 4), _mm_unpackhi_ps(c, c)));
+  }
+  __m128 acc = _mm_add_ps(acc_lo, acc_hi);          // L R L R
+  acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));   // L R . .
+  left = _mm_cvtss_f32(acc);
+  right = _mm_cvtss_f32(_mm_shuffle_ps(acc, acc, _MM_SHUFFLE(1, 1, 1, 1)));
+#elif defined(MPCCLI_RESAMPLER_NEON)
+  float32x4_t acc_lo = vdupq_n_f32(0.0f);
+  float32x4_t acc_hi = vdupq_n_f32(0.0f);
+  for (int t = 0; t < taps; t += 4) {
+    float32x4_t c = vld1q_f32(coeffs + t);
+    acc_lo = vfmaq_f32(acc_lo, vld1q_f32(frames + 2 * t), vzip1q_f32(c, c));
+    acc_hi = vfmaq_f32(acc_hi, vld1q_f32(frames + 2 * t + 4), vzip2q_f32(c, c));
+  }
+  float32x4_t acc = vaddq_f32(acc_lo, acc_hi);                  // L R L R
+  float32x2_t sum = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));  // L R
+  left = vget_lane_f32(sum, 0);
+  right = vget_lane_f32(sum, 1);
+#else
+  float l = 0.0f;
+  float r = 0.0f;
+  for (int t = 0; t < taps; ++t) {
+    l += frames[2 * t] * coeffs[t];
+    r += frames[2 * t + 1] * coeffs[t];
+  }
+  left = l;
+  right = r;
+#endif
+}
+
+// Catmull-Rom weights for source frames i-1, i, i+1, i+2
+inline void cubicCoefficients(float frac, float* c) {
+  const float f2 = frac * frac;
+  const float f3 = f2 * frac;
+  c[0] = -0.5f * f3 + f2 - 0.5f * frac;
+  c[1] = 1.5f * f3 - 2.5f * f2 + 1.0f;
+  c[2] = -1.5f * f3 + 2.0f * f2 + 0.5f * frac;
+  c[3] = 0.5f * f3 - 0.5f * f2;
+}
+
+// Slow path for windows that run off either end of the source (treated as silence)
+inline void dotEdge(const SampleBuffer& source, long first, const float* coeffs, int taps, float* out_frame) {
+  const long frames = static_cast<long>(source.frames());
+  const int channels = source.channels;
+  for (int t = 0; t < taps; ++t) {
+    long j = first + t;
+    if (j < 0 || j >= frames) {
+      continue;
+    }
+    const float* src = source.data() + j * channels;
+    for (int c = 0; c < channels; ++c) {
+      out_frame[c] += src[c] * coeffs[t];
+    }
+  }
+}
+
+}  // namespace
+
+bool parseResamplerQuality(const std::string& name, ResamplerQuality& quality) {
+  if (name == "linear") {
+    quality = ResamplerQuality::Linear;
+  } else if (name == "cubic") {
+    quality = ResamplerQuality::Cubic;
+  } else if (name == "sinc") {
+    quality = ResamplerQuality::Sinc;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* resamplerQualityName(ResamplerQuality quality) {
+  switch (quality) {
+    case ResamplerQuality::Linear: return "linear";
+    case ResamplerQuality::Cubic: return "cubic";
+    case ResamplerQuality::Sinc: return "sinc";
+  }
+  return "unknown";
+}
+
+Resampler::Resampler() {
+  // Band b is used for steps up to 2^(b/12): its cutoff sits at or below the
+  // Nyquist frequency of the pitched-up output, so high notes don't alias
+  sinc_tables_.resize(kMaxSincSemitones + 1);
+  for (int band = 0; band <= kMaxSincSemitones; ++band) {
+    const double cutoff = kSincCutoff * std::pow(2.0, -band / 12.0);
+    std::vector<float>& table = sinc_tables_[band];
+    // One extra row (phase == kSincPhases) so phases can be interpolated without wrapping
+    table.resize((kSincPhases + 1) * kSincTaps);
+
+    for (int phase = 0; phase <= kSincPhases; ++phase) {
+      const double frac = static_cast<double>(phase) / kSincPhases;
+      double sum = 0.0;
+      for (int t = 0; t < kSincTaps; ++t) {
+        // Distance from the read position to source frame (i - halfwidth + 1 + t)
+        const double x = (t - (kSincHalfWidth - 1)) - frac;
+        const double arg = M_PI * cutoff * x;
+        const double sinc = std::abs(arg) < 1e-9 ? 1.0 : std::sin(arg) / arg;
+        const double w = x / kSincHalfWidth;
+        const double window = std::abs(w) >= 1.0 ? 0.0 : besselI0(kKaiserBeta * std::sqrt(1.0 - w * w)) / besselI0(kKaiserBeta);
+        const double h = cutoff * sinc * window;
+        table[phase * kSincTaps + t] = static_cast<float>(h);
+        sum += h;
+      }
+      // Normalise each phase to unity DC gain
+      for (int t = 0; t < kSincTaps; ++t) {
+        table[phase * kSincTaps + t] = static_cast<float>(table[phase * kSincTaps + t] / sum);
+      }
+    }
+  }
+}
+
+const float* Resampler::sincTable(double step) const {
+  int band = 0;
+  if (step > 1.0) {
+    band = static_cast<int>(std::ceil(12.0 * std::log2(step) - 1e-9));
+    band = std::clamp(band, 0, kMaxSincSemitones);
+  }
+  return sinc_tables_[band].data();
+}
+
+double Resampler::process(ResamplerQuality quality, const SampleBuffer& source, double position, double step,
+                          float gain, float* output, size_t frames) const {
+  const long source_frames = static_cast<long>(source.frames());
+  const int channels = source.channels;
+  const bool stereo = channels == 2;
+  const float* src = source.data();
+  const float* table = quality == ResamplerQuality::Sinc ? sincTable(step) : nullptr;
+
+  // Unpitched playback from a whole-frame position needs no interpolation
+  if (step == 1.0 && position == std::floor(position)) {
+    const long start = static_cast<long>(position);
+    const size_t count = static_cast<size_t>(std::clamp<long>(source_frames - start, 0, static_cast<long>(frames)));
+    const float* in = src + start * channels;
+    for (size_t i = 0; i < count * channels; ++i) {
+      output[i] += in[i] * gain;
+    }
+    return position + static_cast<double>(frames);
+  }
+
+  float frame[8];
+  float coeffs[4];
+
+  for (size_t n = 0; n < frames; ++n, position += step) {
+    const long i = static_cast<long>(position);
+    if (i >= source_frames) {
+      break;
+    }
+    const float frac = static_cast<float>(position - i);
+    float* out = output + n * channels;
+
+    switch (quality) {
+      case ResamplerQuality::Linear: {
+        const float* a = src + i * channels;
+        const bool has_next = i + 1 < source_frames;
+        for (int c = 0; c < channels; ++c) {
+          const float next = has_next ? a[channels + c] : 0.0f;
+          out[c] += (a[c] + (next - a[c]) * frac) * gain;
+        }
+        break;
+      }
+
+      case ResamplerQuality::Cubic: {
+        cubicCoefficients(frac, coeffs);
+        const long first = i - 1;
+        if (stereo && first >= 0 && first + 4 <= source_frames) {
+          float l, r;
+          dotStereo(src + first * 2, coeffs, 4, l, r);
+          out[0] += l * gain;
+          out[1] += r * gain;
+        } else {
+          std::fill(frame, frame + channels, 0.0f);
+          dotEdge(source, first, coeffs, 4, frame);
+          for (int c = 0; c < channels; ++c) {
+            out[c] += frame[c] * gain;
+          }
+        }
+        break;
+      }
+
+      case ResamplerQuality::Sinc: {
+        // Interpolate between the two nearest phases of the polyphase table
+        const float scaled = frac * kSincPhases;
+        const int phase = std::min(static_cast<int>(scaled), kSincPhases - 1);
+        const float blend = scaled - phase;
+        const float* row = table + phase * kSincTaps;
+        alignas(16) float c[kSincTaps];
+        for (int t = 0; t < kSincTaps; ++t) {
+          c[t] = row[t] + (row[t + kSincTaps] - row[t]) * blend;
+        }
+        const long first = i - (kSincHalfWidth - 1);
+        if (stereo && first >= 0 && first + kSincTaps <= source_frames) {
+          float l, r;
+          dotStereo(src + first * 2, c, kSincTaps, l, r);
+          out[0] += l * gain;
+          out[1] += r * gain;
+        } else {
+          std::fill(frame, frame + channels, 0.0f);
+          dotEdge(source, first, c, kSincTaps, frame);
+          for (int ch = 0; ch < channels; ++ch) {
+            out[ch] += frame[ch] * gain;
+          }
+        }
+        break;
+      }
+    }
+  }
+
+  return position;
+}
+
+const Resampler& defaultResampler() {
+  static const Resampler resampler;
+  return resampler;
+}
+
+SampleBuffer resampleBuffer(const SampleBuffer& input, double step, size_t out_frames, ResamplerQuality quality) {
+  SampleBuffer result;
+  result.channels = input.channels;
+  result.sample_rate = input.sample_rate;
+  result.samples.assign(out_frames * input.channels, 0.0f);
+  defaultResampler().process(quality, input, 0.0, step, 1.0f, result.samples.data(), out_frames);
+  return result;
+}
+
+SampleBuffer convertSampleRate(const SampleBuffer& input, double sample_rate, ResamplerQuality quality) {
+  if (input.sample_rate == sample_rate || input.frames() == 0) {
+    SampleBuffer result = input;
+    result.sample_rate = sample_rate;
+    return result;
+  }
+
+  const double step = input.sample_rate / sample_rate;
+  const size_t out_frames = static_cast<size_t>(std::ceil(input.frames() / step));
+  SampleBuffer result = resampleBuffer(input, step, out_frames, quality);
+  result.sample_rate = sample_rate;
+  return result;
+}
+
+}  // namespace mpccli
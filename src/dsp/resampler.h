@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "sample_buffer.h"
+
+namespace mpccli {
+
+// Interpolation quality, from cheapest to cleanest
+enum class ResamplerQuality {
+  Linear,  // 2-point linear interpolation
+  Cubic,   // 4-point Catmull-Rom
+  Sinc,    // 16-tap Kaiser-windowed sinc, polyphase table
+};
+
+// Parse "linear", "cubic" or "sinc"; returns false for anything else
+bool parseResamplerQuality(const std::string& name, ResamplerQuality& quality);
+const char* resamplerQualityName(ResamplerQuality quality);
+
+// Interpolating resampler that reads directly from an in-memory SampleBuffer.
+// It holds no per-stream state (only the precomputed sinc tables), so a single
+// instance is shared by every voice. Reading a buffer with a step other than 1.0
+// changes its pitch; the same kernels convert sample rates on load.
+class Resampler {
+ public:
+  static constexpr int kSincTaps = 16;           // Taps per output frame (8 either side)
+  static constexpr int kSincPhases = 256;        // Fractional positions per table (interpolated)
+  static constexpr int kMaxSincSemitones = 36;   // Anti-aliased bands for steps up to +36 semitones
+
+  Resampler();
+
+  // Mix `frames` output frames into `output` (interleaved, same channel count as `source`).
+  // Reading starts at `position` (in source frames) and advances by `step` source frames per
+  // output frame; each frame is scaled by `gain` and added to what is already in `output`.
+  // Stops early at the end of the source. Returns the read position after the last frame.
+  double process(ResamplerQuality quality, const SampleBuffer& source, double position, double step,
+                 float gain, float* output, size_t frames) const;
+
+ private:
+  // Polyphase table whose cutoff keeps reading at `step` free of aliasing
+  const float* sincTable(double step) const;
+
+  // One table per semitone band: [phase * kSincTaps + tap], phases 0..kSincPhases inclusive
+  std::vector<std::vector<float>> sinc_tables_;
+};
+
+// Shared instance (tables are built once, on first use)
+const Resampler& defaultResampler();
+
+// Render a whole buffer read at `step` source frames per output frame into a new buffer
+SampleBuffer resampleBuffer(const SampleBuffer& input, double step, size_t out_frames,
+                            ResamplerQuality quality = ResamplerQuality::Sinc);
+
+// Convert a buffer to another sample rate (duration and pitch are preserved)
+SampleBuffer convertSampleRate(const SampleBuffer& input, double sample_rate,
+                               ResamplerQuality quality = ResamplerQuality::Sinc);
+
+}  // namespace mpccli
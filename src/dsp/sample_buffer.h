@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace mpccli {
+
+// Sample rate and channel count all decoded samples are converted to
+constexpr double kEngineSampleRate = 48000.0;
+constexpr int kEngineChannels = 2;
+
+// Decoded PCM audio held in memory (32-bit float, interleaved).
+// Either owns its samples or views PCM stored elsewhere (a memory-mapped kit file),
+// so readers go through data() and size().
+struct SampleBuffer {
+  std::vector<float> samples;  // Owned PCM (empty for a view)
+  int channels = kEngineChannels;
+  double sample_rate = kEngineSampleRate;
+
+  // Viewed PCM, kept valid by `storage`
+  const float* view = nullptr;
+  size_t view_size = 0;
+  std::shared_ptr<const void> storage;
+
+  const float* data() const { return view ? view : samples.data(); }
+  size_t size() const { return view ? view_size : samples.size(); }
+  size_t frames() const { return channels > 0 ? size() / channels : 0; }
+  double durationSeconds() const { return sample_rate > 0.0 ? frames() / sample_rate : 0.0; }
+};
+
+}  // namespace mpccli
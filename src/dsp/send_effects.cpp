@@ -0,0 +1,226 @@
+#include "send_effects.h"
+#include <algorithm>
+#include <cmath>
+#include "simd.h"
+
+namespace mpccli {
+
+namespace {
+
+using namespace simd;
+
+constexpr float kSilence = 1e-5f;  // -100 dB: a tail below this ends
+
+// Line lengths in frames at 48 kHz for the largest room (mutually prime, 30-58 ms)
+constexpr uint32_t kBaseLengths[FdnReverb::kLines] = {1433, 1601, 1867, 2053, 2251, 2399, 2617, 2797};
+
+}  // namespace
+
+const char* sendEffectTypeName(SendEffectType type) {
+  switch (type) {
+    case SendEffectType::None: return "none";
+    case SendEffectType::Reverb: return "reverb";
+    case SendEffectType::Delay: return "delay";
+  }
+  return "unknown";
+}
+
+FdnReverb::FdnReverb(const ReverbParams& params, double sample_rate, int channels)
+    : channels_(channels),
+      mask_(0),
+      write_(0),
+      longest_(1),
+      damping_(std::clamp(params.damping, 0.0f, 0.95f)),
+      input_gain_(0.35f) {
+  const double scale = (0.3 + 0.7 * std::clamp(params.size, 0.0f, 1.0f)) * sample_rate / 48000.0;
+  const double decay = std::max(params.decay, 0.05f);
+  for (int line = 0; line < kLines; ++line) {
+    lengths_[line] = std::max<uint32_t>(1, static_cast<uint32_t>(std::lround(kBaseLengths[line] * scale)));
+    longest_ = std::max<size_t>(longest_, lengths_[line]);
+    // Gain per pass so every line falls 60 dB in `decay` seconds
+    gains_[line] = static_cast<float>(std::pow(10.0, -3.0 * lengths_[line] / (decay * sample_rate)));
+    lowpass_[line] = 0.0f;
+  }
+
+  size_t ring_frames = 1;
+  while (ring_frames <= longest_) {
+    ring_frames <<= 1;
+  }
+  ring_.assign(ring_frames * kLines, 0.0f);
+  mask_ = ring_frames - 1;
+}
+
+void FdnReverb::process(float* buffer, size_t frames) {
+  const Vec damping = splat(damping_);
+  const Vec gains_lo = load(gains_);
+  const Vec gains_hi = load(gains_ + 4);
+  // Input enters every line with alternating signs; even lines feed the left output, odd the right
+  alignas(16) static constexpr float kSigns[4] = {1.0f, -1.0f, 1.0f, -1.0f};
+  alignas(16) static constexpr float kLeft[4] = {0.5f, 0.0f, 0.5f, 0.0f};
+  alignas(16) static constexpr float kLeftHigh[4] = {-0.5f, 0.0f, -0.5f, 0.0f};
+  alignas(16) static constexpr float kRight[4] = {0.0f, 0.5f, 0.0f, 0.5f};
+  alignas(16) static constexpr float kRightHigh[4] = {0.0f, -0.5f, 0.0f, -0.5f};
+  const Vec signs = load(kSigns);
+  const Vec left_lo = load(kLeft);
+  const Vec left_hi = load(kLeftHigh);
+  const Vec right_lo = load(kRight);
+  const Vec right_hi = load(kRightHigh);
+  const Vec householder = splat(2.0f / kLines);
+  Vec lowpass_lo = load(lowpass_);
+  Vec lowpass_hi = load(lowpass_ + 4);
+
+  alignas(16) float taps[kLines];
+  for (size_t f = 0; f < frames; ++f) {
+    float* frame = buffer + f * channels_;
+
+    // Read every line's output (one scattered load each)
+    for (int line = 0; line < kLines; ++line) {
+      taps[line] = ring_[((write_ - lengths_[line]) & mask_) * kLines + line];
+    }
+    const Vec tap_lo = load(taps);
+    const Vec tap_hi = load(taps + 4);
+
+    float input = 0.0f;
+    for (int c = 0; c < channels_; ++c) {
+      input += frame[c];
+    }
+    input *= input_gain_ / static_cast<float>(channels_);
+
+    // Damp, apply the decay gains, then mix through the Householder matrix (x - 2/N * sum)
+    lowpass_lo = add(tap_lo, mul(damping, sub(lowpass_lo, tap_lo)));
+    lowpass_hi = add(tap_hi, mul(damping, sub(lowpass_hi, tap_hi)));
+    Vec feedback_lo = mul(lowpass_lo, gains_lo);
+    Vec feedback_hi = mul(lowpass_hi, gains_hi);
+    const Vec mixed = mul(householder, splat(sumLanes(add(feedback_lo, feedback_hi))));
+    const Vec injected = mul(signs, splat(input));
+    store(&ring_[write_ * kLines], add(sub(feedback_lo, mixed), injected));
+    store(&ring_[write_ * kLines + 4], add(sub(feedback_hi, mixed), injected));
+    write_ = (write_ + 1) & mask_;
+
+    const float left = sumLanes(add(mul(tap_lo, left_lo), mul(tap_hi, left_hi)));
+    const float right = sumLanes(add(mul(tap_lo, right_lo), mul(tap_hi, right_hi)));
+    if (channels_ == 1) {
+      frame[0] = 0.5f * (left + right);
+    } else {
+      for (int c = 0; c < channels_; ++c) {
+        frame[c] = c % 2 == 0 ? left : right;
+      }
+    }
+  }
+
+  store(lowpass_, lowpass_lo);
+  store(lowpass_ + 4, lowpass_hi);
+}
+
+TempoDelay::TempoDelay(const DelayParams& params, double sample_rate, int channels)
+    : channels_(channels),
+      sample_rate_(sample_rate),
+      params_(params),
+      ring_frames_(static_cast<size_t>(std::ceil(kMaxSeconds * sample_rate)) + 2),
+      write_(0),
+      delay_frames_(0.0),
+      lowpass_(channels, 0.0f) {
+  params_.feedback = std::clamp(params_.feedback, 0.0f, 0.95f);
+  params_.damping = std::clamp(params_.damping, 0.0f, 0.95f);
+  ring_.assign(ring_frames_ * channels, 0.0f);
+}
+
+void TempoDelay::process(float* buffer, size_t frames, double bpm) {
+  const double target = std::clamp(params_.beats * 60.0 / std::max(bpm, 1.0) * sample_rate_, 2.0,
+                                   static_cast<double>(ring_frames_ - 2));
+  const double start = delay_frames_ > 0.0 ? delay_frames_ : target;
+  const double step = (target - start) / static_cast<double>(std::max<size_t>(frames, 1));
+  const bool ping_pong = params_.ping_pong && channels_ == 2;
+  const float feedback = params_.feedback;
+  const float damping = params_.damping;
+
+  double delay = start;
+  float delayed[2];
+  for (size_t f = 0; f < frames; ++f) {
+    delay += step;
+    double read = static_cast<double>(write_) - delay;
+    if (read < 0.0) {
+      read += static_cast<double>(ring_frames_);
+    }
+    const size_t i0 = static_cast<size_t>(read);
+    const size_t i1 = i0 + 1 < ring_frames_ ? i0 + 1 : 0;
+    const float frac = static_cast<float>(read - static_cast<double>(i0));
+
+    float* frame = buffer + f * channels_;
+    float* slot = &ring_[write_ * channels_];
+    if (ping_pong) {
+      // The input enters on the left and each repeat crosses to the other side
+      for (int c = 0; c < 2; ++c) {
+        const float a = ring_[i0 * 2 + c];
+        delayed[c] = a + frac * (ring_[i1 * 2 + c] - a);
+        lowpass_[c] = delayed[c] + damping * (lowpass_[c] - delayed[c]);
+      }
+      slot[0] = 0.5f * (frame[0] + frame[1]) + feedback * lowpass_[1];
+      slot[1] = feedback * lowpass_[0];
+      frame[0] = delayed[0];
+      frame[1] = delayed[1];
+    } else {
+      for (int c = 0; c < channels_; ++c) {
+        const float a = ring_[i0 * channels_ + c];
+        const float out = a + frac * (ring_[i1 * channels_ + c] - a);
+        lowpass_[c] = out + damping * (lowpass_[c] - out);
+        slot[c] = frame[c] + feedback * lowpass_[c];
+        frame[c] = out;
+      }
+    }
+    write_ = write_ + 1 < ring_frames_ ? write_ + 1 : 0;
+  }
+  delay_frames_ = target;
+}
+
+SendEffect::SendEffect(const SendEffectParams& params, double sample_rate, int channels)
+    : type_(params.type), channels_(channels), idle_(true), quiet_frames_(0) {
+  switch (type_) {
+    case SendEffectType::Reverb:
+      reverb_ = std::make_unique<FdnReverb>(params.reverb, sample_rate, channels);
+      break;
+    case SendEffectType::Delay:
+      delay_ = std::make_unique<TempoDelay>(params.delay, sample_rate, channels);
+      break;
+    case SendEffectType::None:
+      break;
+  }
+}
+
+bool SendEffect::process(float* buffer, size_t frames, bool has_input, double bpm) {
+  const size_t samples = frames * channels_;
+  if (!has_input) {
+    if (idle_ || type_ == SendEffectType::None) {
+      return false;
+    }
+    std::fill(buffer, buffer + samples, 0.0f);
+  }
+
+  if (reverb_) {
+    reverb_->process(buffer, frames);
+  } else if (delay_) {
+    delay_->process(buffer, frames, bpm);
+  }
+
+  if (has_input) {
+    idle_ = false;
+    quiet_frames_ = 0;
+    return true;
+  }
+
+  // Only the tail is left: stop once it has died away
+  Vec peak_vec = splat(0.0f);
+  size_t i = 0;
+  for (; i + 4 <= samples; i += 4) {
+    peak_vec = max(peak_vec, abs(load(buffer + i)));
+  }
+  float peak = maxLane(peak_vec);
+  for (; i < samples; ++i) {
+    peak = std::max(peak, std::fabs(buffer[i]));
+  }
+  quiet_frames_ = peak < kSilence ? quiet_frames_ + frames : 0;
+  idle_ = quiet_frames_ > (reverb_ ? reverb_->memoryFrames() : delay_->memoryFrames());
+  return !idle_;
+}
+
+}  // namespace mpccli
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mpccli {
+
+enum class SendEffectType { None, Reverb, Delay };
+
+struct ReverbParams {
+  float size = 0.5f;     // 0-1, scales the delay line lengths
+  float decay = 1.5f;    // Seconds to fall by 60 dB
+  float damping = 0.3f;  // 0-1, high frequencies decay faster
+
+  bool operator==(const ReverbParams&) const = default;
+};
+
+struct DelayParams {
+  float beats = 0.75f;     // Delay time in beats of the current tempo (0.75 = dotted eighth)
+  float feedback = 0.4f;
+  float damping = 0.2f;    // 0-1, each repeat gets darker
+  bool ping_pong = false;  // Repeats alternate between the channels
+
+  bool operator==(const DelayParams&) const = default;
+};
+
+// Effect of an aux bus (fully wet; the bus volume sets the return level)
+struct SendEffectParams {
+  SendEffectType type = SendEffectType::None;
+  ReverbParams reverb;
+  DelayParams delay;
+
+  bool operator==(const SendEffectParams&) const = default;
+};
+
+const char* sendEffectTypeName(SendEffectType type);
+
+// Feedback delay network reverb: 8 delay lines mixed through a Householder matrix, with
+// a one-pole damping filter and a decay gain per line. The lines share one interleaved
+// ring (8 floats per frame), so each frame writes a single cache line and the damping,
+// gains and mixing run on two 4-float vectors. Everything is allocated up front.
+class FdnReverb {
+ public:
+  static constexpr int kLines = 8;
+
+  FdnReverb(const ReverbParams& params, double sample_rate, int channels);
+
+  // Replace `buffer` (interleaved) with the reverb of it
+  void process(float* buffer, size_t frames);
+
+  // Frames audio can stay in the lines without reaching the output
+  size_t memoryFrames() const { return longest_; }
+
+ private:
+  int channels_;
+  std::vector<float> ring_;  // kLines floats per frame
+  size_t mask_;              // Ring frames - 1
+  size_t write_;
+  size_t longest_;
+  alignas(16) uint32_t lengths_[kLines];
+  alignas(16) float gains_[kLines];
+  alignas(16) float lowpass_[kLines];  // Damping filter state
+  float damping_;
+  float input_gain_;
+};
+
+// Delay locked to the tempo, with damped feedback and optional ping-pong. The line holds
+// kMaxSeconds; tempo changes glide the delay time over a block instead of jumping.
+class TempoDelay {
+ public:
+  static constexpr double kMaxSeconds = 4.0;
+
+  TempoDelay(const DelayParams& params, double sample_rate, int channels);
+
+  void process(float* buffer, size_t frames, double bpm);
+
+  size_t memoryFrames() const { return static_cast<size_t>(delay_frames_) + 2; }
+
+ private:
+  int channels_;
+  double sample_rate_;
+  DelayParams params_;
+  std::vector<float> ring_;  // Interleaved frames
+  size_t ring_frames_;
+  size_t write_;
+  double delay_frames_;      // Current delay (0 until the first block)
+  std::vector<float> lowpass_;  // Feedback damping state per channel
+};
+
+// The effect of one aux bus. Its input is silent once nothing is sent to the bus; the
+// effect keeps rendering its tail until the output has stayed below -100 dB for longer
+// than audio can hide in its delay lines, then goes idle and costs nothing.
+class SendEffect {
+ public:
+  SendEffect(const SendEffectParams& params, double sample_rate, int channels);
+
+  // Process a block in place. `has_input` is false when nothing reached the bus (buffer
+  // is then treated as silence). Returns whether the block holds any output.
+  bool process(float* buffer, size_t frames, bool has_input, double bpm);
+
+  SendEffectType type() const { return type_; }
+
+ private:
+  SendEffectType type_;
+  int channels_;
+  bool idle_;
+  size_t quiet_frames_;  // Since the output last rose above -100 dB
+  std::unique_ptr<FdnReverb> reverb_;
+  std::unique_ptr<TempoDelay> delay_;
+};
+
+}  // namespace mpccli
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define MPCCLI_SIMD_SSE 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define MPCCLI_SIMD_NEON 1
+#endif
+
+// Small vector layer shared by the effect kernels
+namespace mpccli::simd {
+
+// Four floats in one register, with a plain array where neither SSE nor NEON is available
+#if defined(MPCCLI_SIMD_SSE)
+using Vec = __m128;
+inline Vec load(const float* p) { return _mm_loadu_ps(p); }
+inline void store(float* p, Vec v) { _mm_storeu_ps(p, v); }
+inline Vec splat(float x) { return _mm_set1_ps(x); }
+inline Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+inline Vec sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+inline Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+inline Vec div(Vec a, Vec b) { return _mm_div_ps(a, b); }
+inline Vec min(Vec a, Vec b) { return _mm_min_ps(a, b); }
+inline Vec max(Vec a, Vec b) { return _mm_max_ps(a, b); }
+inline Vec abs(Vec v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+inline float maxLane(Vec v) {
+  v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+  v = _mm_max_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+  return _mm_cvtss_f32(v);
+}
+#elif defined(MPCCLI_SIMD_NEON)
+using Vec = float32x4_t;
+inline Vec load(const float* p) { return vld1q_f32(p); }
+inline void store(float* p, Vec v) { vst1q_f32(p, v); }
+inline Vec splat(float x) { return vdupq_n_f32(x); }
+inline Vec add(Vec a, Vec b) { return vaddq_f32(a, b); }
+inline Vec sub(Vec a, Vec b) { return vsubq_f32(a, b); }
+inline Vec mul(Vec a, Vec b) { return vmulq_f32(a, b); }
+inline Vec div(Vec a, Vec b) { return vdivq_f32(a, b); }
+inline Vec min(Vec a, Vec b) { return vminq_f32(a, b); }
+inline Vec max(Vec a, Vec b) { return vmaxq_f32(a, b); }
+inline Vec abs(Vec v) { return vabsq_f32(v); }
+inline float maxLane(Vec v) { return vmaxvq_f32(v); }
+#else
+struct Vec {
+  float lane[4];
+};
+template <typename Op>
+inline Vec map(Vec a, Vec b, Op op) {
+  return {{op(a.lane[0], b.lane[0]), op(a.lane[1], b.lane[1]), op(a.lane[2], b.lane[2]), op(a.lane[3], b.lane[3])}};
+}
+inline Vec load(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline void store(float* p, Vec v) { std::memcpy(p, v.lane, sizeof(v.lane)); }
+inline Vec splat(float x) { return {{x, x, x, x}}; }
+inline Vec add(Vec a, Vec b) { return map(a, b, [](float x, float y) { return x + y; }); }
+inline Vec sub(Vec a, Vec b) { return map(a, b, [](float x, float y) { return x - y; }); }
+inline Vec mul(Vec a, Vec b) { return map(a, b, [](float x, float y) { return x * y; }); }
+inline Vec div(Vec a, Vec b) { return map(a, b, [](float x, float y) { return x / y; }); }
+inline Vec min(Vec a, Vec b) { return map(a, b, [](float x, float y) { return std::min(x, y); }); }
+inline Vec max(Vec a, Vec b) { return map(a, b, [](float x, float y) { return std::max(x, y); }); }
+inline Vec abs(Vec v) { return {{std::fabs(v.lane[0]), std::fabs(v.lane[1]), std::fabs(v.lane[2]), std::fabs(v.lane[3])}}; }
+inline float maxLane(Vec v) { return std::max(std::max(v.lane[0], v.lane[1]), std::max(v.lane[2], v.lane[3])); }
+#endif
+
+// One frame of N channels into the low lanes (the rest are zero), and back
+template <int N>
+inline Vec loadFrame(const float* p) {
+  alignas(16) float lanes[4] = {};
+  std::memcpy(lanes, p, N * sizeof(float));
+  return load(lanes);
+}
+
+template <int N>
+inline void storeFrame(float* p, Vec v) {
+  alignas(16) float lanes[4];
+  store(lanes, v);
+  std::memcpy(p, lanes, N * sizeof(float));
+}
+
+#if defined(MPCCLI_SIMD_SSE)
+// Stereo frames move as one 64-bit lane pair instead of through the stack
+template <>
+inline Vec loadFrame<2>(const float* p) {
+  return _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(p));
+}
+
+template <>
+inline void storeFrame<2>(float* p, Vec v) {
+  _mm_storel_pi(reinterpret_cast<__m64*>(p), v);
+}
+#elif defined(MPCCLI_SIMD_NEON)
+template <>
+inline Vec loadFrame<2>(const float* p) {
+  return vcombine_f32(vld1_f32(p), vdup_n_f32(0.0f));
+}
+
+template <>
+inline void storeFrame<2>(float* p, Vec v) {
+  vst1_f32(p, vget_low_f32(v));
+}
+#endif
+
+// Sum of the four lanes
+inline float sumLanes(Vec v) {
+  alignas(16) float lanes[4];
+  store(lanes, v);
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+}  // namespace mpccli::simd
@@ -0,0 +1,141 @@
+#include "time_stretch.h"
+#include "resampler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace mpccli {
+
+namespace {
+
+// ~21 ms analysis window at 48 kHz with 50% overlap
+constexpr size_t kWindowSize = 1024;
+constexpr size_t kSynthesisHop = kWindowSize / 2;
+// How far (in frames) each window may move to line up with the previous one
+constexpr int kSearchTolerance = 256;
+// Decimation used for the similarity search (keeps it cheap enough for long samples)
+constexpr int kSearchStep = 2;
+constexpr size_t kCorrelationStep = 4;
+
+// Mono mix used only for the similarity search
+std::vector<float> downmix(const SampleBuffer& input) {
+  const size_t frames = input.frames();
+  std::vector<float> mono(frames, 0.0f);
+  const float scale = 1.0f / input.channels;
+  for (size_t i = 0; i < frames; ++i) {
+    float sum = 0.0f;
+    for (int c = 0; c < input.channels; ++c) {
+      sum += input.data()[i * input.channels + c];
+    }
+    mono[i] = sum * scale;
+  }
+  return mono;
+}
+
+// Normalised cross-correlation between mono[a..a+N) and mono[b..b+N)
+float similarity(const std::vector<float>& mono, size_t a, size_t b) {
+  const size_t frames = mono.size();
+  float corr = 0.0f;
+  float energy = 0.0f;
+  for (size_t n = 0; n < kWindowSize; n += kCorrelationStep) {
+    if (a + n >= frames || b + n >= frames) {
+      break;
+    }
+    float x = mono[a + n];
+    float y = mono[b + n];
+    corr += x * y;
+    energy += y * y;
+  }
+  return energy > 0.0f ? corr / std::sqrt(energy) : 0.0f;
+}
+
+}  // namespace
+
+SampleBuffer timeStretch(const SampleBuffer& input, double factor) {
+  const size_t in_frames = input.frames();
+  if (in_frames == 0 || factor <= 0.0 || std::abs(factor - 1.0) < 1e-6) {
+    return input;
+  }
+
+  const int channels = input.channels;
+  const size_t out_frames = static_cast<size_t>(std::ceil(in_frames * factor));
+  const double analysis_hop = kSynthesisHop / factor;
+
+  // Periodic Hann window: overlapping copies at 50% sum to one
+  std::vector<float> window(kWindowSize);
+  for (size_t n = 0; n < kWindowSize; ++n) {
+    window[n] = 0.5f - 0.5f * std::cos(2.0f * static_cast<float>(M_PI) * n / kWindowSize);
+  }
+
+  std::vector<float> mono = downmix(input);
+  std::vector<float> output((out_frames + kWindowSize) * channels, 0.0f);
+  std::vector<float> weight(out_frames + kWindowSize, 0.0f);
+
+  size_t previous_pos = 0;
+  for (size_t k = 0; k * kSynthesisHop < out_frames; ++k) {
+    const long nominal = std::lround(k * analysis_hop);
+    size_t pos = 0;
+
+    if (k > 0) {
+      // Pick the window near the nominal position that best continues the previous one
+      const size_t target = previous_pos + kSynthesisHop;
+      float best = -1e30f;
+      for (int d = -kSearchTolerance; d <= kSearchTolerance; d += kSearchStep) {
+        long candidate = nominal + d;
+        if (candidate < 0 || static_cast<size_t>(candidate) >= in_frames) {
+          continue;
+        }
+        float score = similarity(mono, target, static_cast<size_t>(candidate));
+        if (score > best) {
+          best = score;
+          pos = static_cast<size_t>(candidate);
+        }
+      }
+    }
+
+    // Overlap-add the chosen window into the output
+    const size_t out_start = k * kSynthesisHop;
+    for (size_t n = 0; n < kWindowSize && pos + n < in_frames; ++n) {
+      const float w = window[n];
+      const float* src = input.data() + (pos + n) * channels;
+      float* dst = &output[(out_start + n) * channels];
+      for (int c = 0; c < channels; ++c) {
+        dst[c] += src[c] * w;
+      }
+      weight[out_start + n] += w;
+    }
+
+    previous_pos = pos;
+  }
+
+  // Normalise by the accumulated window weight (only matters at the edges)
+  for (size_t i = 0; i < out_frames; ++i) {
+    if (weight[i] > 1e-3f) {
+      const float inv = 1.0f / weight[i];
+      for (int c = 0; c < channels; ++c) {
+        output[i * channels + c] *= inv;
+      }
+    }
+  }
+  output.resize(out_frames * channels);
+
+  SampleBuffer result;
+  result.samples = std::move(output);
+  result.channels = channels;
+  result.sample_rate = input.sample_rate;
+  return result;
+}
+
+SampleBuffer pitchShift(const SampleBuffer& input, double semitones) {
+  if (std::abs(semitones) < 1e-6 || input.frames() == 0) {
+    return input;
+  }
+
+  const double ratio = std::pow(2.0, semitones / 12.0);
+  SampleBuffer stretched = timeStretch(input, ratio);
+
+  // Read the stretched audio `ratio` times faster, which restores the original
+  // duration and raises the pitch by `ratio`
+  return resampleBuffer(stretched, ratio, input.frames());
+}
+
+}  // namespace mpccli
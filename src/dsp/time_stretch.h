@@ -0,0 +1,16 @@
+#pragma once
+
+#include "sample_buffer.h"
+
+namespace mpccli {
+
+// WSOLA (waveform-similarity overlap-add) time stretcher.
+// factor > 1.0 makes the audio longer, < 1.0 shorter; pitch is unchanged.
+SampleBuffer timeStretch(const SampleBuffer& input, double factor);
+
+// Shift pitch by semitones while keeping the original duration:
+// time-stretch by the pitch ratio, then resample back to the original length.
+// 0 = original pitch, +12 = one octave up, -12 = one octave down
+SampleBuffer pitchShift(const SampleBuffer& input, double semitones);
+
+}  // namespace mpccli
@@ -0,0 +1,418 @@
+#include "audio_engine.h"
+#include <algorithm>
+#include <cmath>
+
+namespace mpccli {
+
+namespace {
+
+constexpr uint8_t kNoTask = 0xFF;
+
+}  // namespace
+
+AudioEngine::AudioEngine(double sample_rate, int channels)
+    : sample_rate_(sample_rate),
+      channels_(channels),
+      quality_(ResamplerQuality::Cubic),
+      tempo_(120.0),
+      pool_(std::make_unique<RenderPool>(1)),
+      mixer_(new MixerGraph(MixerRouting{}, sample_rate, channels, kMaxBlockFrames)),
+      pending_mixer_(nullptr),
+      mixer_latency_frames_(mixer_->latencyFrames()),
+      scheduled_count_(0),
+      frames_rendered_(0),
+      render_epoch_ns_(0),
+      voice_counter_(0),
+      active_voices_(0),
+      scratch_(kMaxBlockFrames * channels, 0.0f),
+      pad_task_count_(0),
+      pad_level_count_(0),
+      level_frames_(0),
+      late_renders_(0),
+      dropped_scheduled_(0) {
+  pad_task_index_.fill(kNoTask);
+  pad_sum_squares_.fill(0.0f);
+}
+
+AudioEngine::~AudioEngine() {
+  delete mixer_;
+  delete pending_mixer_.load();
+  MixerGraph* retired;
+  while (retired_mixers_.pop(retired)) {
+    delete retired;
+  }
+}
+
+void AudioEngine::setRenderThreads(size_t threads) {
+  threads = std::clamp<size_t>(threads, 1, kMaxRenderThreads);
+  if (threads == pool_->threads()) {
+    return;
+  }
+  pool_ = std::make_unique<RenderPool>(threads, worker_setup_);
+  scratch_.assign(threads * kMaxBlockFrames * channels_, 0.0f);
+  delete mixer_;
+  mixer_ = new MixerGraph(MixerRouting{}, sampleRate(), channels_, kMaxBlockFrames, threads);
+  mixer_latency_frames_.store(mixer_->latencyFrames(), std::memory_order_relaxed);
+}
+
+void AudioEngine::setSampleRate(double sample_rate) {
+  if (sample_rate == sampleRate()) {
+    return;
+  }
+  sample_rate_.store(sample_rate, std::memory_order_relaxed);
+
+  // Nothing carries over: playing and scheduled notes, frame timing and the mixer were
+  // all measured at the old rate
+  for (Voice& voice : voices_) {
+    voice.active = false;
+  }
+  active_voices_.store(0, std::memory_order_relaxed);
+  scheduled_count_ = 0;
+  frames_rendered_ = 0;
+  render_epoch_ns_.store(0, std::memory_order_relaxed);
+  level_frames_ = 0;
+  TriggerEvent event;
+  while (triggers_.pop(event)) {
+  }
+  delete pending_mixer_.exchange(nullptr, std::memory_order_acq_rel);
+  delete mixer_;
+  mixer_ = new MixerGraph(MixerRouting{}, sample_rate, channels_, kMaxBlockFrames, pool_->threads());
+  mixer_latency_frames_.store(mixer_->latencyFrames(), std::memory_order_relaxed);
+}
+
+void AudioEngine::setMixer(std::unique_ptr<MixerGraph> mixer) {
+  // Free graphs the audio thread has switched away from
+  MixerGraph* retired;
+  while (retired_mixers_.pop(retired)) {
+    delete retired;
+  }
+
+  // A graph that was never picked up can go straight away
+  delete pending_mixer_.exchange(mixer.release(), std::memory_order_acq_rel);
+}
+
+bool AudioEngine::trigger(const TriggerEvent& event) {
+  if (!event.buffer || event.buffer->frames() == 0) {
+    return false;
+  }
+  return triggers_.push(event);
+}
+
+bool AudioEngine::release(PadId pad, int cents) {
+  TriggerEvent event{};
+  event.pad = pad;
+  event.cents = cents;
+  event.note_off = true;
+  return triggers_.push(event);
+}
+
+uint64_t AudioEngine::frameAt(std::chrono::steady_clock::time_point time) const {
+  const int64_t epoch = render_epoch_ns_.load(std::memory_order_relaxed);
+  if (epoch == 0) {
+    return 0;
+  }
+  const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count() - epoch;
+  return ns > 0 ? static_cast<uint64_t>(ns * 1e-9 * sampleRate()) : 0;
+}
+
+void AudioEngine::startVoice(const TriggerEvent& event, size_t offset) {
+  if (event.received != std::chrono::steady_clock::time_point{}) {
+    const double latency = std::max(0.0, std::chrono::duration<double>(render_started_ - event.received).count());
+    trigger_latency_.record(latency);
+    if (event.source == TriggerSource::Midi) {
+      midi_latency_.record(latency);
+    }
+  }
+
+  if (event.choke_group != 0) {
+    chokeGroup(event.choke_group);
+  }
+
+  Voice* slot = nullptr;
+  for (Voice& voice : voices_) {
+    if (!voice.active) {
+      slot = &voice;
+      break;
+    }
+    if (!slot || voice.start_order < slot->start_order) {
+      slot = &voice;
+    }
+  }
+
+  slot->buffer = event.buffer;
+  slot->position = 0.0;
+  // Fold any sample rate difference into the read step
+  slot->step = event.step * event.buffer->sample_rate / sampleRate();
+  slot->gain = event.gain;
+  slot->pad = event.pad;
+  slot->cents = event.cents;
+  slot->start_order = ++voice_counter_;
+  slot->epoch = event.epoch;
+  slot->start_offset = offset;
+  slot->active = true;
+  slot->choke_group = event.choke_group;
+  slot->use_envelope = event.use_envelope;
+  if (event.use_envelope) {
+    slot->envelope.start(event.envelope, sampleRate());
+  }
+}
+
+void AudioEngine::releaseVoices(PadId pad, int cents) {
+  for (Voice& voice : voices_) {
+    if (voice.active && voice.use_envelope && voice.pad == pad && voice.cents == cents) {
+      voice.envelope.release();
+    }
+  }
+}
+
+void AudioEngine::chokeGroup(int group) {
+  for (Voice& voice : voices_) {
+    if (!voice.active || voice.choke_group != group) {
+      continue;
+    }
+    fadeOutVoice(voice);
+  }
+}
+
+void AudioEngine::fadeOutVoice(Voice& voice) {
+  if (voice.use_envelope && voice.envelope.finished()) {
+    return;
+  }
+  // Voices without an envelope play at full level, so fade from there
+  const float level = voice.use_envelope ? voice.envelope.level() : 1.0f;
+  voice.envelope.fadeOut(level, kChokeFadeSeconds, sampleRate());
+  voice.use_envelope = true;
+}
+
+void AudioEngine::stopVoices(PadId pad) {
+  for (Voice& voice : voices_) {
+    if (voice.active && voice.pad == pad) {
+      fadeOutVoice(voice);
+    }
+  }
+  for (size_t i = 0; i < scheduled_count_;) {
+    if (scheduled_[i].pad == pad) {
+      scheduled_[i] = scheduled_[--scheduled_count_];
+    } else {
+      ++i;
+    }
+  }
+}
+
+bool AudioEngine::stopPad(PadId pad) {
+  TriggerEvent event{};
+  event.pad = pad;
+  event.stop_pad = true;
+  return triggers_.push(event);
+}
+
+void AudioEngine::startScheduled(size_t frames) {
+  const uint64_t block_end = frames_rendered_ + frames;
+  for (size_t i = 0; i < scheduled_count_;) {
+    const TriggerEvent& event = scheduled_[i];
+    if (event.start_frame >= block_end) {
+      ++i;
+      continue;
+    }
+    const size_t offset = event.start_frame > frames_rendered_ ? event.start_frame - frames_rendered_ : 0;
+    startVoice(event, offset);
+    scheduled_[i] = scheduled_[--scheduled_count_];
+  }
+}
+
+void AudioEngine::render(float* output, size_t frames) {
+  const auto now = std::chrono::steady_clock::now();
+  render_started_ = now;
+
+  // Track when frame 0 was rendered. The output thread wakes with some jitter, so follow
+  // the per-call estimate slowly rather than jumping to it.
+  const int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+  const int64_t estimate = now_ns - static_cast<int64_t>(frames_rendered_ * 1e9 / sampleRate());
+  const int64_t epoch = render_epoch_ns_.load(std::memory_order_relaxed);
+  render_epoch_ns_.store(epoch == 0 ? estimate : epoch + (estimate - epoch) / 16, std::memory_order_relaxed);
+
+  // Switch to a new mixer between blocks. At most one graph is replaced per setMixer()
+  // call, which drains the retired queue first, so it never fills up.
+  if (MixerGraph* mixer = pending_mixer_.exchange(nullptr, std::memory_order_acq_rel)) {
+    retired_mixers_.push(mixer_);
+    mixer_ = mixer;
+    mixer_latency_frames_.store(mixer_->latencyFrames(), std::memory_order_relaxed);
+  }
+
+  // Start (or schedule) every note queued since the last call
+  TriggerEvent event;
+  while (triggers_.pop(event)) {
+    if (event.stop_pad) {
+      stopVoices(event.pad);
+    } else if (event.note_off) {
+      releaseVoices(event.pad, event.cents);
+    } else if (event.start_frame > frames_rendered_) {
+      // Starting it now would play it early: a full schedule drops the note instead
+      if (scheduled_count_ < kMaxScheduled) {
+        scheduled_[scheduled_count_++] = event;
+      } else {
+        dropped_scheduled_.fetch_add(1, std::memory_order_relaxed);
+      }
+    } else {
+      startVoice(event);
+    }
+  }
+
+  // Only the pads that sounded last time need clearing
+  for (size_t i = 0; i < pad_level_count_; ++i) {
+    pad_sum_squares_[pad_levels_[i].pad] = 0.0f;
+  }
+  pad_level_count_ = 0;
+  level_frames_ = frames;
+
+  while (frames > 0) {
+    size_t block = std::min(frames, kMaxBlockFrames);
+    renderBlock(output, block);
+    output += block * channels_;
+    frames -= block;
+  }
+
+  // Per-pad RMS for metering
+  const float samples = static_cast<float>(std::max<size_t>(level_frames_, 1) * channels_);
+  for (size_t i = 0; i < pad_level_count_; ++i) {
+    PadLevel& level = pad_levels_[i];
+    level.level = std::sqrt(pad_sum_squares_[level.pad] / samples);
+  }
+
+  // Cost of the send effects over the whole call
+  if (mixer_->hasSendEffect(SendEffectType::Reverb)) {
+    reverb_time_.record(mixer_->takeSendEffectSeconds(SendEffectType::Reverb));
+  }
+  if (mixer_->hasSendEffect(SendEffectType::Delay)) {
+    delay_time_.record(mixer_->takeSendEffectSeconds(SendEffectType::Delay));
+  }
+
+  // Let retired buffers go once no voice or scheduled note uses them
+  epochs_.publishRender(oldestEpochInUse());
+
+  // A render slower than real time means the device will run dry
+  const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - now).count();
+  const double deadline = level_frames_ / sampleRate();
+  render_time_.record(elapsed);
+  deadline_ratio_.record(deadline > 0.0 ? elapsed / deadline : 0.0);
+  if (elapsed > deadline) {
+    late_renders_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+uint64_t AudioEngine::oldestEpochInUse() const {
+  uint64_t oldest = ReclaimEpochs::kNothingInUse;
+  for (const Voice& voice : voices_) {
+    if (voice.active) {
+      oldest = std::min(oldest, voice.epoch);
+    }
+  }
+  for (size_t i = 0; i < scheduled_count_; ++i) {
+    oldest = std::min(oldest, scheduled_[i].epoch);
+  }
+  return oldest;
+}
+
+void AudioEngine::renderBlock(float* output, size_t frames) {
+  mixer_->beginBlock(frames, tempo_.load(std::memory_order_relaxed));
+
+  startScheduled(frames);
+
+  // Group the active voices by pad, keeping their order within each pad
+  pad_task_count_ = 0;
+  for (size_t v = 0; v < kMaxVoices; ++v) {
+    Voice& voice = voices_[v];
+    if (!voice.active) {
+      continue;
+    }
+    voice.next_in_pad = -1;
+    uint8_t& index = pad_task_index_[voice.pad];
+    if (index == kNoTask) {
+      index = static_cast<uint8_t>(pad_task_count_);
+      pad_tasks_[pad_task_count_++] = {voice.pad, static_cast<int>(v), static_cast<int>(v), 0.0f};
+    } else {
+      PadTask& task = pad_tasks_[index];
+      voices_[task.last_voice].next_in_pad = static_cast<int>(v);
+      task.last_voice = static_cast<int>(v);
+    }
+  }
+
+  // Render the pads, spread over the pool when the mixer has a direct buffer per worker
+  const ResamplerQuality quality = quality_.load(std::memory_order_relaxed);
+  auto render_pad = [this, frames, quality](size_t task, size_t worker) {
+    renderPad(pad_tasks_[task], frames, worker, quality);
+  };
+  if (mixer_->workers() >= pool_->threads()) {
+    pool_->run(pad_task_count_, render_pad);
+  } else {
+    for (size_t task = 0; task < pad_task_count_; ++task) {
+      render_pad(task, 0);
+    }
+  }
+
+  // Collect the pad levels in the order the pads first sounded
+  for (size_t i = 0; i < pad_task_count_; ++i) {
+    const PadTask& task = pad_tasks_[i];
+    pad_task_index_[task.pad] = kNoTask;
+    if (task.sum_squares > 0.0f) {
+      if (pad_sum_squares_[task.pad] == 0.0f) {
+        pad_levels_[pad_level_count_++] = {task.pad, 0.0f};
+      }
+      pad_sum_squares_[task.pad] += task.sum_squares;
+    }
+  }
+
+  // Sum the channels through the buses into the output
+  mixer_->finishBlock(output, *pool_);
+
+  size_t active = 0;
+  for (const Voice& voice : voices_) {
+    active += voice.active ? 1 : 0;
+  }
+  frames_rendered_ += frames;
+  active_voices_.store(active, std::memory_order_relaxed);
+}
+
+void AudioEngine::renderPad(PadTask& task, size_t frames, size_t worker, ResamplerQuality quality) {
+  const size_t samples = frames * channels_;
+  const Resampler& resampler = defaultResampler();
+  float* scratch = scratch_.data() + worker * kMaxBlockFrames * channels_;
+  float* channel = mixer_->padInput(task.pad, worker);
+
+  for (int v = task.first_voice; v >= 0; v = voices_[v].next_in_pad) {
+    Voice& voice = voices_[v];
+
+    // A scheduled voice starts part-way into its first block
+    const size_t begin = voice.start_offset;
+    voice.start_offset = 0;
+
+    // Render into scratch first so the voice can be metered on its own
+    std::fill(scratch, scratch + samples, 0.0f);
+    voice.position = resampler.process(quality, *voice.buffer, voice.position, voice.step,
+                                       voice.gain, scratch + begin * channels_, frames - begin);
+
+    // Apply the envelope at control rate, interpolating the gain in between
+    if (voice.use_envelope) {
+      for (size_t offset = begin; offset < frames && !voice.envelope.finished(); offset += kEnvelopeBlockFrames) {
+        const size_t n = std::min(kEnvelopeBlockFrames, frames - offset);
+        const float gain_start = voice.envelope.level();
+        const float gain_end = voice.envelope.advance(n);
+        task.sum_squares += mixWithGainRamp(channel + offset * channels_, scratch + offset * channels_,
+                                            n, channels_, gain_start, gain_end);
+      }
+    } else {
+      task.sum_squares += mixWithGainRamp(channel + begin * channels_, scratch + begin * channels_,
+                                          frames - begin, channels_, 1.0f, 1.0f);
+    }
+
+    // Voices are freed at the end of the sample or as soon as their release completes
+    if (voice.position >= static_cast<double>(voice.buffer->frames()) ||
+        (voice.use_envelope && voice.envelope.finished())) {
+      voice.active = false;
+    }
+  }
+
+  mixer_->finishPad(task.pad);
+}
+
+}  // namespace mpccli
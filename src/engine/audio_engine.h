@@ -0,0 +1,264 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+#include "deadline_histogram.h"
+#include "latency_histogram.h"
+#include "lockfree_queue.h"
+#include "mixer_graph.h"
+#include "reclaim_epochs.h"
+#include "render_pool.h"
+#include "../dsp/envelope.h"
+#include "../dsp/resampler.h"
+#include "../dsp/sample_buffer.h"
+#include "../kit/pad.h"
+
+namespace mpccli {
+
+// Where a note came from, so latency can be reported per input
+enum class TriggerSource : uint8_t {
+  Local,   // Keyboard or sequencer
+  Midi,
+  Remote,  // OSC or the control socket
+};
+
+// A note to start (or release) on the audio thread
+struct TriggerEvent {
+  PadId pad;
+  int cents;                   // Pitch the note was played at, used to match note-offs
+  const SampleBuffer* buffer;  // Must outlive every voice playing it (owned by AudioProcessor)
+  uint64_t epoch = 0;          // Pinned while `buffer` was looked up (see ReclaimEpochs)
+  double step;                 // Pitch ratio (1.0 = original pitch)
+  float gain;
+  bool use_envelope = false;   // Without an envelope the voice plays to the end of the sample
+  AdsrParams envelope;
+  int choke_group = 0;         // Starting this note chokes other voices in the group (0 = none)
+  bool note_off = false;       // Release voices matching pad/cents instead of starting one
+  bool stop_pad = false;       // Fade out every voice of the pad and drop its scheduled notes
+  std::chrono::steady_clock::time_point received{};  // When the note was due to render (epoch = not measured)
+  TriggerSource source = TriggerSource::Local;
+  uint64_t start_frame = 0;    // Engine frame to start on, for sample-accurate scheduling (0 = next block)
+};
+
+// RMS level of one pad over a render() call
+struct PadLevel {
+  PadId pad;
+  float level;
+};
+
+// Real-time sample playback engine.
+// Mixes up to kMaxVoices voices, each reading a decoded SampleBuffer through the shared
+// Resampler, into the pad channels of a MixerGraph, which sums them through its buses into
+// the output. trigger() is lock-free and may be called from any thread; render() must only
+// be called from the audio output thread and never allocates or blocks.
+//
+// With more than one render thread, each block's pads are spread over a RenderPool (a pad's
+// voices always render on one worker) and the mixer's bus levels are summed the same way.
+class AudioEngine {
+ public:
+  static constexpr size_t kMaxVoices = 64;
+  static constexpr size_t kMaxBlockFrames = 1024;  // Larger render() calls are split
+  static constexpr size_t kEnvelopeBlockFrames = 64;  // Envelope control rate (gain is interpolated)
+  static constexpr float kChokeFadeSeconds = 0.005f;  // Fade applied to choked voices before they are freed
+  static constexpr size_t kMaxScheduled = 256;  // Future triggers held by the engine (more are dropped)
+  static constexpr size_t kMaxRenderThreads = 16;
+
+  explicit AudioEngine(double sample_rate = kEngineSampleRate, int channels = kEngineChannels);
+  ~AudioEngine();
+
+  AudioEngine(const AudioEngine&) = delete;
+  AudioEngine& operator=(const AudioEngine&) = delete;
+
+  // Threads rendering each block, including the audio thread (1 = render inline). Replaces
+  // the mixer with an empty one compiled for that many workers, so call it before start()
+  // and before setMixer(); not while render() may be running.
+  void setRenderThreads(size_t threads);
+  size_t renderThreads() const { return pool_->threads(); }
+
+  // Run by each render worker thread as it starts (for worker numbers 1 and up; the audio
+  // thread is worker 0). Applies to pools created by later setRenderThreads() calls.
+  void setWorkerSetup(RenderPool::ThreadSetup setup) { worker_setup_ = std::move(setup); }
+
+  // Run at another output rate. Stops every voice and scheduled note and replaces the
+  // mixer with an empty one, like setRenderThreads(); not while render() may be running.
+  // Samples keep their own rate and are resampled as they play.
+  void setSampleRate(double sample_rate);
+
+  // Replace the mixer (compiled with kMaxBlockFrames for this engine's sample rate, channel
+  // count and renderThreads() workers).
+  // Takes effect at the next render() call; voices keep playing through the new channels.
+  // Call from one thread at a time (not the audio thread); the replaced graph is freed by
+  // a later call or the destructor, never on the audio thread.
+  void setMixer(std::unique_ptr<MixerGraph> mixer);
+
+  // Queue a note to start at the beginning of the next rendered block.
+  // Returns false if the trigger queue is full.
+  bool trigger(const TriggerEvent& event);
+
+  // Reclamation of the buffers triggers hand to the engine: pin an epoch while looking a
+  // buffer up and queueing its trigger (TriggerEvent::epoch), and free a replaced buffer
+  // only once it is reclaimable. render() reports which epochs its voices still use.
+  ReclaimEpochs& epochs() { return epochs_; }
+
+  // Queue a note-off: voices of `pad` played at `cents` enter their release stage
+  // (voices without an envelope ignore it). Returns false if the queue is full.
+  bool release(PadId pad, int cents);
+
+  // Queue a hard stop of every voice (and scheduled note) of `pad`, faded over
+  // kChokeFadeSeconds. Returns false if the queue is full.
+  bool stopPad(PadId pad);
+
+  // Render `frames` interleaved frames into `output` (overwrites its contents)
+  void render(float* output, size_t frames);
+
+  // Engine frame rendered at `time`, for TriggerEvent::start_frame. Estimated from recent
+  // render() calls (smoothed, so output-thread jitter doesn't move scheduled notes);
+  // 0 until the first render. Safe to call from any thread.
+  uint64_t frameAt(std::chrono::steady_clock::time_point time) const;
+
+  // Tempo that synced effects (the send delay) follow; takes effect at the next block
+  void setTempo(double bpm) { tempo_.store(bpm, std::memory_order_relaxed); }
+  double tempo() const { return tempo_.load(std::memory_order_relaxed); }
+
+  void setResamplerQuality(ResamplerQuality quality) { quality_.store(quality, std::memory_order_relaxed); }
+  ResamplerQuality resamplerQuality() const { return quality_.load(std::memory_order_relaxed); }
+
+  // RMS level of every pad that sounded in the most recent render() call
+  // (read from the audio thread after render)
+  std::span<const PadLevel> padLevels() const { return {pad_levels_.data(), pad_level_count_}; }
+
+  // Time from a note's `received` timestamp to the start of the render() call that starts
+  // its voice (scheduled notes are recorded when they start), for every timestamped trigger
+  // and for MIDI notes alone
+  const LatencyHistogram& triggerLatency() const { return trigger_latency_; }
+  const LatencyHistogram& midiLatency() const { return midi_latency_; }
+
+  // Wall time spent in each render() call
+  const LatencyHistogram& renderTime() const { return render_time_; }
+
+  // Each render() call's wall time over its deadline, the duration of the audio it produced
+  const DeadlineHistogram& deadlineRatio() const { return deadline_ratio_; }
+
+  // Time the send reverbs and delays took in each render() call (recorded only while the
+  // mixer has one)
+  const LatencyHistogram& reverbTime() const { return reverb_time_; }
+  const LatencyHistogram& delayTime() const { return delay_time_; }
+
+  // Frames the current mixer delays its output by (its master limiter's lookahead)
+  size_t mixerLatencyFrames() const { return mixer_latency_frames_.load(std::memory_order_relaxed); }
+
+  // render() calls that took longer than the audio they produced (the output will underrun)
+  uint64_t lateRenders() const { return late_renders_.load(std::memory_order_relaxed); }
+
+  size_t activeVoices() const { return active_voices_.load(std::memory_order_relaxed); }
+
+  // Notes dropped because kMaxScheduled were already waiting to start
+  uint64_t droppedScheduled() const { return dropped_scheduled_.load(std::memory_order_relaxed); }
+
+  double sampleRate() const { return sample_rate_.load(std::memory_order_relaxed); }
+  int channels() const { return channels_; }
+
+ private:
+  struct Voice {
+    const SampleBuffer* buffer = nullptr;
+    double position = 0.0;
+    double step = 1.0;
+    float gain = 1.0f;
+    PadId pad = kNoPad;
+    int cents = 0;
+    uint64_t start_order = 0;  // Used to steal the oldest voice when all are busy
+    uint64_t epoch = 0;        // Of the trigger that started it (keeps its buffer alive)
+    size_t start_offset = 0;   // Silent frames before a scheduled voice starts in its first block
+    bool active = false;
+    int choke_group = 0;
+    bool use_envelope = false;
+    AdsrEnvelope envelope;
+    int next_in_pad = -1;  // Next voice of the same pad in this block
+  };
+
+  // The voices of one pad in a block, rendered by a single worker
+  struct PadTask {
+    PadId pad;
+    int first_voice;
+    int last_voice;
+    float sum_squares;
+  };
+
+  // Start a voice for a trigger, stealing the oldest one if none are free.
+  // `offset` delays it by that many frames into the next rendered block.
+  void startVoice(const TriggerEvent& event, size_t offset = 0);
+
+  // Start scheduled triggers that fall inside the next `frames` frames
+  void startScheduled(size_t frames);
+
+  // Put every matching voice into its release stage
+  void releaseVoices(PadId pad, int cents);
+
+  // Quickly fade out every voice in a choke group; they are freed once silent
+  void chokeGroup(int group);
+
+  // Fade out one voice over kChokeFadeSeconds
+  void fadeOutVoice(Voice& voice);
+
+  // Fade out every voice of a pad and forget its scheduled notes
+  void stopVoices(PadId pad);
+
+  // Oldest trigger epoch a voice or scheduled note still holds (ReclaimEpochs::kNothingInUse if none)
+  uint64_t oldestEpochInUse() const;
+
+  // Render one block of at most kMaxBlockFrames
+  void renderBlock(float* output, size_t frames);
+
+  // Render a pad's voices into its mixer channel, using the scratch space of `worker`
+  void renderPad(PadTask& task, size_t frames, size_t worker, ResamplerQuality quality);
+
+  std::atomic<double> sample_rate_;  // Read by frameAt() from any thread
+  int channels_;
+  std::atomic<ResamplerQuality> quality_;
+  std::atomic<double> tempo_;
+  ReclaimEpochs epochs_;
+  LockFreeQueue<TriggerEvent, 256> triggers_;
+
+  std::unique_ptr<RenderPool> pool_;
+  RenderPool::ThreadSetup worker_setup_;
+  MixerGraph* mixer_;                        // Used by the audio thread (owned)
+  std::atomic<MixerGraph*> pending_mixer_;   // Set by setMixer(), picked up by render()
+  std::atomic<size_t> mixer_latency_frames_;  // Of mixer_
+  LockFreeQueue<MixerGraph*, 8> retired_mixers_;  // Replaced by render(), freed by setMixer()
+
+  std::array<Voice, kMaxVoices> voices_;
+  std::array<TriggerEvent, kMaxScheduled> scheduled_;  // Unordered; scanned once per block
+  size_t scheduled_count_;
+  uint64_t frames_rendered_;
+  std::chrono::steady_clock::time_point render_started_;  // Of the current render() call
+  std::atomic<int64_t> render_epoch_ns_;  // Steady-clock time of frame 0 (0 = not rendering yet)
+
+  uint64_t voice_counter_;
+  std::atomic<size_t> active_voices_;
+
+  std::vector<float> scratch_;  // One voice's output for a block, per render worker (preallocated)
+  std::array<PadTask, kMaxVoices> pad_tasks_;  // Pads with active voices in the current block
+  size_t pad_task_count_;
+  std::array<uint8_t, kMaxPads> pad_task_index_;  // Into pad_tasks_ (kNoTask for other pads)
+  std::array<float, kMaxPads> pad_sum_squares_;  // Zero for every pad not in pad_levels_
+  std::array<PadLevel, kMaxPads> pad_levels_;    // Pads that sounded, in the order they first did
+  size_t pad_level_count_;
+  size_t level_frames_;
+
+  LatencyHistogram trigger_latency_;
+  LatencyHistogram midi_latency_;
+  LatencyHistogram render_time_;
+  DeadlineHistogram deadline_ratio_;
+  LatencyHistogram reverb_time_;
+  LatencyHistogram delay_time_;
+  std::atomic<uint64_t> late_renders_;
+  std::atomic<uint64_t> dropped_scheduled_;
+};
+
+}  // namespace mpccli
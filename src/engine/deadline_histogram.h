@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace mpccli {
+
+// Lock-free histogram of render time as a fraction of the buffer's deadline (the audio
+// the render produced), in linear 10% buckets. A ratio above 1 is an overrun: the render
+// took longer than the audio it produced, eating into the device's buffer. Like
+// LatencyHistogram, record() is wait-free for the audio thread and snapshot() may be
+// called from any thread.
+class DeadlineHistogram {
+ public:
+  // Bucket i counts ratios below (i + 1) / 10; the last bucket (150% and up) is unbounded
+  static constexpr size_t kBuckets = 16;
+  static constexpr uint64_t kBucketPpm = 100000;
+
+  struct Snapshot {
+    uint64_t count = 0;
+    double mean_ratio = 0.0;
+    double max_ratio = 0.0;
+    std::array<uint64_t, kBuckets> buckets{};
+
+    // Upper bound of the bucket holding the given fraction (0-1) of renders
+    double percentileRatio(double fraction) const {
+      const uint64_t target = static_cast<uint64_t>(fraction * count);
+      uint64_t seen = 0;
+      for (size_t i = 0; i < kBuckets; ++i) {
+        seen += buckets[i];
+        if (seen > target) {
+          return i + 1 < kBuckets ? bucketUpperRatio(i) : max_ratio;
+        }
+      }
+      return max_ratio;
+    }
+
+    // The renders recorded after `earlier` (a snapshot of the same histogram). The maximum
+    // can't be split, so it stays the overall one.
+    Snapshot since(const Snapshot& earlier) const {
+      Snapshot s = *this;
+      s.count = count - earlier.count;
+      s.mean_ratio = s.count > 0 ? (mean_ratio * count - earlier.mean_ratio * earlier.count) / s.count : 0.0;
+      for (size_t i = 0; i < kBuckets; ++i) {
+        s.buckets[i] = buckets[i] - earlier.buckets[i];
+      }
+      return s;
+    }
+  };
+
+  DeadlineHistogram() { reset(); }
+
+  void record(double ratio) {
+    // Sums and maxima are kept in millionths
+    const uint64_t ppm = ratio > 0.0 ? static_cast<uint64_t>(ratio * 1e6) : 0;
+    const size_t bucket = static_cast<size_t>(std::min<uint64_t>(ppm / kBucketPpm, kBuckets - 1));
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_ppm_.fetch_add(ppm, std::memory_order_relaxed);
+
+    uint64_t max = max_ppm_.load(std::memory_order_relaxed);
+    while (ppm > max && !max_ppm_.compare_exchange_weak(max, ppm, std::memory_order_relaxed)) {
+    }
+  }
+
+  Snapshot snapshot() const {
+    Snapshot s;
+    s.count = count_.load(std::memory_order_relaxed);
+    if (s.count > 0) {
+      s.mean_ratio = sum_ppm_.load(std::memory_order_relaxed) * 1e-6 / s.count;
+    }
+    s.max_ratio = max_ppm_.load(std::memory_order_relaxed) * 1e-6;
+    for (size_t i = 0; i < kBuckets; ++i) {
+      s.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    return s;
+  }
+
+  void reset() {
+    for (auto& bucket : buckets_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_ppm_.store(0, std::memory_order_relaxed);
+    max_ppm_.store(0, std::memory_order_relaxed);
+  }
+
+  static double bucketUpperRatio(size_t bucket) {
+    return static_cast<double>((bucket + 1) * kBucketPpm) * 1e-6;
+  }
+
+ private:
+  std::array<std::atomic<uint64_t>, kBuckets> buckets_;
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_ppm_;
+  std::atomic<uint64_t> max_ppm_;
+};
+
+}  // namespace mpccli
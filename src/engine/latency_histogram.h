@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace mpccli {
+
+// Lock-free latency histogram with power-of-two microsecond buckets.
+// record() is wait-free and allocation-free, so it can be called from the audio thread;
+// snapshot() may be called from any thread (counts are relaxed, so a snapshot taken
+// while recording may be off by the in-flight samples).
+class LatencyHistogram {
+ public:
+  // Bucket i counts latencies below 2^(i + kFirstBucketLog2) us; the last bucket is unbounded
+  static constexpr size_t kBuckets = 16;
+  static constexpr int kFirstBucketLog2 = 6;  // 64 us
+
+  struct Snapshot {
+    uint64_t count = 0;
+    double mean_seconds = 0.0;
+    double max_seconds = 0.0;
+    std::array<uint64_t, kBuckets> buckets{};
+
+    // Upper bound of the bucket holding the given fraction (0-1) of samples
+    double percentileSeconds(double fraction) const {
+      const uint64_t target = static_cast<uint64_t>(fraction * count);
+      uint64_t seen = 0;
+      for (size_t i = 0; i < kBuckets; ++i) {
+        seen += buckets[i];
+        if (seen > target) {
+          return i + 1 < kBuckets ? bucketUpperSeconds(i) : max_seconds;
+        }
+      }
+      return max_seconds;
+    }
+  };
+
+  LatencyHistogram() { reset(); }
+
+  void record(double seconds) {
+    // Sums and maxima are kept in ns, so short timings (e.g. an effect's share of a buffer) keep a precise mean
+    const uint64_t ns = seconds > 0.0 ? static_cast<uint64_t>(seconds * 1e9) : 0;
+    const uint64_t us = ns / 1000;
+
+    size_t bucket = 0;
+    while (bucket + 1 < kBuckets && us >= (uint64_t{1} << (bucket + kFirstBucketLog2))) {
+      ++bucket;
+    }
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+
+    uint64_t max = max_ns_.load(std::memory_order_relaxed);
+    while (ns > max && !max_ns_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+  }
+
+  Snapshot snapshot() const {
+    Snapshot s;
+    s.count = count_.load(std::memory_order_relaxed);
+    if (s.count > 0) {
+      s.mean_seconds = sum_ns_.load(std::memory_order_relaxed) * 1e-9 / s.count;
+    }
+    s.max_seconds = max_ns_.load(std::memory_order_relaxed) * 1e-9;
+    for (size_t i = 0; i < kBuckets; ++i) {
+      s.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    return s;
+  }
+
+  void reset() {
+    for (auto& bucket : buckets_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_ns_.store(0, std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+  }
+
+  static double bucketUpperSeconds(size_t bucket) {
+    return static_cast<double>(uint64_t{1} << (bucket + kFirstBucketLog2)) * 1e-6;
+  }
+
+ private:
+  std::array<std::atomic<uint64_t>, kBuckets> buckets_;
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_ns_;
+  std::atomic<uint64_t> max_ns_;
+};
+
+}  // namespace mpccli
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace mpccli {
+
+// Bounded lock-free multi-producer/multi-consumer queue (Vyukov's sequence-number ring).
+// Never allocates after construction and never blocks, so it is safe to pop from the
+// audio thread while input, sequencer and control threads push.
+// Capacity must be a power of two.
+template <typename T, size_t Capacity>
+class LockFreeQueue {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+ public:
+  LockFreeQueue() : head_(0), tail_(0) {
+    for (size_t i = 0; i < Capacity; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  LockFreeQueue(const LockFreeQueue&) = delete;
+  LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+  // Returns false if the queue is full (the item is dropped)
+  bool push(const T& item) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell& cell = cells_[pos & (Capacity - 1)];
+      size_t seq = cell.sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell.value = item;
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Returns false if the queue is empty
+  bool pop(T& item) {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell& cell = cells_[pos & (Capacity - 1)];
+      size_t seq = cell.sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          item = cell.value;
+          cell.sequence.store(pos + Capacity, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  // Keep producer and consumer indices on separate cache lines
+  alignas(64) std::array<Cell, Capacity> cells_;
+  alignas(64) std::atomic<size_t> head_;
+  alignas(64) std::atomic<size_t> tail_;
+};
+
+}  // namespace mpccli
@@ -0,0 +1,254 @@
+#include "mixer_graph.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace mpccli {
+
+namespace {
+
+constexpr size_t kBufferAlignmentFloats = 16;  // Node buffers start on a cache line boundary
+constexpr MixerGraph::Node kNoChannel = 0xFFFF;
+constexpr uint16_t kNoStrip = 0xFFFF;
+
+}  // namespace
+
+MixerGraph::MixerGraph(const MixerRouting& routing, double sample_rate, int channels, size_t max_block_frames,
+                       size_t workers)
+    : channels_(channels),
+      stride_((max_block_frames * channels + kBufferAlignmentFloats - 1) / kBufferAlignmentFloats *
+              kBufferAlignmentFloats),
+      frames_(0),
+      bpm_(120.0),
+      channel_count_(0),
+      bus_count_(routing.buses.size()),
+      master_gain_(routing.master_gain),
+      offset_(0) {
+  const int bus_count = static_cast<int>(routing.buses.size());
+  auto bus_node = [](int bus) { return bus == MixerRouting::kMasterBus ? kMasterNode : static_cast<Node>(bus + 1); };
+  auto valid_bus = [bus_count](int bus) { return bus >= 0 && bus < bus_count; };
+
+  // Each bus feeds exactly one other, so the buses form chains towards the master.
+  // Walk them to break cycles and find each bus's depth (buses between it and the master).
+  std::vector<int> outputs(bus_count);
+  for (int b = 0; b < bus_count; ++b) {
+    outputs[b] = valid_bus(routing.buses[b].output) ? routing.buses[b].output : MixerRouting::kMasterBus;
+  }
+  std::vector<int> depth(bus_count, -1);
+  std::vector<bool> on_path(bus_count, false);
+  for (int start = 0; start < bus_count; ++start) {
+    std::vector<int> path;
+    int bus = start;
+    while (bus != MixerRouting::kMasterBus && depth[bus] < 0 && !on_path[bus]) {
+      on_path[bus] = true;
+      path.push_back(bus);
+      bus = outputs[bus];
+    }
+    if (bus != MixerRouting::kMasterBus && on_path[bus]) {
+      std::cerr << "Warning: Mixer bus '" << routing.buses[path.back()].name << "' feeds itself through '"
+                << routing.buses[bus].name << "', routing it to master" << std::endl;
+      outputs[path.back()] = MixerRouting::kMasterBus;
+    }
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+      const int output = outputs[*it];
+      depth[*it] = output == MixerRouting::kMasterBus ? 0 : depth[output] + 1;
+      on_path[*it] = false;
+    }
+  }
+
+  // Every node's inputs: buses first (by bus index), then the master
+  std::vector<std::vector<Input>> bus_inputs(bus_count);
+  std::vector<Input> master_inputs;
+  auto inputs_of = [&](int bus) -> std::vector<Input>& {
+    return bus == MixerRouting::kMasterBus ? master_inputs : bus_inputs[bus];
+  };
+
+  // Channels follow the master and bus nodes
+  pad_nodes_.fill(kNoChannel);
+  Node next_node = static_cast<Node>(bus_count + 1);
+  for (const MixerRouting::Channel& channel : routing.channels) {
+    if (channel.pad >= kMaxPads || pad_nodes_[channel.pad] != kNoChannel) {
+      continue;
+    }
+    const Node node = next_node++;
+    pad_nodes_[channel.pad] = node;
+    ++channel_count_;
+    if (channel.effects.enabled()) {
+      node_strips_.resize(node + 1, kNoStrip);
+      node_strips_[node] = static_cast<uint16_t>(strips_.size());
+      strips_.push_back({ChannelEffects(channel.effects, sample_rate, channels), node, false});
+    }
+
+    inputs_of(valid_bus(channel.output) ? channel.output : MixerRouting::kMasterBus).push_back({node, 1.0f});
+    for (const MixerRouting::Send& send : channel.sends) {
+      if (valid_bus(send.bus) && send.level > 0.0f) {
+        bus_inputs[send.bus].push_back({node, send.level});
+      }
+    }
+  }
+  for (int bus = 0; bus < bus_count; ++bus) {
+    inputs_of(outputs[bus]).push_back({bus_node(bus), routing.buses[bus].gain});
+  }
+
+  // Worker 0 mixes pads without a channel straight into the master; the others get their own buffer
+  direct_nodes_.push_back(kMasterNode);
+  for (size_t worker = 1; worker < std::max<size_t>(workers, 1); ++worker) {
+    direct_nodes_.push_back(next_node);
+    master_inputs.push_back({next_node++, 1.0f});
+  }
+
+  // Flatten into levels: buses deepest first, then the master
+  auto add_destination = [this](Node node, const std::vector<Input>& inputs) {
+    destinations_.push_back({node, static_cast<uint32_t>(inputs_.size()), static_cast<uint32_t>(inputs.size())});
+    inputs_.insert(inputs_.end(), inputs.begin(), inputs.end());
+  };
+  const int max_depth = bus_count > 0 ? *std::max_element(depth.begin(), depth.end()) : -1;
+  for (int level = max_depth; level >= 0; --level) {
+    const uint32_t first = static_cast<uint32_t>(destinations_.size());
+    for (int bus = 0; bus < bus_count; ++bus) {
+      if (depth[bus] == level && !bus_inputs[bus].empty()) {
+        add_destination(bus_node(bus), bus_inputs[bus]);
+      }
+    }
+    if (destinations_.size() > first) {
+      levels_.push_back({first, static_cast<uint32_t>(destinations_.size()) - first});
+    }
+  }
+  levels_.push_back({static_cast<uint32_t>(destinations_.size()), 1});
+  add_destination(kMasterNode, master_inputs);
+
+  node_sends_.assign(next_node, kNoStrip);
+  for (int bus = 0; bus < bus_count; ++bus) {
+    if (routing.buses[bus].effect.type != SendEffectType::None) {
+      node_sends_[bus_node(bus)] = static_cast<uint16_t>(sends_.size());
+      sends_.push_back({SendEffect(routing.buses[bus].effect, sample_rate, channels), 0});
+    }
+  }
+
+  if (routing.limiter.enabled) {
+    limiter_ = std::make_unique<TruePeakLimiter>(routing.limiter, sample_rate, channels);
+  }
+
+  buffers_.assign(static_cast<size_t>(next_node) * stride_ + kBufferAlignmentFloats, 0.0f);
+  active_.assign(next_node, 0);
+  node_strips_.resize(next_node, kNoStrip);
+
+  // Line the buffers up on a cache line (vector storage is only guaranteed 16-byte aligned)
+  const auto address = reinterpret_cast<uintptr_t>(buffers_.data());
+  offset_ = (kBufferAlignmentFloats - (address / sizeof(float)) % kBufferAlignmentFloats) % kBufferAlignmentFloats;
+}
+
+void MixerGraph::beginBlock(size_t frames, double bpm) {
+  frames_ = frames;
+  bpm_ = bpm;
+  std::fill(active_.begin(), active_.end(), 0);
+}
+
+float* MixerGraph::touch(Node node) {
+  float* data = buffer(node);
+  if (!active_[node]) {
+    std::fill(data, data + frames_ * channels_, 0.0f);
+    active_[node] = 1;
+  }
+  return data;
+}
+
+float* MixerGraph::padInput(PadId pad, size_t worker) {
+  const Node node = pad < kMaxPads ? pad_nodes_[pad] : kNoChannel;
+  return touch(node != kNoChannel ? node : direct_nodes_[worker < direct_nodes_.size() ? worker : 0]);
+}
+
+void MixerGraph::finishPad(PadId pad) {
+  const Node node = pad < kMaxPads ? pad_nodes_[pad] : kNoChannel;
+  if (node == kNoChannel || node_strips_[node] == kNoStrip || !active_[node]) {
+    return;
+  }
+  Strip& strip = strips_[node_strips_[node]];
+  strip.effects.process(buffer(node), frames_);
+  strip.ringing = true;
+}
+
+void MixerGraph::pull(const Destination& destination) {
+  const size_t samples = frames_ * channels_;
+  float* output = buffer(destination.node);
+  bool active = active_[destination.node] != 0;
+
+  for (uint32_t i = destination.first_input; i < destination.first_input + destination.input_count; ++i) {
+    const Input& input = inputs_[i];
+    if (!active_[input.source]) {
+      continue;  // Nothing reached this input in this block
+    }
+    const float* source = buffer(input.source);
+    const float gain = input.gain;
+    if (active) {
+      for (size_t s = 0; s < samples; ++s) {
+        output[s] += source[s] * gain;
+      }
+    } else {
+      for (size_t s = 0; s < samples; ++s) {
+        output[s] = source[s] * gain;
+      }
+      active = true;
+    }
+  }
+
+  // A bus effect also runs without input, until its tail has died away
+  if (node_sends_[destination.node] != kNoStrip) {
+    SendStrip& send = sends_[node_sends_[destination.node]];
+    const auto start = std::chrono::steady_clock::now();
+    active = send.effect.process(output, frames_, active, bpm_);
+    send.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                            .count();
+  }
+  active_[destination.node] = active;
+}
+
+bool MixerGraph::hasSendEffect(SendEffectType type) const {
+  return std::any_of(sends_.begin(), sends_.end(), [type](const SendStrip& send) { return send.effect.type() == type; });
+}
+
+double MixerGraph::takeSendEffectSeconds(SendEffectType type) {
+  int64_t nanoseconds = 0;
+  for (SendStrip& send : sends_) {
+    if (send.effect.type() == type) {
+      nanoseconds += send.nanoseconds;
+      send.nanoseconds = 0;
+    }
+  }
+  return nanoseconds * 1e-9;
+}
+
+void MixerGraph::finishBlock(float* output, RenderPool& pool) {
+  // Channels whose pads fell silent run their inserts on silence until they settle; the
+  // state left below the threshold is cleared rather than decayed further
+  for (Strip& strip : strips_) {
+    if (strip.ringing && !active_[strip.node]) {
+      strip.effects.process(touch(strip.node), frames_);
+      if (strip.effects.settled()) {
+        strip.effects.reset();
+        strip.ringing = false;
+      }
+    }
+  }
+
+  for (const Level& level : levels_) {
+    auto sum = [this, &level](size_t task, size_t) { pull(destinations_[level.first_destination + task]); };
+    pool.run(level.destination_count, sum);
+  }
+
+  const size_t samples = frames_ * channels_;
+  const bool active = active_[kMasterNode] != 0;
+  if (active) {
+    const float* master = buffer(kMasterNode);
+    for (size_t i = 0; i < samples; ++i) {
+      output[i] = master[i] * master_gain_;
+    }
+  } else {
+    std::fill(output, output + samples, 0.0f);
+  }
+  if (limiter_) {
+    limiter_->process(output, frames_, active);
+  }
+}
+
+}  // namespace mpccli
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "render_pool.h"
+#include "../dsp/channel_effects.h"
+#include "../dsp/limiter.h"
+#include "../dsp/send_effects.h"
+#include "../kit/pad.h"
+
+namespace mpccli {
+
+// Where audio goes after the voices, with bus names already resolved to indices.
+// Pads feed their own channel strip (or the master bus directly if they have none),
+// channels feed a group bus and aux sends, and buses feed other buses or the master.
+struct MixerRouting {
+  static constexpr int kMasterBus = -1;
+
+  struct Bus {
+    std::string name;
+    float gain = 1.0f;
+    int output = kMasterBus;  // Bus this one feeds
+    SendEffectParams effect;  // Runs on the bus's sum, before its gain (reverb, delay)
+  };
+
+  // A post-fader send from a channel to an aux bus
+  struct Send {
+    int bus;
+    float level;
+  };
+
+  struct Channel {
+    PadId pad;
+    int output = kMasterBus;  // Group bus
+    std::vector<Send> sends;
+    ChannelEffectParams effects;  // Inserts, before the fader and sends
+  };
+
+  std::vector<Bus> buses;  // Group and aux buses alike
+  std::vector<Channel> channels;
+  float master_gain = 1.0f;
+  LimiterParams limiter;  // On the master bus, after its gain
+};
+
+// A mixer compiled into a flat schedule, computed off the audio thread whenever the
+// routing changes (the node buffers are allocated here too); rendering only walks it.
+//
+// Every bus pulls its inputs (channels, send levels and the buses feeding it). Buses are
+// grouped into levels by their distance from the master, deepest first: a bus only pulls
+// from channels and deeper levels, so the buses of one level are independent and can be
+// summed in parallel, and the master pulls last. Nodes are silent until something mixes
+// into them in a block, and silent inputs are skipped, so idle channels and buses cost nothing
+// (a bus with a reverb or delay stays active until its tail has died away).
+//
+// Voices of pads without a channel mix into a per-worker direct buffer (worker 0's is the
+// master bus itself), so render workers never write the same buffer.
+class MixerGraph {
+ public:
+  using Node = uint16_t;
+  static constexpr Node kMasterNode = 0;
+
+  // Compiled for `workers` render threads (see padInput). Buses that feed themselves
+  // (directly or through other buses) are reported and routed to the master bus instead.
+  MixerGraph(const MixerRouting& routing, double sample_rate, int channels, size_t max_block_frames,
+             size_t workers = 1);
+
+  MixerGraph(const MixerGraph&) = delete;
+  MixerGraph& operator=(const MixerGraph&) = delete;
+
+  // Start a block of `frames` (at most max_block_frames): every node becomes silent.
+  // `bpm` is the tempo that synced effects follow in this block.
+  void beginBlock(size_t frames, double bpm = 120.0);
+
+  // Buffer the voices of `pad` mix into for this block (zeroed on first use). Each pad
+  // must be rendered by one worker per block; `worker` picks the direct buffer for pads
+  // without a channel.
+  float* padInput(PadId pad, size_t worker = 0);
+
+  // Run the insert effects of the pad's channel over what its voices mixed in. Call once
+  // per block after the pad's last voice, on the same worker. Once the pad falls silent,
+  // finishBlock() keeps running them on silence until their filter and compressor have
+  // settled, so a tail is never cut off and the next note starts from rest.
+  void finishPad(PadId pad);
+
+  // Sum the buses level by level (spread over `pool`) and write the master bus, through
+  // its limiter, to `output` (overwrites it)
+  void finishBlock(float* output, RenderPool& pool);
+
+  // Constant delay the master limiter adds (0 without one)
+  size_t latencyFrames() const { return limiter_ ? limiter_->latencyFrames() : 0; }
+
+  size_t channelCount() const { return channel_count_; }
+  size_t busCount() const { return bus_count_; }
+  size_t workers() const { return direct_nodes_.size(); }
+  size_t effectCount() const { return strips_.size(); }
+
+  // Whether any bus runs an effect of `type`, and the time spent in those effects since
+  // the last call (from the thread that renders)
+  bool hasSendEffect(SendEffectType type) const;
+  double takeSendEffectSeconds(SendEffectType type);
+
+ private:
+  struct Input {
+    Node source;
+    float gain;
+  };
+
+  // A bus and the range of inputs it pulls
+  struct Destination {
+    Node node;
+    uint32_t first_input;
+    uint32_t input_count;
+  };
+
+  // A range of destinations that can be summed in parallel
+  struct Level {
+    uint32_t first_destination;
+    uint32_t destination_count;
+  };
+
+  // Insert effects of a channel, and whether they still ring after its pad fell silent
+  struct Strip {
+    ChannelEffects effects;
+    Node node;
+    bool ringing;
+  };
+
+  // Effect of a bus and its running time (written by the worker that sums the bus)
+  struct SendStrip {
+    SendEffect effect;
+    int64_t nanoseconds;
+  };
+
+  // Buffer of a node for writing, zeroed if it is still silent in this block
+  float* touch(Node node);
+
+  // Sum a destination's inputs into it
+  void pull(const Destination& destination);
+
+  float* buffer(Node node) { return buffers_.data() + offset_ + node * stride_; }
+
+  int channels_;
+  size_t stride_;  // Floats per node buffer
+  size_t frames_;
+  double bpm_;
+  size_t channel_count_;
+  size_t bus_count_;
+  float master_gain_;
+
+  std::vector<float> buffers_;  // Every node's block, node after node
+  size_t offset_;                // Of the first node buffer in buffers_
+  std::vector<uint8_t> active_;  // Whether a node received audio in this block
+  std::array<Node, kMaxPads> pad_nodes_;  // Channel of each pad (kNoChannel without one)
+  std::vector<Node> direct_nodes_;       // Per worker, for pads without a channel
+  std::vector<Input> inputs_;
+  std::vector<Destination> destinations_;
+  std::vector<Level> levels_;  // Deepest first; the last one is the master
+  std::vector<Strip> strips_;
+  std::vector<uint16_t> node_strips_;  // Index into strips_ per node (kNoStrip without effects)
+  std::vector<SendStrip> sends_;
+  std::vector<uint16_t> node_sends_;   // Index into sends_ per node (kNoStrip without an effect)
+  std::unique_ptr<TruePeakLimiter> limiter_;  // Null when disabled
+};
+
+}  // namespace mpccli
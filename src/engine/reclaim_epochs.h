@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <thread>
+
+namespace mpccli {
+
+// Epoch-based reclamation for what triggers and engine voices reach through raw pointers
+// (pad sounds and their sample buffers, pitch variants), so a replaced buffer is freed
+// once nothing can read it any more, however long a note was scheduled ahead or a
+// trigger thread was preempted.
+//
+// A trigger pins the current epoch (pin()) before it looks a pad up and keeps it until its
+// event is queued; the event carries the pinned epoch into the voice or scheduled note it
+// becomes. Whoever unpublishes an object calls retire() afterwards and frees it once
+// reclaimable() is true:
+//  1. no trigger pinned at or before the retirement is still running,
+//  2. a render that began after that has completed, so their queued events were picked up,
+//  3. and no voice or scheduled note from that epoch or earlier is left.
+// Pinning is lock-free and the audio thread only publishes once per render().
+class ReclaimEpochs {
+ public:
+  static constexpr size_t kMaxPins = 64;  // Triggers in flight at once (more wait for a slot)
+
+  // Holds an epoch pinned until destroyed
+  class Pin {
+   public:
+    ~Pin() { slot_->store(0, std::memory_order_release); }
+
+    Pin(const Pin&) = delete;
+    Pin& operator=(const Pin&) = delete;
+
+    uint64_t epoch() const { return epoch_; }
+
+   private:
+    friend class ReclaimEpochs;
+    Pin(std::atomic<uint64_t>* slot, uint64_t epoch) : slot_(slot), epoch_(epoch) {}
+
+    std::atomic<uint64_t>* slot_;
+    uint64_t epoch_;
+  };
+
+  // Where a retired object stands (reclaimable() fills in drained_at)
+  struct Retirement {
+    static constexpr uint64_t kNotDrained = std::numeric_limits<uint64_t>::max();
+
+    uint64_t epoch = 0;
+    uint64_t drained_at = kNotDrained;  // Renders completed once no pin of the epoch was left
+  };
+
+  ReclaimEpochs() : epoch_(1), renders_(0), oldest_in_use_(kNothingInUse) {}
+
+  ReclaimEpochs(const ReclaimEpochs&) = delete;
+  ReclaimEpochs& operator=(const ReclaimEpochs&) = delete;
+
+  // Pin the current epoch for a trigger (any thread but the audio thread)
+  Pin pin() {
+    // Start at a slot picked by thread so concurrent triggers rarely contend
+    const size_t first = std::hash<std::thread::id>{}(std::this_thread::get_id()) % kMaxPins;
+    for (;;) {
+      const uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+      for (size_t i = 0; i < kMaxPins; ++i) {
+        std::atomic<uint64_t>& slot = slots_[(first + i) % kMaxPins].epoch;
+        uint64_t idle = 0;
+        if (slot.load(std::memory_order_relaxed) == 0 &&
+            slot.compare_exchange_strong(idle, epoch, std::memory_order_seq_cst)) {
+          // Order the pin before the loads it protects (pairs with the fence in reclaimable())
+          std::atomic_thread_fence(std::memory_order_seq_cst);
+          return Pin(&slot, epoch);
+        }
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  // Start a new epoch for an object the caller has just unpublished
+  Retirement retire() {
+    return {epoch_.fetch_add(1, std::memory_order_seq_cst), Retirement::kNotDrained};
+  }
+
+  // Whether a retired object can be freed (see the class comment). Call it again later if not.
+  bool reclaimable(Retirement& retired) const {
+    if (retired.drained_at == Retirement::kNotDrained) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      for (const Slot& slot : slots_) {
+        const uint64_t pinned = slot.epoch.load(std::memory_order_seq_cst);
+        if (pinned != 0 && pinned <= retired.epoch) {
+          return false;
+        }
+      }
+      retired.drained_at = renders_.load(std::memory_order_acquire);
+    }
+
+    // A render may have been running when the pins were checked; the one after it began
+    // later and popped every event those triggers queued
+    if (renders_.load(std::memory_order_acquire) < retired.drained_at + 2) {
+      return false;
+    }
+    return oldest_in_use_.load(std::memory_order_acquire) > retired.epoch;
+  }
+
+  // Audio thread, at the end of each render(): the oldest epoch any voice or scheduled
+  // note was triggered in, or kNothingInUse
+  void publishRender(uint64_t oldest_in_use) {
+    oldest_in_use_.store(oldest_in_use, std::memory_order_release);
+    renders_.store(renders_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  static constexpr uint64_t kNothingInUse = std::numeric_limits<uint64_t>::max();
+
+ private:
+  // One pin per cache line, so triggers on different threads don't share lines
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> epoch{0};  // 0 = free
+  };
+
+  std::atomic<uint64_t> epoch_;
+  std::array<Slot, kMaxPins> slots_;
+  alignas(64) std::atomic<uint64_t> renders_;
+  std::atomic<uint64_t> oldest_in_use_;
+};
+
+}  // namespace mpccli
@@ -0,0 +1,128 @@
+#include "render_pool.h"
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace mpccli {
+
+namespace {
+
+// How long a worker polls for the next run before it blocks, so the phases of one block
+// find the workers awake. Timed rather than counted: a pause instruction takes anywhere
+// from a few to over a hundred cycles depending on the CPU.
+constexpr std::chrono::microseconds kSpinBeforeWait(5);
+
+// Pauses between clock reads while spinning
+constexpr int kPausesPerClockRead = 16;
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+}  // namespace
+
+RenderPool::RenderPool(size_t threads, const ThreadSetup& setup)
+    : ranges_(new Range[threads < 1 ? 1 : threads]),
+      thunk_(nullptr),
+      context_(nullptr),
+      generation_(0),
+      pending_(0),
+      busy_(0),
+      stopping_(false) {
+  for (size_t worker = 1; worker < threads; ++worker) {
+    workers_.emplace_back([this, worker, setup]() {
+      if (setup) {
+        setup(worker);
+      }
+      workerLoop(worker);
+    });
+  }
+}
+
+RenderPool::~RenderPool() {
+  stopping_.store(true, std::memory_order_relaxed);
+  generation_.fetch_add(1, std::memory_order_release);
+  generation_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void RenderPool::dispatch(size_t count, Thunk thunk, void* context) {
+  const size_t threads = this->threads();
+  thunk_ = thunk;
+  context_ = context;
+  for (size_t worker = 0; worker < threads; ++worker) {
+    ranges_[worker].next.store(count * worker / threads, std::memory_order_relaxed);
+    ranges_[worker].end = count * (worker + 1) / threads;
+  }
+
+  // Publishes the ranges: a worker only reads them after seeing pending_ non-zero
+  pending_.store(count, std::memory_order_release);
+  generation_.fetch_add(1, std::memory_order_release);
+  generation_.notify_all();
+
+  work(0);
+
+  // Join: every task has finished and no worker is still scanning the ranges (the next
+  // dispatch rewrites them). Reading pending_ then busy_ here and writing busy_ then reading
+  // pending_ in workerLoop is store buffering: with anything weaker than seq_cst both sides
+  // may miss the other's write, and a late worker would scan ranges being rewritten.
+  while (pending_.load(std::memory_order_seq_cst) != 0 || busy_.load(std::memory_order_seq_cst) != 0) {
+    cpuRelax();
+  }
+}
+
+void RenderPool::work(size_t worker) {
+  const size_t threads = this->threads();
+  for (size_t offset = 0; offset < threads; ++offset) {
+    Range& range = ranges_[(worker + offset) % threads];
+    while (range.next.load(std::memory_order_relaxed) < range.end) {
+      const size_t task = range.next.fetch_add(1, std::memory_order_relaxed);
+      if (task >= range.end) {
+        break;  // Another worker took the last one
+      }
+      thunk_(context_, task, worker);
+      pending_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+  }
+}
+
+void RenderPool::workerLoop(size_t worker) {
+  uint64_t seen = generation_.load(std::memory_order_acquire);
+  while (true) {
+    const auto spin_until = std::chrono::steady_clock::now() + kSpinBeforeWait;
+    bool spinning = true;
+    int pauses = 0;
+    while (generation_.load(std::memory_order_acquire) == seen) {
+      if (!spinning) {
+        generation_.wait(seen, std::memory_order_acquire);
+      } else if (++pauses % kPausesPerClockRead != 0) {
+        cpuRelax();
+      } else {
+        spinning = std::chrono::steady_clock::now() < spin_until;
+      }
+    }
+    seen = generation_.load(std::memory_order_acquire);
+    if (stopping_.load(std::memory_order_relaxed)) {
+      return;
+    }
+
+    // Announce ourselves before looking for work, so the caller can't rewrite the ranges
+    // under us; a run that has already finished (pending_ == 0) is left alone. Both are
+    // seq_cst, pairing with the join in dispatch().
+    busy_.fetch_add(1, std::memory_order_seq_cst);
+    if (pending_.load(std::memory_order_seq_cst) != 0) {
+      work(worker);
+    }
+    busy_.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+}  // namespace mpccli
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace mpccli {
+
+// Fixed pool of render threads that the audio thread fans independent tasks out to.
+// The audio thread takes part as worker 0, so a pool of N threads starts N - 1.
+//
+// Each run() splits its tasks into one contiguous range per worker. Workers claim tasks
+// from the front of their own range and, once it is empty, steal from the other ranges
+// the same way, so a worker stuck on a heavy task doesn't hold up the rest. The caller
+// then spins until every task has finished (no locks; workers are woken with an atomic
+// wait/notify and spin briefly between runs so the phases of one block stay cheap).
+class RenderPool {
+ public:
+  // Called by each worker thread (1 to threads - 1) before it first waits for work, e.g.
+  // to give it a real-time priority
+  using ThreadSetup = std::function<void(size_t worker)>;
+
+  explicit RenderPool(size_t threads, const ThreadSetup& setup = nullptr);
+  ~RenderPool();
+
+  RenderPool(const RenderPool&) = delete;
+  RenderPool& operator=(const RenderPool&) = delete;
+
+  // Threads rendering, including the caller
+  size_t threads() const { return workers_.size() + 1; }
+
+  // Call body(task, worker) for every task in [0, count) and return once all are done.
+  // `worker` is below threads(), so it can index per-worker scratch space. Only one thread
+  // (the audio thread) may call run(); it never allocates.
+  template <typename Body>
+  void run(size_t count, Body& body) {
+    if (workers_.empty() || count < 2) {
+      for (size_t task = 0; task < count; ++task) {
+        body(task, 0);
+      }
+      return;
+    }
+    dispatch(count, [](void* context, size_t task, size_t worker) { (*static_cast<Body*>(context))(task, worker); },
+             &body);
+  }
+
+ private:
+  using Thunk = void (*)(void* context, size_t task, size_t worker);
+
+  // A worker's share of the current tasks (one cache line each, as thieves touch it too)
+  struct alignas(64) Range {
+    std::atomic<size_t> next{0};
+    size_t end = 0;
+  };
+
+  void dispatch(size_t count, Thunk thunk, void* context);
+
+  // Claim and run tasks, own range first, until every range is empty
+  void work(size_t worker);
+
+  void workerLoop(size_t worker);
+
+  std::unique_ptr<Range[]> ranges_;
+  Thunk thunk_;
+  void* context_;
+
+  alignas(64) std::atomic<uint64_t> generation_;  // Bumped by each dispatch (and stop)
+  alignas(64) std::atomic<size_t> pending_;       // Tasks of the current run not yet finished
+  alignas(64) std::atomic<size_t> busy_;          // Workers looking at the ranges
+  std::atomic<bool> stopping_;
+
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace mpccli
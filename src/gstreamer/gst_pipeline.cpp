@@ -1,59 +1,94 @@
 #include "gst_pipeline.h"
+#include <gst/app/gstappsrc.h>
 #include <iostream>
-#include <filesystem>
+#include <algorithm>
 #include <cmath>
 
 namespace mpccli {
 
-AudioPipeline::AudioPipeline(const std::string& file_path, CompletionCallback callback, double volume)
-    : file_path_(file_path),
+namespace {
+
+// Blocks appsrc may hold before need-data stops firing
+constexpr size_t kQueuedBlocks = 2;
+
+// Sink ring buffer length and period, in the microseconds GStreamer audio sinks take
+int64_t sinkBufferTimeUs(const OutputSettings& settings) {
+  return static_cast<int64_t>(std::llround(settings.buffer_frames * settings.periods * 1e6 / settings.sample_rate));
+}
+
+int64_t sinkLatencyTimeUs(const OutputSettings& settings) {
+  return static_cast<int64_t>(std::llround(settings.buffer_frames * 1e6 / settings.sample_rate));
+}
+
+bool hasProperty(GstElement* element, const char* name) {
+  return g_object_class_find_property(G_OBJECT_GET_CLASS(element), name) != nullptr;
+}
+
+}  // namespace
+
+std::unique_ptr<AudioOutput> createGstOutput(AudioOutput::RenderCallback render, const OutputSettings& settings,
+                                             int channels) {
+  try {
+    return std::make_unique<AudioPipeline>(std::move(render), settings, channels);
+  } catch (const std::exception& e) {
+    std::cerr << "Failed to open audio output: " << e.what() << std::endl;
+    return nullptr;
+  }
+}
+
+AudioPipeline::AudioPipeline(RenderCallback render, const OutputSettings& settings, int channels,
+                             CompletionCallback callback)
+    : AudioOutput(std::move(render), settings, channels),
       pipeline_(nullptr),
-      volume_element_(nullptr),
+      appsrc_(nullptr),
       bus_(nullptr),
       bus_watch_id_(0),
       completion_callback_(std::move(callback)),
-      amplitude_callback_(nullptr),
       is_playing_(false),
       pipeline_created_(false),
-      probe_id_(0),
-      volume_(volume),
-      pitch_semitones_(0.0) {
+      frames_rendered_(0) {
 
-  // Check if file exists
-  if (!std::filesystem::exists(file_path)) {
-    throw std::runtime_error("Audio file does not exist: " + file_path);
-  }
-
-  // Create the pipeline immediately and pre-buffer it
+  // Create the pipeline immediately and pre-roll it
   if (!createPipeline()) {
-    throw std::runtime_error("Failed to create pipeline for: " + file_path);
+    throw std::runtime_error("Failed to create audio output pipeline");
   }
 
-  std::cout << "Pipeline created and pre-buffered for: " << file_path << std::endl;
+  std::cout << "Audio output created (" << outputBackendName(settings_.backend) << ", " << settings_.sample_rate << " Hz, " << settings_.buffer_frames
+            << "-frame buffers x " << settings_.periods << " periods, " << outputLatencySeconds() * 1000.0
+            << " ms output latency)" << std::endl;
 }
 
 AudioPipeline::~AudioPipeline() {
   destroy();
 }
 
+double AudioPipeline::outputLatencySeconds() const {
+  return kQueuedBlocks * settings_.buffer_frames / settings_.sample_rate + sinkBufferTimeUs(settings_) * 1e-6;
+}
+
 bool AudioPipeline::createPipeline() {
   if (pipeline_created_) {
     return true;
   }
 
-  // Create optimized low-latency pipeline with volume control.
-  // This is done only once on startup. Each time the sample is
-  // played, we simply seek to the beginning of the sample and set state to PLAYING again.
-  // -> filesrc loads from disk (fast for small files)
-  // -> decodebin auto-detects format
-  // -> volume element for volume control
-  // -> Direct to low-latency audio sink (osxaudiosink)
-  // NOTE: Pitch shifting will be done via playback rate (changes pitch + tempo together)
+  // Single output pipeline fed by the engine mix.
+  // -> appsrc pulls rendered blocks via need-data; max-bytes keeps only two blocks
+  //    queued so triggers reach the sink quickly
+  // -> audioconvert adapts float to whatever the device wants
+  // -> Direct to low-latency audio sink (osxaudiosink), or whichever sink autoaudiosink
+  //    finds (pulsesink, pipewiresink, ...), given the same buffering once it's created
+  const std::string sink =
+      settings_.backend == OutputBackend::CoreAudio
+          ? "osxaudiosink buffer-time=" + std::to_string(sinkBufferTimeUs(settings_)) +
+                " latency-time=" + std::to_string(sinkLatencyTimeUs(settings_))
+          : std::string("autoaudiosink");
+  const size_t block_bytes = settings_.buffer_frames * channels_ * sizeof(float);
   std::string pipeline_desc =
-      std::string("filesrc location=\"") + file_path_ + "\" ! " +
-      "decodebin ! audioconvert ! audioresample ! " +
-      "volume name=volume ! " +
-      "osxaudiosink buffer-time=20000 latency-time=5000";
+      std::string("appsrc name=source format=time is-live=false ") +
+      "max-bytes=" + std::to_string(block_bytes * kQueuedBlocks) + " " +
+      "caps=\"audio/x-raw,format=F32LE,layout=interleaved,channels=" + std::to_string(channels_) +
+      ",rate=" + std::to_string(static_cast<int>(settings_.sample_rate)) + "\" ! " +
+      "audioconvert ! audioresample ! " + sink;
 
   GError* error = nullptr;
   pipeline_ = gst_parse_launch(pipeline_desc.c_str(), &error);
@@ -65,56 +100,29 @@ bool AudioPipeline::createPipeline() {
     return false;
   }
 
+  // Hook up the appsrc so it pulls from the render callback
+  appsrc_ = gst_bin_get_by_name(GST_BIN(pipeline_), "source");
+  if (!appsrc_) {
+    std::cerr << "Failed to find appsrc in pipeline" << std::endl;
+    gst_object_unref(pipeline_);
+    pipeline_ = nullptr;
+    return false;
+  }
+  g_signal_connect(appsrc_, "need-data", G_CALLBACK(needDataCallback), this);
+  if (settings_.backend != OutputBackend::CoreAudio) {
+    g_signal_connect(pipeline_, "deep-element-added", G_CALLBACK(sinkAddedCallback), this);
+  }
+
   // Set up bus watch
   bus_ = gst_element_get_bus(pipeline_);
   bus_watch_id_ = gst_bus_add_watch(bus_, busCallback, this);
   gst_object_unref(bus_);
 
-  // Get the volume element and set initial volume
-  volume_element_ = gst_bin_get_by_name(GST_BIN(pipeline_), "volume");
-  if (volume_element_) {
-    g_object_set(G_OBJECT(volume_element_), "volume", volume_, nullptr);
-  } else {
-    std::cerr << "Warning: Could not find volume element in pipeline" << std::endl;
-  }
-
-  // Add pad probe for amplitude monitoring
-  // Get the audioconvert element and probe its src pad
-  GstElement* audioconvert = gst_bin_get_by_name(GST_BIN(pipeline_), "audioconvert");
-  if (!audioconvert) {
-    // If not found by name, try getting any audioconvert element
-    GstIterator* it = gst_bin_iterate_elements(GST_BIN(pipeline_));
-    GValue item = G_VALUE_INIT;
-    while (gst_iterator_next(it, &item) == GST_ITERATOR_OK) {
-      GstElement* element = GST_ELEMENT(g_value_get_object(&item));
-      const gchar* name = gst_element_get_name(element);
-      if (g_str_has_prefix(name, "audioconvert")) {
-        audioconvert = GST_ELEMENT(gst_object_ref(element));
-        g_value_reset(&item);
-        break;
-      }
-      g_value_reset(&item);
-    }
-    gst_iterator_free(it);
-  }
-
-  if (audioconvert) {
-    GstPad* src_pad = gst_element_get_static_pad(audioconvert, "src");
-    if (src_pad) {
-      probe_id_ = gst_pad_add_probe(src_pad, GST_PAD_PROBE_TYPE_BUFFER,
-                                     padProbeCallback, this, nullptr);
-      gst_object_unref(src_pad);
-    }
-    gst_object_unref(audioconvert);
-  }
-
-  // Set to PAUSED state and wait for pre-roll
-  // This pre-buffers the audio so PAUSED->PLAYING is instant
+  // Set to PAUSED state and wait for pre-roll (renders the first block of silence)
   GstStateChangeReturn ret = gst_element_set_state(pipeline_, GST_STATE_PAUSED);
   if (ret == GST_STATE_CHANGE_FAILURE) {
     std::cerr << "Failed to set pipeline to PAUSED state" << std::endl;
-    gst_object_unref(pipeline_);
-    pipeline_ = nullptr;
+    destroy();
     return false;
   }
 
@@ -122,8 +130,7 @@ bool AudioPipeline::createPipeline() {
   ret = gst_element_get_state(pipeline_, nullptr, nullptr, 5 * GST_SECOND);
   if (ret == GST_STATE_CHANGE_FAILURE) {
     std::cerr << "Failed to reach PAUSED state" << std::endl;
-    gst_object_unref(pipeline_);
-    pipeline_ = nullptr;
+    destroy();
     return false;
   }
 
@@ -137,29 +144,11 @@ bool AudioPipeline::start() {
     return false;
   }
 
-  // Calculate playback rate from pitch semitones
-  double rate = std::pow(2.0, pitch_semitones_ / 12.0);
-
-  // Seek to beginning with the desired playback rate
-  // This changes both pitch and tempo together
-  gboolean seek_result = gst_element_seek(
-      pipeline_,
-      rate,                          // Rate (1.0 = normal, 2.0 = double speed/pitch)
-      GST_FORMAT_TIME,
-      (GstSeekFlags)(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT),
-      GST_SEEK_TYPE_SET, 0,          // Start position
-      GST_SEEK_TYPE_NONE, -1);       // End position (none = play to end)
-
-  if (!seek_result) {
-    std::cerr << "Failed to seek with rate " << rate << std::endl;
-  }
-
-  // If already playing, just the seek above will restart it with new rate
   if (is_playing_) {
     return true;
   }
 
-  // Start playing - PAUSED to PLAYING is nearly instant
+  // PAUSED to PLAYING is nearly instant; the pipeline then runs until destroyed
   GstStateChangeReturn ret = gst_element_set_state(pipeline_, GST_STATE_PLAYING);
   if (ret == GST_STATE_CHANGE_FAILURE) {
     std::cerr << "Failed to set pipeline to playing state" << std::endl;
@@ -183,13 +172,7 @@ void AudioPipeline::destroy() {
     bus_watch_id_ = 0;
   }
 
-  // Release volume element reference
-  if (volume_element_) {
-    gst_object_unref(volume_element_);
-    volume_element_ = nullptr;
-  }
-
-  // Set to NULL state with a timeout
+  // Set to NULL state with a timeout (stops the streaming thread calling render)
   gst_element_set_state(pipeline_, GST_STATE_NULL);
   // Wait up to 1 second for state change (don't wait forever)
   GstStateChangeReturn ret = gst_element_get_state(pipeline_, nullptr, nullptr, GST_SECOND);
@@ -198,6 +181,11 @@ void AudioPipeline::destroy() {
     gst_element_set_state(pipeline_, GST_STATE_NULL);
   }
 
+  if (appsrc_) {
+    gst_object_unref(appsrc_);
+    appsrc_ = nullptr;
+  }
+
   // Destroy pipeline
   gst_object_unref(pipeline_);
   pipeline_ = nullptr;
@@ -208,73 +196,51 @@ bool AudioPipeline::isPlaying() const {
   return is_playing_;
 }
 
-void AudioPipeline::setAmplitudeCallback(AmplitudeCallback callback) {
-  amplitude_callback_ = std::move(callback);
-}
-
-void AudioPipeline::setVolume(double volume) {
-  volume_ = volume;
-  if (volume_element_) {
-    g_object_set(G_OBJECT(volume_element_), "volume", volume_, nullptr);
-  }
-}
-
-void AudioPipeline::setPitch(double semitones) {
-  pitch_semitones_ = semitones;
-  // Note: Using playback rate to change pitch (also changes tempo)
-  // This is acceptable for short samples like drums
-  // rate = 2^(semitones/12)
-  // e.g., +12 semitones = 2.0 (octave up), -12 = 0.5 (octave down)
-  // The rate will be applied when start() is called via seeking
-}
-
-GstPadProbeReturn AudioPipeline::padProbeCallback(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+void AudioPipeline::needDataCallback(GstElement* appsrc, guint length, gpointer user_data) {
   AudioPipeline* pipeline = static_cast<AudioPipeline*>(user_data);
 
-  if (!pipeline->is_playing_ || !pipeline->amplitude_callback_) {
-    return GST_PAD_PROBE_OK;
-  }
-
-  // Get the buffer
-  GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
-  if (!buffer) {
-    return GST_PAD_PROBE_OK;
-  }
-
-  // Calculate RMS amplitude
-  float amplitude = pipeline->calculateRMS(buffer);
+  const size_t frames = pipeline->settings_.buffer_frames;
+  const gsize bytes = frames * pipeline->channels_ * sizeof(float);
+  GstBuffer* buffer = gst_buffer_new_allocate(nullptr, bytes, nullptr);
 
-  // Call the callback
-  pipeline->amplitude_callback_(amplitude);
-
-  return GST_PAD_PROBE_OK;
-}
-
-float AudioPipeline::calculateRMS(GstBuffer* buffer) {
   GstMapInfo map;
-  if (!gst_buffer_map(buffer, &map, GST_MAP_READ)) {
-    return 0.0f;
+  if (gst_buffer_map(buffer, &map, GST_MAP_WRITE)) {
+    pipeline->render(reinterpret_cast<float*>(map.data), frames);
+    gst_buffer_unmap(buffer, &map);
   }
 
-  // Assume S16LE format (16-bit signed little-endian)
-  const int16_t* samples = reinterpret_cast<const int16_t*>(map.data);
-  size_t num_samples = map.size / sizeof(int16_t);
-
-  // Calculate RMS (Root Mean Square)
-  double sum = 0.0;
-  for (size_t i = 0; i < num_samples; ++i) {
-    double normalized = samples[i] / 32768.0;  // Normalize to -1.0 to 1.0
-    sum += normalized * normalized;
+  // Timestamp from the running frame count so the stream is gapless
+  const double sample_rate = pipeline->settings_.sample_rate;
+  const GstClockTime pts = static_cast<GstClockTime>(pipeline->frames_rendered_ * GST_SECOND / sample_rate);
+  GST_BUFFER_PTS(buffer) = pts;
+  GST_BUFFER_DURATION(buffer) = static_cast<GstClockTime>(frames * GST_SECOND / sample_rate);
+  pipeline->frames_rendered_ += frames;
+
+  // A block finished after the pipeline clock passed its timestamp is an underrun: the
+  // sink has already played silence (or dropped it) in its place
+  if (pipeline->is_playing_) {
+    if (GstClock* clock = gst_element_get_clock(pipeline->pipeline_)) {
+      const GstClockTime now = gst_clock_get_time(clock);
+      const GstClockTime base_time = gst_element_get_base_time(pipeline->pipeline_);
+      gst_object_unref(clock);
+      if (now > base_time && now - base_time > pts) {
+        pipeline->countUnderrun();
+      }
+    }
   }
 
-  gst_buffer_unmap(buffer, &map);
+  // appsrc takes ownership of the buffer
+  gst_app_src_push_buffer(GST_APP_SRC(appsrc), buffer);
+}
 
-  if (num_samples == 0) {
-    return 0.0f;
-  }
+void AudioPipeline::sinkAddedCallback(GstBin*, GstBin*, GstElement* element, gpointer user_data) {
+  AudioPipeline* pipeline = static_cast<AudioPipeline*>(user_data);
 
-  double rms = std::sqrt(sum / num_samples);
-  return static_cast<float>(rms);
+  // Only audio sinks have both properties; set them before the sink opens its device
+  if (hasProperty(element, "buffer-time") && hasProperty(element, "latency-time")) {
+    g_object_set(element, "buffer-time", static_cast<gint64>(sinkBufferTimeUs(pipeline->settings_)), "latency-time",
+                 static_cast<gint64>(sinkLatencyTimeUs(pipeline->settings_)), nullptr);
+  }
 }
 
 gboolean AudioPipeline::busCallback(GstBus* bus, GstMessage* message, gpointer user_data) {
@@ -283,13 +249,6 @@ gboolean AudioPipeline::busCallback(GstBus* bus, GstMessage* message, gpointer u
   switch (GST_MESSAGE_TYPE(message)) {
     case GST_MESSAGE_EOS:
       pipeline->is_playing_ = false;
-
-      // Seek back to beginning and pause
-      gst_element_seek_simple(pipeline->pipeline_, GST_FORMAT_TIME,
-                              (GstSeekFlags)(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT),
-                              0);
-      gst_element_set_state(pipeline->pipeline_, GST_STATE_PAUSED);
-
       if (pipeline->completion_callback_) {
         pipeline->completion_callback_(false, "");
       }
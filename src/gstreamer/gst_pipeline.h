@@ -1,73 +1,63 @@
 #pragma once
 
 #include <gst/gst.h>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <functional>
+#include "../output/audio_output.h"
 
 namespace mpccli {
 
-// Low-latency audio pipeline using filesrc with aggressive optimizations
-// Pipeline stays in PAUSED state (pre-buffered) for instant playback
-class AudioPipeline {
+// Low-latency audio output pipeline: appsrc -> audioconvert -> sink, where the sink is
+// osxaudiosink for the CoreAudio backend and autoaudiosink (PulseAudio, PipeWire, ...)
+// for the Auto backend. All voices are mixed by the engine; this pipeline pulls
+// fixed-size blocks from a render callback on GStreamer's streaming thread and keeps at
+// most two blocks queued. The sink's ring buffer is `periods` blocks long and is written
+// a block at a time.
+class AudioPipeline : public AudioOutput {
  public:
   // Callback called when pipeline completes or fails
   using CompletionCallback = std::function<void(bool failed, const std::string& error_msg)>;
 
   // callback defaults to empty function (no-op) if not provided
-  // volume ranges from 0.0 (muted) to 1.0 (full volume)
-  AudioPipeline(const std::string& file_path, CompletionCallback callback = nullptr, double volume = 1.0);
-  ~AudioPipeline();
+  AudioPipeline(RenderCallback render, const OutputSettings& settings = {}, int channels = kEngineChannels,
+                CompletionCallback callback = nullptr);
+  ~AudioPipeline() override;
 
-  // Amplitude callback type
-  using AmplitudeCallback = std::function<void(float amplitude)>;
-
-  // Set amplitude callback for visualization
-  void setAmplitudeCallback(AmplitudeCallback callback);
-
-  // Start playing the audio (instant from PAUSED state)
-  bool start();
+  // Start pulling audio from the render callback
+  bool start() override;
 
   // Stop and destroy the pipeline
-  void destroy();
+  void destroy() override;
 
   // Check if pipeline is playing
-  bool isPlaying() const;
-
-  // Get the file path being played
-  const std::string& filePath() const { return file_path_; }
-
-  // Set volume (0.0 to 1.0)
-  void setVolume(double volume);
+  bool isPlaying() const override;
 
-  // Set pitch shift in semitones (can be fractional)
-  // 0 = original pitch, +12 = one octave up, -12 = one octave down
-  void setPitch(double semitones);
+  // Worst-case time from render to the device: queued blocks plus the sink's buffer
+  double outputLatencySeconds() const override;
 
  private:
   static gboolean busCallback(GstBus* bus, GstMessage* message, gpointer user_data);
 
-  // Pad probe callback for amplitude monitoring
-  static GstPadProbeReturn padProbeCallback(GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
+  // appsrc callback: render and push the next block
+  static void needDataCallback(GstElement* appsrc, guint length, gpointer user_data);
 
-  // Calculate RMS amplitude from audio buffer
-  float calculateRMS(GstBuffer* buffer);
+  // Give the sink autoaudiosink picks the same buffering osxaudiosink is configured with
+  static void sinkAddedCallback(GstBin* bin, GstBin* sub_bin, GstElement* element, gpointer user_data);
 
   // Create the GStreamer pipeline (called only once in constructor)
   bool createPipeline();
 
-  std::string file_path_;
   GstElement* pipeline_;
-  GstElement* volume_element_;
+  GstElement* appsrc_;
   GstBus* bus_;
   guint bus_watch_id_;
   CompletionCallback completion_callback_;
-  AmplitudeCallback amplitude_callback_;
-  bool is_playing_;
+  std::atomic<bool> is_playing_;  // Read on the streaming thread
   bool pipeline_created_;
-  gulong probe_id_;
-  double volume_;
-  double pitch_semitones_;
+  uint64_t frames_rendered_;
 };
 
 }  // namespace mpccli
@@ -0,0 +1,83 @@
+#include "sample_decoder.h"
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+#include <filesystem>
+#include <stdexcept>
+#include "../dsp/resampler.h"
+
+namespace mpccli {
+
+SampleBuffer decodeAudioFile(const std::string& file_path, double sample_rate, int channels) {
+  if (!std::filesystem::exists(file_path)) {
+    throw std::runtime_error("Audio file does not exist: " + file_path);
+  }
+
+  // Decode as fast as possible (sync=false) into an appsink as float at the file's own rate
+  std::string pipeline_desc =
+      std::string("filesrc location=\"") + file_path + "\" ! " +
+      "decodebin ! audioconvert ! " +
+      "audio/x-raw,format=F32LE,layout=interleaved,channels=" + std::to_string(channels) + " ! " +
+      "appsink name=sink sync=false";
+
+  GError* error = nullptr;
+  GstElement* pipeline = gst_parse_launch(pipeline_desc.c_str(), &error);
+  if (error) {
+    std::string error_msg = error->message;
+    g_error_free(error);
+    if (pipeline) {
+      gst_object_unref(pipeline);
+    }
+    throw std::runtime_error("Failed to create decoder for " + file_path + ": " + error_msg);
+  }
+
+  GstElement* sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+  if (!sink) {
+    gst_object_unref(pipeline);
+    throw std::runtime_error("Failed to find appsink in decoder pipeline");
+  }
+
+  if (gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+    gst_object_unref(sink);
+    gst_object_unref(pipeline);
+    throw std::runtime_error("Failed to start decoder for " + file_path);
+  }
+
+  SampleBuffer buffer;
+  buffer.channels = channels;
+  buffer.sample_rate = 0.0;
+
+  // Pull every decoded buffer until EOS (pull_sample returns null at EOS or on error)
+  while (GstSample* sample = gst_app_sink_pull_sample(GST_APP_SINK(sink))) {
+    // Pick up the file's native rate from the negotiated caps
+    if (buffer.sample_rate == 0.0) {
+      GstCaps* caps = gst_sample_get_caps(sample);
+      gint rate = 0;
+      if (caps && gst_structure_get_int(gst_caps_get_structure(caps, 0), "rate", &rate)) {
+        buffer.sample_rate = rate;
+      }
+    }
+
+    GstBuffer* gst_buffer = gst_sample_get_buffer(sample);
+    GstMapInfo map;
+    if (gst_buffer && gst_buffer_map(gst_buffer, &map, GST_MAP_READ)) {
+      const float* data = reinterpret_cast<const float*>(map.data);
+      buffer.samples.insert(buffer.samples.end(), data, data + map.size / sizeof(float));
+      gst_buffer_unmap(gst_buffer, &map);
+    }
+    gst_sample_unref(sample);
+  }
+
+  bool reached_eos = gst_app_sink_is_eos(GST_APP_SINK(sink));
+
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(sink);
+  gst_object_unref(pipeline);
+
+  if (!reached_eos || buffer.sample_rate == 0.0) {
+    throw std::runtime_error("Failed to decode audio file: " + file_path);
+  }
+
+  return convertSampleRate(buffer, sample_rate);
+}
+
+}  // namespace mpccli
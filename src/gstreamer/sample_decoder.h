@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include "../dsp/sample_buffer.h"
+
+namespace mpccli {
+
+// Decode an audio file (any format GStreamer can read) into memory,
+// converted to 32-bit float interleaved at the engine sample rate and channel count.
+// Sample rate conversion uses the engine's sinc resampler rather than GStreamer's.
+// Throws std::runtime_error if the file cannot be decoded.
+SampleBuffer decodeAudioFile(const std::string& file_path,
+                             double sample_rate = kEngineSampleRate,
+                             int channels = kEngineChannels);
+
+}  // namespace mpccli
@@ -1,18 +1,31 @@
 #pragma once
 
 #include <functional>
+#if defined(__APPLE__)
 #include <CoreGraphics/CoreGraphics.h>
+#endif
 
 namespace mpccli {
 
+// Velocity reported for key presses (a computer keyboard isn't velocity sensitive)
+constexpr int kKeyboardVelocity = 127;
+
 // Callback type for key press events
-// Parameters: char key, bool shift_pressed
-using KeyPressCallback = std::function<void(char key, bool shift_pressed)>;
+// Parameters: char key, bool shift_pressed, int velocity (1-127)
+using KeyPressCallback = std::function<void(char key, bool shift_pressed, int velocity)>;
+
+// Callback type for key release events (same key codes as KeyPressCallback)
+using KeyReleaseCallback = std::function<void(char key)>;
 
+#if defined(__APPLE__)
 // Forward declaration for friend function
 CGEventRef eventTapCallbackC(CGEventTapProxy proxy, CGEventType type, CGEventRef event, void* user_data);
+#endif
 
-// MacOS keyboard input handler using low-level events
+// Keyboard input handler. On macOS it uses low-level events (system-wide, with key releases
+// and SHIFT on its own); elsewhere it reads the controlling terminal, which only reports
+// presses: an uppercase letter is SHIFT + key, Tab stands in for SHIFT alone, and the
+// release callback is never called.
 class KeyboardInput {
  public:
   KeyboardInput();
@@ -21,21 +34,29 @@ class KeyboardInput {
   // Set the callback to be called when a key is pressed
   void setKeyPressCallback(KeyPressCallback callback);
 
+  // Set the callback to be called when a key is released
+  void setKeyReleaseCallback(KeyReleaseCallback callback);
+
   // Start listening for keyboard events
   // This will run the event loop in the current thread
   void startEventLoop();
 
-  // Stop the event loop
+  // Stop the event loop (safe to call from a signal handler)
   void stop();
 
  private:
+  KeyPressCallback callback_;
+  KeyReleaseCallback release_callback_;
+#if defined(__APPLE__)
   // Make the C callback function a friend so it can access callback_
   friend CGEventRef eventTapCallbackC(CGEventTapProxy proxy, CGEventType type, CGEventRef event, void* user_data);
 
-  KeyPressCallback callback_;
   void* event_tap_;
   void* run_loop_source_;
   void* run_loop_;  // Store the run loop we're using
+#else
+  int stop_pipe_[2];  // stop() writes to it to wake the terminal read loop
+#endif
   bool running_;
 };
 
@@ -5,6 +5,62 @@
 
 namespace mpccli {
 
+namespace {
+
+// Convert keycode to character (0 if the key isn't handled)
+// This is a simplified mapping - in production you'd use a more complete mapping
+char keyCodeToChar(CGKeyCode keyCode) {
+  char key = 0;
+
+  // Letter keys (a-z)
+  if (keyCode == 0) key = 'a';
+  else if (keyCode == 11) key = 'b';
+  else if (keyCode == 8) key = 'c';
+  else if (keyCode == 2) key = 'd';
+  else if (keyCode == 14) key = 'e';
+  else if (keyCode == 3) key = 'f';
+  else if (keyCode == 5) key = 'g';
+  else if (keyCode == 4) key = 'h';
+  else if (keyCode == 34) key = 'i';
+  else if (keyCode == 38) key = 'j';
+  else if (keyCode == 40) key = 'k';
+  else if (keyCode == 37) key = 'l';
+  else if (keyCode == 46) key = 'm';
+  else if (keyCode == 45) key = 'n';
+  else if (keyCode == 31) key = 'o';
+  else if (keyCode == 35) key = 'p';
+  else if (keyCode == 12) key = 'q';
+  else if (keyCode == 15) key = 'r';
+  else if (keyCode == 1) key = 's';
+  else if (keyCode == 17) key = 't';
+  else if (keyCode == 32) key = 'u';
+  else if (keyCode == 9) key = 'v';
+  else if (keyCode == 13) key = 'w';
+  else if (keyCode == 7) key = 'x';
+  else if (keyCode == 16) key = 'y';
+  else if (keyCode == 6) key = 'z';
+  // Number keys (0-9)
+  else if (keyCode == 29) key = '0';
+  else if (keyCode == 18) key = '1';
+  else if (keyCode == 19) key = '2';
+  else if (keyCode == 20) key = '3';
+  else if (keyCode == 21) key = '4';
+  else if (keyCode == 23) key = '5';
+  else if (keyCode == 22) key = '6';
+  else if (keyCode == 26) key = '7';
+  else if (keyCode == 28) key = '8';
+  else if (keyCode == 25) key = '9';
+  // Bracket keys (bank switching)
+  else if (keyCode == 33) key = '[';
+  else if (keyCode == 30) key = ']';
+  // ESC key
+  else if (keyCode == 53) key = 27;  // ESC
+
+  return key;
+}
+
+}  // namespace
+
 // C callback wrapper for the event tap
 CGEventRef eventTapCallbackC(CGEventTapProxy proxy, CGEventType type, CGEventRef event, void* user_data) {
   KeyboardInput* input = static_cast<KeyboardInput*>(user_data);
@@ -26,7 +82,7 @@ CGEventRef eventTapCallbackC(CGEventTapProxy proxy, CGEventType type, CGEventRef
     else if (wasShiftPressed && !isShiftPressed) {
       // Only send SHIFT-alone event if no other key was pressed with it
       if (!keyPressedWithShift && input && input->callback_) {
-        input->callback_(1, false);
+        input->callback_(1, false, kKeyboardVelocity);
       }
       keyPressedWithShift = false;  // Reset for next time
     }
@@ -35,56 +91,29 @@ CGEventRef eventTapCallbackC(CGEventTapProxy proxy, CGEventType type, CGEventRef
     return event;  // Pass through, don't consume
   }
 
+  if (type == kCGEventKeyUp) {
+    CGKeyCode keyCode = (CGKeyCode)CGEventGetIntegerValueField(event, kCGKeyboardEventKeycode);
+    char key = keyCodeToChar(keyCode);
+    if (key != 0) {
+      if (input && input->release_callback_) {
+        input->release_callback_(key);
+      }
+      return NULL;
+    }
+  }
+
   if (type == kCGEventKeyDown) {
     // Get the key code
     CGKeyCode keyCode = (CGKeyCode)CGEventGetIntegerValueField(event, kCGKeyboardEventKeycode);
 
-    // Convert keycode to character
-    // This is a simplified mapping - in production you'd use a more complete mapping
-    char key = 0;
-
-    // Letter keys (a-z)
-    if (keyCode == 0) key = 'a';
-    else if (keyCode == 11) key = 'b';
-    else if (keyCode == 8) key = 'c';
-    else if (keyCode == 2) key = 'd';
-    else if (keyCode == 14) key = 'e';
-    else if (keyCode == 3) key = 'f';
-    else if (keyCode == 5) key = 'g';
-    else if (keyCode == 4) key = 'h';
-    else if (keyCode == 34) key = 'i';
-    else if (keyCode == 38) key = 'j';
-    else if (keyCode == 40) key = 'k';
-    else if (keyCode == 37) key = 'l';
-    else if (keyCode == 46) key = 'm';
-    else if (keyCode == 45) key = 'n';
-    else if (keyCode == 31) key = 'o';
-    else if (keyCode == 35) key = 'p';
-    else if (keyCode == 12) key = 'q';
-    else if (keyCode == 15) key = 'r';
-    else if (keyCode == 1) key = 's';
-    else if (keyCode == 17) key = 't';
-    else if (keyCode == 32) key = 'u';
-    else if (keyCode == 9) key = 'v';
-    else if (keyCode == 13) key = 'w';
-    else if (keyCode == 7) key = 'x';
-    else if (keyCode == 16) key = 'y';
-    else if (keyCode == 6) key = 'z';
-    // Number keys (0-9)
-    else if (keyCode == 29) key = '0';
-    else if (keyCode == 18) key = '1';
-    else if (keyCode == 19) key = '2';
-    else if (keyCode == 20) key = '3';
-    else if (keyCode == 21) key = '4';
-    else if (keyCode == 23) key = '5';
-    else if (keyCode == 22) key = '6';
-    else if (keyCode == 26) key = '7';
-    else if (keyCode == 28) key = '8';
-    else if (keyCode == 25) key = '9';
-    // ESC key
-    else if (keyCode == 53) key = 27;  // ESC
+    char key = keyCodeToChar(keyCode);
 
     if (key != 0) {
+      // Holding a key sends repeated key downs; only the first one is a note-on
+      if (CGEventGetIntegerValueField(event, kCGKeyboardEventAutorepeat) != 0) {
+        return NULL;
+      }
+
       // Check if SHIFT is pressed (as modifier)
       CGEventFlags flags = CGEventGetFlags(event);
       bool shift_pressed = (flags & kCGEventFlagMaskShift) != 0;
@@ -96,7 +125,7 @@ CGEventRef eventTapCallbackC(CGEventTapProxy proxy, CGEventType type, CGEventRef
 
       // Get the callback from the KeyboardInput instance
       if (input && input->callback_) {
-        input->callback_(key, shift_pressed);
+        input->callback_(key, shift_pressed, kKeyboardVelocity);
       }
       // Consume the event - don't pass it to the terminal
       return NULL;
@@ -122,13 +151,17 @@ void KeyboardInput::setKeyPressCallback(KeyPressCallback callback) {
   callback_ = callback;
 }
 
+void KeyboardInput::setKeyReleaseCallback(KeyReleaseCallback callback) {
+  release_callback_ = callback;
+}
+
 void KeyboardInput::startEventLoop() {
   if (running_) {
     return;
   }
 
-  // Create an event tap to listen for key down events and flags changed (for modifier keys)
-  CGEventMask eventMask = (1 << kCGEventKeyDown) | (1 << kCGEventFlagsChanged);
+  // Create an event tap to listen for key down/up events and flags changed (for modifier keys)
+  CGEventMask eventMask = (1 << kCGEventKeyDown) | (1 << kCGEventKeyUp) | (1 << kCGEventFlagsChanged);
   event_tap_ = (void*)CGEventTapCreate(
       kCGSessionEventTap,
       kCGHeadInsertEventTap,
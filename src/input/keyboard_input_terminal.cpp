@@ -0,0 +1,146 @@
+#include "keyboard_input.h"
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+namespace mpccli {
+
+namespace {
+
+constexpr char kEscape = 27;
+constexpr char kShiftAlone = 1;  // Key code main.cpp expects for SHIFT pressed on its own
+
+// Key (and whether SHIFT was held) for a byte read from the terminal (0 if not handled)
+char byteToKey(char byte, bool& shift) {
+  shift = false;
+  if (byte >= 'A' && byte <= 'Z') {
+    shift = true;
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(byte)));
+  }
+  if ((byte >= 'a' && byte <= 'z') || (byte >= '0' && byte <= '9') || byte == '[' || byte == ']') {
+    return byte;
+  }
+  if (byte == '\t') {
+    return kShiftAlone;
+  }
+  return 0;
+}
+
+}  // namespace
+
+KeyboardInput::KeyboardInput()
+    : running_(false) {
+  stop_pipe_[0] = -1;
+  stop_pipe_[1] = -1;
+}
+
+KeyboardInput::~KeyboardInput() {
+  stop();
+  for (int fd : stop_pipe_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
+void KeyboardInput::setKeyPressCallback(KeyPressCallback callback) {
+  callback_ = callback;
+}
+
+void KeyboardInput::setKeyReleaseCallback(KeyReleaseCallback callback) {
+  release_callback_ = callback;
+}
+
+void KeyboardInput::startEventLoop() {
+  if (running_) {
+    return;
+  }
+  if (!isatty(STDIN_FILENO)) {
+    std::cerr << "Keyboard input needs a terminal on standard input" << std::endl;
+    return;
+  }
+  if (stop_pipe_[0] < 0 && pipe(stop_pipe_) != 0) {
+    std::cerr << "Failed to start keyboard input: " << std::strerror(errno) << std::endl;
+    return;
+  }
+
+  // Read key presses one byte at a time, without echo or waiting for Enter
+  struct termios saved;
+  tcgetattr(STDIN_FILENO, &saved);
+  struct termios raw = saved;
+  raw.c_lflag &= ~(ICANON | ECHO);
+  raw.c_cc[VMIN] = 1;
+  raw.c_cc[VTIME] = 0;
+  tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+
+  running_ = true;
+  std::cout << "Keyboard event loop started. Press keys to play samples, ESC to quit." << std::endl;
+
+  while (running_) {
+    struct pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {stop_pipe_[0], POLLIN, 0}};
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (fds[1].revents != 0) {
+      break;
+    }
+    if ((fds[0].revents & (POLLIN | POLLHUP)) == 0) {
+      continue;
+    }
+
+    char bytes[64];
+    const ssize_t count = read(STDIN_FILENO, bytes, sizeof(bytes));
+    if (count <= 0) {
+      break;
+    }
+    for (ssize_t i = 0; i < count; ++i) {
+      if (bytes[i] == kEscape) {
+        // Arrow and function keys arrive as escape sequences in one read: skip them, so
+        // only ESC on its own quits
+        if (i + 1 < count) {
+          break;
+        }
+        if (callback_) {
+          callback_(kEscape, false, kKeyboardVelocity);
+        }
+        continue;
+      }
+
+      bool shift = false;
+      const char key = byteToKey(bytes[i], shift);
+      if (key == 0) {
+        continue;
+      }
+      // The terminal never reports the key going up, so no release is sent: notes with
+      // an envelope play through to the end of the sample rather than being cut short
+      if (callback_) {
+        callback_(key, shift, kKeyboardVelocity);
+      }
+    }
+  }
+
+  running_ = false;
+  tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+}
+
+void KeyboardInput::stop() {
+  // Only async-signal-safe calls: this runs from the SIGINT handler
+  if (!running_) {
+    return;
+  }
+  running_ = false;
+  if (stop_pipe_[1] >= 0) {
+    const char wake = 0;
+    ssize_t written = write(stop_pipe_[1], &wake, 1);
+    (void)written;
+  }
+}
+
+}  // namespace mpccli
@@ -0,0 +1,48 @@
+#include "midi_input.h"
+
+namespace mpccli {
+
+MidiInput::MidiInput() {
+  for (std::atomic<PadId>& pad : note_pads_) {
+    pad.store(kNoPad, std::memory_order_relaxed);
+  }
+}
+
+void MidiInput::mapNote(int note, PadId pad) {
+  if (note >= 0 && note < static_cast<int>(note_pads_.size())) {
+    note_pads_[note].store(pad, std::memory_order_relaxed);
+  }
+}
+
+void MidiInput::setNoteCallback(MidiNoteCallback callback) {
+  callback_ = callback;
+}
+
+void MidiInput::setProgramCallback(MidiProgramCallback callback) {
+  program_callback_ = callback;
+}
+
+void MidiInput::handleMessage(unsigned char status, unsigned char data1, unsigned char data2,
+                              std::chrono::steady_clock::time_point received) {
+  const unsigned char type = status & 0xF0;
+  if (type == 0xC0) {
+    if (program_callback_) {
+      program_callback_(data1 & 0x7F);
+    }
+    return;
+  }
+  if (type != 0x80 && type != 0x90) {
+    return;
+  }
+
+  const PadId pad = note_pads_[data1 & 0x7F].load(std::memory_order_relaxed);
+  if (pad == kNoPad || !callback_) {
+    return;
+  }
+
+  // Note-on with velocity 0 is a note-off (running status controllers send these)
+  const int velocity = type == 0x90 ? (data2 & 0x7F) : 0;
+  callback_(pad, velocity, received);
+}
+
+}  // namespace mpccli
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include "../kit/pad.h"
+
+namespace mpccli {
+
+// Callback type for MIDI notes mapped to a pad
+// Parameters: PadId pad, int velocity (1-127, or 0 for note-off), time the message arrived
+using MidiNoteCallback =
+    std::function<void(PadId pad, int velocity, std::chrono::steady_clock::time_point received)>;
+
+// Callback type for program change messages (program 0-127)
+using MidiProgramCallback = std::function<void(int program)>;
+
+// MIDI controller input. Note numbers are mapped to pads (samples.yaml `note`),
+// so pads play exactly like their keyboard keys but with the controller's velocity.
+// Backends are platform specific; create() returns the one for this platform.
+// Each backend timestamps messages as soon as they are read, so the time spent
+// getting a note to the audio thread can be measured.
+class MidiInput {
+ public:
+  virtual ~MidiInput() = default;
+
+  // Platform backend, or nullptr if MIDI isn't supported on this platform
+  static std::unique_ptr<MidiInput> create();
+
+  // Play `pad` for MIDI note `note` (0-127) on any channel (kNoPad unmaps the note).
+  // Safe to call while receiving, e.g. when the kit is reloaded.
+  void mapNote(int note, PadId pad);
+
+  // Set the callback called for mapped note-on and note-off messages
+  // (called on the backend's MIDI thread)
+  void setNoteCallback(MidiNoteCallback callback);
+
+  // Set the callback called for program changes on any channel (called on the backend's MIDI thread)
+  void setProgramCallback(MidiProgramCallback callback);
+
+  // Connect to the MIDI sources and start receiving. Returns false if MIDI is unavailable.
+  virtual bool start() = 0;
+
+  // Stop receiving (no callbacks are made once this returns)
+  virtual void stop() = 0;
+
+ protected:
+  MidiInput();
+
+  // Decode a channel voice message and report it if it is a mapped note or a program change
+  // (data2 is ignored for program changes)
+  void handleMessage(unsigned char status, unsigned char data1, unsigned char data2,
+                     std::chrono::steady_clock::time_point received);
+
+ private:
+  std::array<std::atomic<PadId>, 128> note_pads_;  // kNoPad = unmapped
+  MidiNoteCallback callback_;
+  MidiProgramCallback program_callback_;
+};
+
+}  // namespace mpccli
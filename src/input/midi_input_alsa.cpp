@@ -0,0 +1,139 @@
+#include "midi_input.h"
+#include <alsa/asoundlib.h>
+#include <poll.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace mpccli {
+
+namespace {
+
+// ALSA sequencer backend: a virtual input port ("mpc-cli:input") that controllers
+// and other applications connect to, e.g. `aconnect <controller> mpc-cli`
+class AlsaMidiInput : public MidiInput {
+ public:
+  AlsaMidiInput() : seq_(nullptr), port_(-1), running_(false) {
+    stop_pipe_[0] = -1;
+    stop_pipe_[1] = -1;
+  }
+
+  ~AlsaMidiInput() override {
+    stop();
+  }
+
+  bool start() override {
+    if (running_) {
+      return true;
+    }
+
+    if (snd_seq_open(&seq_, "default", SND_SEQ_OPEN_INPUT, SND_SEQ_NONBLOCK) < 0) {
+      std::cerr << "Failed to open ALSA sequencer" << std::endl;
+      seq_ = nullptr;
+      return false;
+    }
+    snd_seq_set_client_name(seq_, "mpc-cli");
+
+    port_ = snd_seq_create_simple_port(seq_, "input", SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE,
+                                       SND_SEQ_PORT_TYPE_MIDI_GENERIC | SND_SEQ_PORT_TYPE_APPLICATION);
+    if (port_ < 0 || pipe(stop_pipe_) != 0) {
+      std::cerr << "Failed to create ALSA sequencer port" << std::endl;
+      closeAll();
+      return false;
+    }
+
+    std::cout << "MIDI input: ALSA sequencer port " << snd_seq_client_id(seq_) << ":" << port_ << std::endl;
+
+    running_ = true;
+    thread_ = std::thread([this]() { receiveLoop(); });
+    return true;
+  }
+
+  void stop() override {
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+
+    // Wake the poll() in receiveLoop
+    const char wake = 0;
+    (void)write(stop_pipe_[1], &wake, 1);
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    closeAll();
+  }
+
+ private:
+  void receiveLoop() {
+    const int seq_fds = snd_seq_poll_descriptors_count(seq_, POLLIN);
+    std::vector<pollfd> fds(seq_fds + 1);
+    snd_seq_poll_descriptors(seq_, fds.data(), seq_fds, POLLIN);
+    fds[seq_fds] = {stop_pipe_[0], POLLIN, 0};
+
+    while (running_) {
+      if (poll(fds.data(), fds.size(), -1) < 0) {
+        if (errno == EINTR) {
+          continue;  // Interrupted by a signal
+        }
+        // Anything else (the sequencer went away) would fail again at once
+        std::cerr << "MIDI input stopped: " << std::strerror(errno) << std::endl;
+        return;
+      }
+
+      // Everything read in this wakeup arrived together
+      const auto received = std::chrono::steady_clock::now();
+
+      snd_seq_event_t* event = nullptr;
+      while (snd_seq_event_input(seq_, &event) >= 0 && event) {
+        switch (event->type) {
+          case SND_SEQ_EVENT_NOTEON:
+            handleMessage(0x90 | event->data.note.channel, event->data.note.note, event->data.note.velocity,
+                          received);
+            break;
+          case SND_SEQ_EVENT_NOTEOFF:
+            handleMessage(0x80 | event->data.note.channel, event->data.note.note, 0, received);
+            break;
+          case SND_SEQ_EVENT_PGMCHANGE:
+            handleMessage(0xC0 | event->data.control.channel, static_cast<unsigned char>(event->data.control.value),
+                          0, received);
+            break;
+          default:
+            break;
+        }
+      }
+    }
+  }
+
+  void closeAll() {
+    if (seq_) {
+      snd_seq_close(seq_);
+      seq_ = nullptr;
+    }
+    for (int& fd : stop_pipe_) {
+      if (fd >= 0) {
+        close(fd);
+        fd = -1;
+      }
+    }
+    port_ = -1;
+  }
+
+  snd_seq_t* seq_;
+  int port_;
+  int stop_pipe_[2];
+  std::atomic<bool> running_;
+  std::thread thread_;
+};
+
+}  // namespace
+
+std::unique_ptr<MidiInput> MidiInput::create() {
+  return std::make_unique<AlsaMidiInput>();
+}
+
+}  // namespace mpccli
@@ -0,0 +1,107 @@
+#include "midi_input.h"
+#include <iostream>
+#import <CoreMIDI/CoreMIDI.h>
+
+namespace mpccli {
+
+namespace {
+
+// CoreMIDI backend: one input port connected to every source present at start()
+class CoreMidiInput : public MidiInput {
+ public:
+  CoreMidiInput() : client_(0), port_(0), running_(false) {}
+
+  ~CoreMidiInput() override {
+    stop();
+  }
+
+  bool start() override {
+    if (running_) {
+      return true;
+    }
+
+    if (MIDIClientCreate(CFSTR("mpc-cli"), nullptr, nullptr, &client_) != noErr) {
+      std::cerr << "Failed to create MIDI client" << std::endl;
+      return false;
+    }
+    if (MIDIInputPortCreate(client_, CFSTR("mpc-cli input"), readProc, this, &port_) != noErr) {
+      std::cerr << "Failed to create MIDI input port" << std::endl;
+      MIDIClientDispose(client_);
+      client_ = 0;
+      return false;
+    }
+
+    const ItemCount sources = MIDIGetNumberOfSources();
+    for (ItemCount i = 0; i < sources; ++i) {
+      MIDIPortConnectSource(port_, MIDIGetSource(i), nullptr);
+    }
+    std::cout << "MIDI input: listening to " << sources << " source(s)" << std::endl;
+
+    running_ = true;
+    return true;
+  }
+
+  void stop() override {
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+
+    // Disposing the port stops the read callbacks
+    MIDIPortDispose(port_);
+    MIDIClientDispose(client_);
+    port_ = 0;
+    client_ = 0;
+  }
+
+ private:
+  // Called on CoreMIDI's high-priority receive thread
+  static void readProc(const MIDIPacketList* packets, void* ref_con, void* /*source_ref_con*/) {
+    CoreMidiInput* input = static_cast<CoreMidiInput*>(ref_con);
+    const auto received = std::chrono::steady_clock::now();
+
+    const MIDIPacket* packet = &packets->packet[0];
+    for (UInt32 p = 0; p < packets->numPackets; ++p) {
+      input->handlePacket(*packet, received);
+      packet = MIDIPacketNext(packet);
+    }
+  }
+
+  // A packet may hold several messages, possibly using running status
+  void handlePacket(const MIDIPacket& packet, std::chrono::steady_clock::time_point received) {
+    unsigned char status = 0;
+    for (UInt16 i = 0; i < packet.length;) {
+      const unsigned char byte = packet.data[i];
+      if (byte & 0x80) {
+        status = byte;
+        ++i;
+      }
+
+      // Channel voice messages: program change and channel pressure have one data byte
+      const unsigned char type = status & 0xF0;
+      const bool one_byte = type == 0xC0 || type == 0xD0;
+      if (status < 0xF0 && one_byte && i < packet.length) {
+        handleMessage(status, packet.data[i], 0, received);
+        i += 1;
+      } else if (status < 0xF0 && !one_byte && i + 1 < packet.length) {
+        handleMessage(status, packet.data[i], packet.data[i + 1], received);
+        i += 2;
+      } else {
+        // Skip bytes of messages we don't decode
+        ++i;
+      }
+    }
+  }
+
+  MIDIClientRef client_;
+  MIDIPortRef port_;
+  bool running_;
+};
+
+}  // namespace
+
+std::unique_ptr<MidiInput> MidiInput::create() {
+  return std::make_unique<CoreMidiInput>();
+}
+
+}  // namespace mpccli
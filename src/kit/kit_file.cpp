@@ -0,0 +1,486 @@
+#include "kit_file.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "../gstreamer/sample_decoder.h"
+
+namespace mpccli {
+
+namespace {
+
+constexpr char kKitMagic[8] = {'M', 'P', 'C', 'K', 'I', 'T', '\0', '\0'};
+constexpr uint32_t kKitVersion = 6;
+constexpr uint64_t kPcmAlignment = 64;  // Cache line (and widest SIMD load)
+constexpr uint32_t kRealtimeLockMemory = 1;
+constexpr uint32_t kRealtimePrefault = 2;
+
+// Everything below is written and mapped as-is, so only fixed-size fields
+
+struct KitString {
+  uint32_t offset;  // Into the string table
+  uint32_t length;
+};
+
+struct KitHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t channels;
+  double sample_rate;
+
+  uint32_t sample_count;
+  uint32_t layer_count;
+  uint32_t file_ref_count;
+  uint32_t file_count;
+  uint32_t bank_count;
+  uint32_t render_threads;
+  uint64_t samples_offset;
+  uint64_t layers_offset;
+  uint64_t file_refs_offset;
+  uint64_t files_offset;
+  uint64_t banks_offset;
+  uint64_t strings_offset;
+  uint64_t strings_size;
+  uint64_t file_size;
+
+  // Settings
+  uint32_t resampler_quality;
+  int32_t osc_port;
+  uint64_t pitch_cache_mb;
+  double output_sample_rate;
+  uint32_t buffer_frames;
+  uint32_t periods;
+  uint32_t output_backend;
+  KitString output_device;
+  int32_t audio_priority;
+  int32_t scheduler_priority;
+  uint32_t realtime_flags;  // kRealtimeLockMemory | kRealtimePrefault
+  KitString audio_cores;    // "2,3", see formatCoreList()
+  KitString scheduler_cores;
+  KitString socket_path;
+  KitString mixer;  // YAML, see mixerSettingsToYaml()
+};
+
+struct KitSample {
+  KitString name;
+  uint32_t pad;
+  uint32_t bank;
+  int32_t key;
+  int32_t midi_note;
+  double volume;
+  uint32_t pitch_mode;
+  uint32_t precompute_pitches;
+  uint32_t has_envelope;
+  int32_t choke_group;
+  float attack;
+  float decay;
+  float sustain;
+  float release;
+  uint32_t first_layer;
+  uint32_t layer_count;
+};
+
+struct KitLayer {
+  int32_t velocity_low;
+  int32_t velocity_high;
+  uint32_t first_file_ref;  // Into the file reference table (indices into the file table)
+  uint32_t file_ref_count;
+};
+
+struct KitFile {
+  KitString path;
+  uint64_t pcm_offset;    // From the start of the kit file
+  uint64_t sample_count;  // Floats (frames * channels)
+};
+
+static_assert(std::is_trivially_copyable_v<KitHeader> && std::is_trivially_copyable_v<KitSample> &&
+              std::is_trivially_copyable_v<KitLayer> && std::is_trivially_copyable_v<KitFile>);
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// Builds the string table
+class StringTable {
+ public:
+  KitString add(const std::string& text) {
+    KitString ref{static_cast<uint32_t>(data_.size()), static_cast<uint32_t>(text.size())};
+    data_ += text;
+    return ref;
+  }
+  const std::string& data() const { return data_; }
+
+ private:
+  std::string data_;
+};
+
+// Zero-pad the output up to `offset`
+void padTo(std::ofstream& out, uint64_t offset) {
+  const uint64_t position = static_cast<uint64_t>(out.tellp());
+  if (offset > position) {
+    const std::vector<char> padding(offset - position, 0);
+    out.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+  }
+}
+
+// Write `count` records starting at `offset`
+template <typename T>
+void writeTable(std::ofstream& out, uint64_t offset, const T* table, size_t count) {
+  padTo(out, offset);
+  out.write(reinterpret_cast<const char*>(table), static_cast<std::streamsize>(count * sizeof(T)));
+}
+
+// Bounds-checked view of the mapped file
+class MappedKit {
+ public:
+  MappedKit(const char* base, uint64_t size) : base_(base), size_(size) {}
+
+  template <typename T>
+  const T* table(uint64_t offset, uint64_t count, const char* what) const {
+    if (offset % alignof(T) != 0 || offset > size_ || count > (size_ - offset) / sizeof(T)) {
+      throw std::runtime_error(std::string("kit file is damaged (") + what + " table out of range)");
+    }
+    return reinterpret_cast<const T*>(base_ + offset);
+  }
+
+  std::string string(const KitHeader& header, const KitString& ref) const {
+    if (static_cast<uint64_t>(ref.offset) + ref.length > header.strings_size) {
+      throw std::runtime_error("kit file is damaged (string out of range)");
+    }
+    return std::string(base_ + header.strings_offset + ref.offset, ref.length);
+  }
+
+ private:
+  const char* base_;
+  uint64_t size_;
+};
+
+}  // namespace
+
+bool buildKit(const std::string& yaml_path, const std::string& kit_path) {
+  KitLayout layout;
+  EngineSettings engine;
+  ControlSettings control;
+  MixerSettings mixer;
+  try {
+    layout = loadSamplesFromYaml(yaml_path);
+    engine = loadEngineSettingsFromYaml(yaml_path);
+    control = loadControlSettingsFromYaml(yaml_path);
+    mixer = loadMixerSettingsFromYaml(yaml_path);
+  } catch (const std::exception& e) {
+    std::cerr << "Failed to load samples from " << yaml_path << ": " << e.what() << std::endl;
+    return false;
+  }
+
+  // Decode each file once, whichever pads and layers share it
+  DecodedFiles files;
+  for (const auto& [pad, spec] : layout.pads) {
+    for (const SampleLayer& layer : spec.layers) {
+      for (const std::string& path : layer.files) {
+        if (files.count(path)) {
+          continue;
+        }
+        try {
+          files[path] = std::make_shared<const SampleBuffer>(decodeAudioFile(path, kEngineSampleRate, kEngineChannels));
+        } catch (const std::exception& e) {
+          std::cerr << "Failed to decode " << path << " (sample '" << spec.name << "'): " << e.what() << std::endl;
+          return false;
+        }
+      }
+    }
+  }
+
+  if (!writeKitFile(kit_path, layout, engine, control, mixer, files)) {
+    return false;
+  }
+
+  std::error_code error;
+  const uintmax_t bytes = std::filesystem::file_size(kit_path, error);
+  std::cout << "Wrote " << kit_path << ": " << layout.pads.size() << " samples in " << layout.banks.size()
+            << " banks, " << files.size() << " files, "
+            << (error ? 0 : bytes / (1024 * 1024)) << " MB" << std::endl;
+  return true;
+}
+
+bool writeKitFile(const std::string& kit_path, const KitLayout& layout, const EngineSettings& engine,
+                  const ControlSettings& control, const MixerSettings& mixer, const DecodedFiles& files) {
+  StringTable strings;
+  std::vector<KitString> bank_table;
+  std::vector<KitSample> sample_table;
+  std::vector<KitLayer> layer_table;
+  std::vector<uint32_t> file_refs;
+  std::vector<KitFile> file_table;
+  std::vector<const SampleBuffer*> pcm;
+  std::unordered_map<std::string, uint32_t> file_index;
+
+  for (const std::string& bank : layout.banks) {
+    bank_table.push_back(strings.add(bank));
+  }
+
+  for (const auto& [pad, spec] : layout.pads) {
+    KitSample sample{};
+    sample.name = strings.add(spec.name);
+    sample.pad = pad;
+    sample.bank = static_cast<uint32_t>(spec.bank);
+    sample.key = static_cast<unsigned char>(spec.key);
+    sample.midi_note = spec.midi_note;
+    sample.volume = spec.options.volume;
+    sample.pitch_mode = static_cast<uint32_t>(spec.options.pitch_mode);
+    sample.precompute_pitches = spec.options.precompute_pitches;
+    sample.has_envelope = spec.options.envelope.has_value();
+    const AdsrParams envelope = spec.options.envelope.value_or(AdsrParams{});
+    sample.attack = envelope.attack;
+    sample.decay = envelope.decay;
+    sample.sustain = envelope.sustain;
+    sample.release = envelope.release;
+    sample.choke_group = spec.options.choke_group;
+    sample.first_layer = static_cast<uint32_t>(layer_table.size());
+    sample.layer_count = static_cast<uint32_t>(spec.layers.size());
+
+    for (const SampleLayer& layer : spec.layers) {
+      layer_table.push_back({layer.velocity_low, layer.velocity_high, static_cast<uint32_t>(file_refs.size()),
+                             static_cast<uint32_t>(layer.files.size())});
+
+      for (const std::string& path : layer.files) {
+        auto indexed = file_index.find(path);
+        if (indexed == file_index.end()) {
+          auto decoded = files.find(path);
+          if (decoded == files.end() || decoded->second->channels != kEngineChannels ||
+              decoded->second->sample_rate != kEngineSampleRate) {
+            std::cerr << "No engine-format audio for " << path << " (sample '" << spec.name << "')" << std::endl;
+            return false;
+          }
+          indexed = file_index.emplace(path, static_cast<uint32_t>(file_table.size())).first;
+          file_table.push_back({strings.add(path), 0, decoded->second->size()});
+          pcm.push_back(decoded->second.get());
+        }
+        file_refs.push_back(indexed->second);
+      }
+    }
+    sample_table.push_back(sample);
+  }
+
+  KitHeader header{};
+  std::memcpy(header.magic, kKitMagic, sizeof(kKitMagic));
+  header.version = kKitVersion;
+  header.channels = kEngineChannels;
+  header.sample_rate = kEngineSampleRate;
+  header.resampler_quality = static_cast<uint32_t>(engine.resampler_quality);
+  header.pitch_cache_mb = engine.pitch_cache_mb;
+  header.render_threads = static_cast<uint32_t>(engine.render_threads);
+  header.output_sample_rate = engine.output.sample_rate;
+  header.buffer_frames = static_cast<uint32_t>(engine.output.buffer_frames);
+  header.periods = static_cast<uint32_t>(engine.output.periods);
+  header.output_backend = static_cast<uint32_t>(engine.output.backend);
+  header.output_device = strings.add(engine.output.device);
+  header.audio_priority = engine.realtime.audio.priority;
+  header.scheduler_priority = engine.realtime.scheduler.priority;
+  header.realtime_flags = (engine.realtime.lock_memory ? kRealtimeLockMemory : 0) |
+                          (engine.realtime.prefault ? kRealtimePrefault : 0);
+  header.audio_cores = strings.add(formatCoreList(engine.realtime.audio.cores));
+  header.scheduler_cores = strings.add(formatCoreList(engine.realtime.scheduler.cores));
+  header.osc_port = control.osc_port;
+  header.socket_path = strings.add(control.socket_path);
+  header.mixer = strings.add(mixerSettingsToYaml(mixer));
+
+  // Tables follow the header, each aligned for its records; the PCM comes last
+  header.sample_count = static_cast<uint32_t>(sample_table.size());
+  header.layer_count = static_cast<uint32_t>(layer_table.size());
+  header.file_ref_count = static_cast<uint32_t>(file_refs.size());
+  header.file_count = static_cast<uint32_t>(file_table.size());
+  header.bank_count = static_cast<uint32_t>(bank_table.size());
+  header.samples_offset = alignUp(sizeof(KitHeader), 8);
+  header.layers_offset = alignUp(header.samples_offset + sample_table.size() * sizeof(KitSample), 8);
+  header.file_refs_offset = alignUp(header.layers_offset + layer_table.size() * sizeof(KitLayer), 8);
+  header.files_offset = alignUp(header.file_refs_offset + file_refs.size() * sizeof(uint32_t), 8);
+  header.banks_offset = alignUp(header.files_offset + file_table.size() * sizeof(KitFile), 8);
+  header.strings_offset = header.banks_offset + bank_table.size() * sizeof(KitString);
+  header.strings_size = strings.data().size();
+
+  uint64_t end = header.strings_offset + header.strings_size;
+  for (KitFile& file : file_table) {
+    file.pcm_offset = alignUp(end, kPcmAlignment);
+    end = file.pcm_offset + file.sample_count * sizeof(float);
+  }
+  header.file_size = end;
+
+  // Write next to the destination and rename, so a running instance never maps a partial kit
+  const std::string temp_path = kit_path + ".tmp";
+  {
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      std::cerr << "Cannot write " << temp_path << ": " << std::strerror(errno) << std::endl;
+      return false;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeTable(out, header.samples_offset, sample_table.data(), sample_table.size());
+    writeTable(out, header.layers_offset, layer_table.data(), layer_table.size());
+    writeTable(out, header.file_refs_offset, file_refs.data(), file_refs.size());
+    writeTable(out, header.files_offset, file_table.data(), file_table.size());
+    writeTable(out, header.banks_offset, bank_table.data(), bank_table.size());
+    writeTable(out, header.strings_offset, strings.data().data(), strings.data().size());
+    for (size_t i = 0; i < file_table.size(); ++i) {
+      writeTable(out, file_table[i].pcm_offset, pcm[i]->data(), pcm[i]->size());
+    }
+    if (!out) {
+      std::cerr << "Failed writing " << temp_path << std::endl;
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temp_path, kit_path, error);
+  if (error) {
+    std::cerr << "Cannot replace " << kit_path << ": " << error.message() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+LoadedKit loadKitFile(const std::string& kit_path) {
+  const int fd = open(kit_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error("cannot open " + kit_path + ": " + std::strerror(errno));
+  }
+  struct stat info {};
+  if (fstat(fd, &info) != 0 || static_cast<uint64_t>(info.st_size) < sizeof(KitHeader)) {
+    close(fd);
+    throw std::runtime_error(kit_path + " is not a kit file");
+  }
+  const uint64_t size = static_cast<uint64_t>(info.st_size);
+
+  void* base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    throw std::runtime_error("cannot map " + kit_path + ": " + std::strerror(errno));
+  }
+  // Unmapped once the last buffer viewing it is gone
+  std::shared_ptr<const void> mapping(base, [size](const void* p) { munmap(const_cast<void*>(p), size); });
+
+  // Start reading the audio in ahead of the first notes, without waiting for it
+  madvise(base, size, MADV_WILLNEED);
+
+  const MappedKit kit(static_cast<const char*>(base), size);
+  const KitHeader& header = *kit.table<KitHeader>(0, 1, "header");
+  if (std::memcmp(header.magic, kKitMagic, sizeof(kKitMagic)) != 0) {
+    throw std::runtime_error(kit_path + " is not a kit file");
+  }
+  if (header.version != kKitVersion) {
+    throw std::runtime_error(kit_path + " was built by another version (rebuild it with `mpc-cli kit build`)");
+  }
+  if (header.channels != kEngineChannels || header.sample_rate != kEngineSampleRate) {
+    throw std::runtime_error(kit_path + " was built for another engine format (rebuild it with `mpc-cli kit build`)");
+  }
+  if (header.file_size != size || header.strings_offset > size || header.strings_size > size - header.strings_offset) {
+    throw std::runtime_error(kit_path + " is truncated or damaged");
+  }
+
+  const KitSample* samples = kit.table<KitSample>(header.samples_offset, header.sample_count, "sample");
+  const KitLayer* layers = kit.table<KitLayer>(header.layers_offset, header.layer_count, "layer");
+  const uint32_t* file_refs = kit.table<uint32_t>(header.file_refs_offset, header.file_ref_count, "file reference");
+  const KitFile* files = kit.table<KitFile>(header.files_offset, header.file_count, "file");
+  const KitString* banks = kit.table<KitString>(header.banks_offset, header.bank_count, "bank");
+  if (header.bank_count == 0 || header.bank_count > kMaxBanks) {
+    throw std::runtime_error(kit_path + " is damaged (bank count)");
+  }
+
+  LoadedKit loaded;
+  loaded.engine.resampler_quality = static_cast<ResamplerQuality>(header.resampler_quality);
+  loaded.engine.pitch_cache_mb = header.pitch_cache_mb;
+  loaded.engine.render_threads = std::max<uint32_t>(header.render_threads, 1);
+  loaded.engine.output.sample_rate = header.output_sample_rate;
+  loaded.engine.output.buffer_frames = header.buffer_frames;
+  loaded.engine.output.periods = header.periods;
+  if (header.output_backend > static_cast<uint32_t>(OutputBackend::Null)) {
+    throw std::runtime_error(kit_path + " is damaged (output backend)");
+  }
+  loaded.engine.output.backend = static_cast<OutputBackend>(header.output_backend);
+  loaded.engine.output.device = kit.string(header, header.output_device);
+  loaded.engine.realtime.audio.priority = header.audio_priority;
+  loaded.engine.realtime.scheduler.priority = header.scheduler_priority;
+  loaded.engine.realtime.lock_memory = (header.realtime_flags & kRealtimeLockMemory) != 0;
+  loaded.engine.realtime.prefault = (header.realtime_flags & kRealtimePrefault) != 0;
+  if (!parseCoreList(kit.string(header, header.audio_cores), loaded.engine.realtime.audio.cores) ||
+      !parseCoreList(kit.string(header, header.scheduler_cores), loaded.engine.realtime.scheduler.cores)) {
+    throw std::runtime_error(kit_path + " is damaged (realtime cores)");
+  }
+  loaded.control.osc_port = header.osc_port;
+  loaded.control.socket_path = kit.string(header, header.socket_path);
+  try {
+    loaded.mixer = parseMixerSettings(kit.string(header, header.mixer));
+  } catch (const std::exception& e) {
+    throw std::runtime_error(kit_path + " is damaged (mixer settings: " + e.what() + ")");
+  }
+  for (uint32_t b = 0; b < header.bank_count; ++b) {
+    loaded.layout.banks.push_back(kit.string(header, banks[b]));
+  }
+
+  // Sample buffers view the PCM in place
+  std::vector<std::string> paths(header.file_count);
+  for (uint32_t i = 0; i < header.file_count; ++i) {
+    const KitFile& file = files[i];
+    auto buffer = std::make_shared<SampleBuffer>();
+    buffer->view = kit.table<float>(file.pcm_offset, file.sample_count, "audio");
+    buffer->view_size = file.sample_count;
+    buffer->storage = mapping;
+    paths[i] = kit.string(header, file.path);
+    loaded.files[paths[i]] = std::move(buffer);
+  }
+
+  for (uint32_t s = 0; s < header.sample_count; ++s) {
+    const KitSample& sample = samples[s];
+    if (sample.first_layer > header.layer_count || sample.layer_count > header.layer_count - sample.first_layer) {
+      throw std::runtime_error(kit_path + " is damaged (layer range)");
+    }
+    if (sample.pad >= kMaxPads || sample.bank >= header.bank_count) {
+      throw std::runtime_error(kit_path + " is damaged (pad or bank out of range)");
+    }
+
+    SampleSpec spec;
+    spec.name = kit.string(header, sample.name);
+    spec.midi_note = sample.midi_note;
+    spec.key = static_cast<char>(sample.key);
+    spec.bank = sample.bank;
+    spec.options.volume = sample.volume;
+    spec.options.pitch_mode = static_cast<PitchMode>(sample.pitch_mode);
+    spec.options.precompute_pitches = sample.precompute_pitches != 0;
+    if (sample.has_envelope) {
+      spec.options.envelope = AdsrParams{sample.attack, sample.decay, sample.sustain, sample.release};
+    }
+    spec.options.choke_group = sample.choke_group;
+
+    for (uint32_t l = sample.first_layer; l < sample.first_layer + sample.layer_count; ++l) {
+      const KitLayer& layer = layers[l];
+      if (layer.first_file_ref > header.file_ref_count ||
+          layer.file_ref_count > header.file_ref_count - layer.first_file_ref) {
+        throw std::runtime_error(kit_path + " is damaged (file range)");
+      }
+      SampleLayer spec_layer;
+      spec_layer.velocity_low = layer.velocity_low;
+      spec_layer.velocity_high = layer.velocity_high;
+      for (uint32_t r = layer.first_file_ref; r < layer.first_file_ref + layer.file_ref_count; ++r) {
+        if (file_refs[r] >= header.file_count) {
+          throw std::runtime_error(kit_path + " is damaged (file index)");
+        }
+        spec_layer.files.push_back(paths[file_refs[r]]);
+      }
+      spec.layers.push_back(std::move(spec_layer));
+    }
+
+    loaded.layout.pads[static_cast<PadId>(sample.pad)] = std::move(spec);
+  }
+
+  return loaded;
+}
+
+}  // namespace mpccli
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "../config/kit_config.h"
+#include "../dsp/sample_buffer.h"
+
+namespace mpccli {
+
+// Decoded audio by file path, as referenced from SampleLayer::files
+using DecodedFiles = std::unordered_map<std::string, std::shared_ptr<const SampleBuffer>>;
+
+// A kit read from a compiled kit file
+struct LoadedKit {
+  KitLayout layout;
+  EngineSettings engine;
+  ControlSettings control;
+  MixerSettings mixer;
+
+  // PCM of every file, viewing the mapped kit file (it stays mapped while any buffer is alive)
+  DecodedFiles files;
+};
+
+// Compiled kit files (`mpc-cli kit build`) hold everything samples.yaml describes plus the
+// audio already decoded to the engine format, so a large kit starts without parsing YAML,
+// stat-ing or decoding anything.
+//
+// Layout (native byte order): a fixed header, then flat tables of samples (by pad), layers,
+// file references, files and bank names, then a string table, then each file's interleaved float PCM at a
+// 64-byte aligned offset. The mixer settings are kept as YAML text in the string table. Loading maps the file and points sample buffers straight into it;
+// pages are read in by the OS as they are first played.
+
+// Parse `yaml_path`, decode every sample it references (needs GStreamer) and write `kit_path`.
+// Returns false, after reporting why, on failure.
+bool buildKit(const std::string& yaml_path, const std::string& kit_path);
+
+// Write a kit from already decoded files (every path the samples reference must be in `files`,
+// in the engine format). Returns false, after reporting why, on failure.
+bool writeKitFile(const std::string& kit_path, const KitLayout& layout, const EngineSettings& engine,
+                  const ControlSettings& control, const MixerSettings& mixer, const DecodedFiles& files);
+
+// Map a kit file. Throws std::runtime_error if it can't be read, is damaged, or was built
+// by another version or for another engine format.
+LoadedKit loadKitFile(const std::string& kit_path);
+
+}  // namespace mpccli
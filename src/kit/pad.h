@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace mpccli {
+
+// Dense pad number. Every sample of a kit is a pad, numbered from 0 in samples.yaml order,
+// so the engine, processor and sequencer keep pads in flat arrays indexed by PadId.
+// Keyboard keys, MIDI notes and remote names all resolve to a PadId before a trigger.
+using PadId = uint16_t;
+
+constexpr size_t kMaxPads = 1024;
+constexpr PadId kNoPad = 0xFFFF;
+
+// Banks are switchable key layouts; every bank's pads stay loaded
+constexpr size_t kMaxBanks = 16;
+
+// How a pad is shown to the user
+struct PadLabel {
+  PadId pad = kNoPad;
+  char key = 0;  // Keyboard key in its bank (0 = none)
+  std::string name;
+};
+
+}  // namespace mpccli
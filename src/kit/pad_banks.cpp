@@ -0,0 +1,164 @@
+#include "pad_banks.h"
+#include <algorithm>
+#include <charconv>
+#include <thread>
+
+namespace mpccli {
+
+PadBanks::PadBanks()
+    : current_(0),
+      bank_count_(1),
+      names_(nullptr),
+      name_readers_(0),
+      names_owner_(std::make_unique<const NameTable>()) {
+  names_.store(names_owner_.get(), std::memory_order_relaxed);
+  for (auto& bank : keys_) {
+    for (std::atomic<PadId>& pad : bank) {
+      pad.store(kNoPad, std::memory_order_relaxed);
+    }
+  }
+  bank_names_.push_back("main");
+}
+
+void PadBanks::assign(const KitLayout& layout) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  const std::string current_name = bank_names_[current_.load(std::memory_order_relaxed)];
+  bank_names_.assign(layout.banks.begin(), layout.banks.begin() + std::min(layout.banks.size(), kMaxBanks));
+  if (bank_names_.empty()) {
+    bank_names_.push_back("main");
+  }
+
+  pads_.clear();
+  pad_banks_.clear();
+  auto names = std::make_unique<NameTable>();
+  std::array<std::array<PadId, 256>, kMaxBanks> keys;
+  for (auto& bank : keys) {
+    bank.fill(kNoPad);
+  }
+  for (const auto& [pad, spec] : layout.pads) {
+    const size_t bank = spec.bank < bank_names_.size() ? spec.bank : 0;
+    if (pad >= pads_.size()) {
+      pads_.resize(pad + 1);
+      pad_banks_.resize(pad + 1, 0);
+    }
+    pads_[pad] = {pad, spec.key, spec.name};
+    pad_banks_[pad] = bank;
+    (*names)[spec.name] = pad;
+    if (spec.key != 0) {
+      keys[bank][static_cast<unsigned char>(spec.key)] = pad;
+    }
+  }
+
+  // Publish the new names, then free the old table once no find() can still be reading it
+  // (lookups take well under a microsecond, and assign() only runs on kit loads)
+  names_.store(names.get(), std::memory_order_seq_cst);
+  while (name_readers_.load(std::memory_order_seq_cst) != 0) {
+    std::this_thread::yield();
+  }
+  names_owner_ = std::move(names);
+
+  // Entries are swapped one by one; a key pressed meanwhile plays either its old or new pad
+  for (size_t bank = 0; bank < kMaxBanks; ++bank) {
+    for (size_t key = 0; key < 256; ++key) {
+      keys_[bank][key].store(keys[bank][key], std::memory_order_relaxed);
+    }
+  }
+
+  size_t current = 0;
+  for (size_t bank = 0; bank < bank_names_.size(); ++bank) {
+    if (bank_names_[bank] == current_name) {
+      current = bank;
+    }
+  }
+  bank_count_.store(bank_names_.size(), std::memory_order_relaxed);
+  current_.store(current, std::memory_order_relaxed);
+}
+
+PadId PadBanks::padForKey(char key) const {
+  return keys_[current_.load(std::memory_order_relaxed)][static_cast<unsigned char>(key)].load(
+      std::memory_order_relaxed);
+}
+
+PadId PadBanks::find(std::string_view name) const {
+  // Registering as a reader before loading the table keeps assign() from freeing it
+  name_readers_.fetch_add(1, std::memory_order_seq_cst);
+  const NameTable& names = *names_.load(std::memory_order_seq_cst);
+  const auto it = names.find(name);
+  const PadId found = it != names.end() ? it->second : kNoPad;
+  name_readers_.fetch_sub(1, std::memory_order_release);
+
+  if (found != kNoPad) {
+    return found;
+  }
+  return name.size() == 1 ? padForKey(name[0]) : kNoPad;
+}
+
+bool PadBanks::selectBank(size_t bank) {
+  BankChangeCallback callback;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (bank >= bank_names_.size()) {
+      return false;
+    }
+    current_.store(bank, std::memory_order_relaxed);
+    callback = callback_;
+  }
+  if (callback) {
+    callback(bank);
+  }
+  return true;
+}
+
+bool PadBanks::selectBank(std::string_view name) {
+  size_t bank = kMaxBanks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t b = 0; b < bank_names_.size(); ++b) {
+      if (bank_names_[b] == name) {
+        bank = b;
+      }
+    }
+  }
+  if (bank == kMaxBanks) {
+    auto [end, error] = std::from_chars(name.data(), name.data() + name.size(), bank);
+    if (error != std::errc() || end != name.data() + name.size()) {
+      return false;
+    }
+  }
+  return selectBank(bank);
+}
+
+void PadBanks::stepBank(int delta) {
+  const int count = static_cast<int>(bankCount());
+  const int next = ((static_cast<int>(currentBank()) + delta) % count + count) % count;
+  selectBank(static_cast<size_t>(next));
+}
+
+std::string PadBanks::bankName(size_t bank) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bank < bank_names_.size() ? bank_names_[bank] : std::string();
+}
+
+std::string PadBanks::padName(PadId pad) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pad < pads_.size() ? pads_[pad].name : std::string();
+}
+
+std::vector<PadLabel> PadBanks::bankPads(size_t bank) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<PadLabel> labels;
+  for (size_t pad = 0; pad < pads_.size(); ++pad) {
+    if (pads_[pad].pad != kNoPad && pad_banks_[pad] == bank) {
+      labels.push_back(pads_[pad]);
+    }
+  }
+  return labels;
+}
+
+void PadBanks::setBankChangeCallback(BankChangeCallback callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  callback_ = std::move(callback);
+}
+
+}  // namespace mpccli
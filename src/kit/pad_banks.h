@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "pad.h"
+#include "../config/kit_config.h"
+
+namespace mpccli {
+
+// Called after the current bank changed (on the thread that switched it)
+using BankChangeCallback = std::function<void(size_t bank)>;
+
+// Resolves what the user plays to a pad: keyboard keys through the current bank's key
+// table, remote commands by sample name. Each bank is a flat 256-entry table of pad IDs,
+// so a key press is two atomic loads and switching banks is one store; the samples of
+// every bank stay loaded in the processor. Names are looked up in an immutable table that
+// assign() replaces, so find() is lock-free too.
+class PadBanks {
+ public:
+  PadBanks();
+
+  PadBanks(const PadBanks&) = delete;
+  PadBanks& operator=(const PadBanks&) = delete;
+
+  // Take the banks, keys and names of a (re)loaded kit. The current bank is kept by name
+  // if it still exists.
+  void assign(const KitLayout& layout);
+
+  // Pad played by `key` in the current bank, or kNoPad (lock-free)
+  PadId padForKey(char key) const;
+
+  // Pad by sample name, or by key in the current bank for a one-character name that
+  // isn't a sample name. kNoPad if neither. Lock-free and doesn't allocate.
+  PadId find(std::string_view name) const;
+
+  // Switch to a bank by index (from 0, like MIDI program numbers). Returns false if there is none.
+  bool selectBank(size_t bank);
+
+  // Switch to a bank by name, or by index if `name` is a number
+  bool selectBank(std::string_view name);
+
+  // Switch to the next (+1) or previous (-1) bank, wrapping around
+  void stepBank(int delta);
+
+  size_t currentBank() const { return current_.load(std::memory_order_relaxed); }
+  size_t bankCount() const { return bank_count_.load(std::memory_order_relaxed); }
+  std::string bankName(size_t bank) const;
+  std::string padName(PadId pad) const;
+
+  // Every pad of a bank, in pad order, with its key (for display)
+  std::vector<PadLabel> bankPads(size_t bank) const;
+
+  void setBankChangeCallback(BankChangeCallback callback);
+
+ private:
+  // Hashes std::string keys and std::string_view lookups alike
+  struct NameHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+  };
+  using NameTable = std::unordered_map<std::string, PadId, NameHash, std::equal_to<>>;
+
+  std::array<std::array<std::atomic<PadId>, 256>, kMaxBanks> keys_;  // By bank, then key
+  std::atomic<size_t> current_;
+  std::atomic<size_t> bank_count_;
+  std::atomic<const NameTable*> names_;         // Published by assign(), read by find()
+  mutable std::atomic<uint32_t> name_readers_;  // find() calls that may hold a names_ pointer
+
+  mutable std::mutex mutex_;
+  std::vector<std::string> bank_names_;
+  std::vector<PadLabel> pads_;  // Indexed by PadId (pad == kNoPad for gaps)
+  std::vector<size_t> pad_banks_;  // Bank of each pad, indexed by PadId
+  std::unique_ptr<const NameTable> names_owner_;  // What names_ points to
+  BankChangeCallback callback_;
+};
+
+}  // namespace mpccli
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include "pad.h"
+
+namespace mpccli {
+
+// What a pad plays (defined by the audio processor)
+struct PadSound;
+
+// Per-pad state shared by the threads that play pads (inputs, sequencer), the audio thread
+// and the visualizer. Each pad has its own cache line, so triggering one pad and metering
+// another never touch the same line.
+struct alignas(64) PadEntry {
+  // Published by the processor when a sample is registered (nullptr = nothing to play).
+  // Dereference it only under the engine's ReclaimEpochs::Pin, as triggers do: a replaced
+  // sound is freed once every pinned trigger and the notes it queued are done with it.
+  std::atomic<const PadSound*> sound{nullptr};
+
+  // RMS of the last block the pad sounded in, stored by the audio thread and decayed by
+  // the visualizer (which only decays the value it read, so new hits are never lost)
+  std::atomic<float> level{0.0f};
+};
+
+static_assert(sizeof(PadEntry) == 64, "one pad per cache line");
+
+// Flat table of every pad, indexed by PadId: looking a pad up is a single indexed load.
+// Lives as long as everything sharing it (it is passed around as a shared_ptr).
+class PadTable {
+ public:
+  PadTable() : entries_(new PadEntry[kMaxPads]) {}
+
+  PadTable(const PadTable&) = delete;
+  PadTable& operator=(const PadTable&) = delete;
+
+  // Entry of a pad (pad < kMaxPads)
+  PadEntry& operator[](PadId pad) { return entries_[pad]; }
+  const PadEntry& operator[](PadId pad) const { return entries_[pad]; }
+
+  // Whether a pad has a sound to play (false for kNoPad)
+  bool loaded(PadId pad) const {
+    return pad < kMaxPads && entries_[pad].sound.load(std::memory_order_acquire) != nullptr;
+  }
+
+ private:
+  std::unique_ptr<PadEntry[]> entries_;  // Cache-line aligned (over-aligned new)
+};
+
+}  // namespace mpccli
@@ -1,15 +1,28 @@
+#include <array>
+#include <cassert>
 #include <iostream>
 #include <filesystem>
+#include <future>
 #include <thread>
 #include <gst/gst.h>
 #include <signal.h>
 #include <unistd.h>
 #include <termios.h>
-#include <yaml-cpp/yaml.h>
 #include "audio-processor/audio_processor.h"
 #include "input/keyboard_input.h"
+#include "input/midi_input.h"
+#include "control/osc_server.h"
+#include "control/control_api.h"
+#include "control/control_server.h"
+#include "config/file_watcher.h"
+#include "config/kit_config.h"
+#include "kit/kit_file.h"
+#include "kit/pad_banks.h"
 #include "visualizer/wave_visualizer.h"
 #include "sequencer/sequencer.h"
+#include "clock/clock.h"
+#include "realtime/realtime.h"
+#include "bench/bench.h"
 
 using namespace mpccli;
 
@@ -39,51 +52,6 @@ void alarmHandler(int signal) {
   _exit(1);
 }
 
-struct SampleSpec {
-  std::string filename;
-  std::string name;
-  double volume;
-};
-
-std::map<char, SampleSpec> loadSamplesFromYaml(const std::string& yaml_path) {
-  std::map<char, SampleSpec> sample_map;
-
-  try {
-    YAML::Node config = YAML::LoadFile(yaml_path);
-
-    if (!config["samples"]) {
-      throw std::runtime_error("YAML file missing 'samples' key");
-    }
-
-    for (const auto& sample : config["samples"]) {
-      std::string sample_name = sample.first.as<std::string>();
-      YAML::Node sample_data = sample.second;
-
-      if (!sample_data["path"] || !sample_data["key"]) {
-        std::cerr << "Warning: Sample '" << sample_name << "' missing 'path' or 'key', skipping" << std::endl;
-        continue;
-      }
-
-      std::string path = sample_data["path"].as<std::string>();
-      std::string key_str = sample_data["key"].as<std::string>();
-      double volume = sample_data["volume"] ? sample_data["volume"].as<double>() : 1.0;
-
-      if (key_str.length() != 1) {
-        std::cerr << "Warning: Sample '" << sample_name << "' key must be a single character, skipping" << std::endl;
-        continue;
-      }
-
-      char key = key_str[0];
-      sample_map[key] = {path, sample_name, volume};
-    }
-  } catch (const YAML::Exception& e) {
-    std::cerr << "Error loading YAML file: " << e.what() << std::endl;
-    throw;
-  }
-
-  return sample_map;
-}
-
 // Map keyboard keys to semitone offsets (Ableton style)
 // Returns semitone offset, or -999 if not a piano key
 int getPitchOffset(char key) {
@@ -108,6 +76,11 @@ int getPitchOffset(char key) {
 }
 
 int main(int argc, char* argv[]) {
+  // `mpc-cli bench <name>` runs a built-in benchmark and exits (no audio device needed)
+  if (argc >= 2 && std::string(argv[1]) == "bench") {
+    return runBenchmark(argc >= 3 ? argv[2] : "");
+  }
+
   std::cout << "Starting mpc-cli audio sampler..." << std::endl;
 
   // Set environment variables to speed up GStreamer initialization
@@ -124,54 +97,128 @@ int main(int argc, char* argv[]) {
   }
   std::cout << "GStreamer initialized" << std::endl;
 
-  // Create audio processor with 4 simultaneous pipeline slots
-  auto audio_processor = std::make_unique<AudioProcessor>();
+  // `mpc-cli kit build [samples.yaml] [samples.kit]` compiles the kit and its decoded audio into one file
+  if (argc >= 3 && std::string(argv[1]) == "kit" && std::string(argv[2]) == "build") {
+    const bool built = buildKit(argc >= 4 ? argv[3] : "samples.yaml", argc >= 5 ? argv[4] : "samples.kit");
+    gst_deinit();
+    return built ? 0 : 1;
+  }
+
+  // `mpc-cli --kit <file>` starts from a compiled kit instead of samples.yaml
+  const std::string kit_path = argc >= 3 && std::string(argv[1]) == "--kit" ? argv[2] : "";
+
+  // Every pad's sound and level, shared by the processor, the sequencer and the visualizer
+  auto pad_table = std::make_shared<PadTable>();
+
+  // Create audio processor (decodes samples and mixes them in the engine)
+  auto audio_processor = std::make_unique<AudioProcessor>(pad_table);
 
   // Pitch mode state
   std::atomic<bool> pitch_mode_active(false);
-  std::atomic<char> pitch_mode_key('\0');
+  std::atomic<PadId> pitch_mode_pad(kNoPad);
   std::atomic<int> pitch_octave_offset(0);  // -2, -1, 0, 1, 2...
 
+  // Monotonic clock shared by everything that schedules musical time
+  auto clock = std::make_shared<SteadyClock>();
+
   // Create sequencer with callback to play samples with pitch
-  auto sequencer = std::make_unique<Sequencer>([&audio_processor](char key, double pitch) {
+  auto sequencer = std::make_unique<Sequencer>([&audio_processor](PadId pad, double pitch, int velocity) {
     // Sequencer now handles pitch - always use playSampleWithPitch
-    audio_processor->playSampleWithPitch(key, pitch);
-  });
+    audio_processor->playSampleWithPitch(pad, pitch, velocity);
+  }, clock, pad_table);
+
+  // Send delays follow the sequencer's tempo
+  sequencer->setTempoCallback([&audio_processor](double bpm) { audio_processor->setTempo(bpm); });
 
   // Register some sample audio files
   // You'll need to provide actual audio files in the samples/ directory
   std::cout << "\nRegistering audio samples..." << std::endl;
 
   // Helper to safely register samples
-  auto register_if_exists = [&](char key, const std::string& path, const std::string& name, double volume) {
-    if (std::filesystem::exists(path)) {
-      audio_processor->registerSample(key, path, volume);
-      return true;
-    } else {
-      std::cout << "  [MISSING] " << name << " (" << path << ")" << std::endl;
-      return false;
+  auto register_if_exists = [&](PadId pad, const SampleSpec& spec) {
+    for (const SampleLayer& layer : spec.layers) {
+      for (const std::string& path : layer.files) {
+        if (kit_path.empty() && !std::filesystem::exists(path)) {
+          std::cout << "  [MISSING] " << spec.name << " (" << path << ")" << std::endl;
+          return false;
+        }
+      }
     }
+    audio_processor->registerSample(pad, spec.layers, spec.options);
+    return true;
   };
 
-  // Load samples from YAML file
+  // Load samples from the compiled kit, or from the YAML file
   std::string yaml_path = "samples.yaml";
-  std::map<char, SampleSpec> sample_map;
+  const std::string& config_path = kit_path.empty() ? yaml_path : kit_path;
+  KitLayout layout;
+  EngineSettings engine_settings;
+  ControlSettings control_settings;
+  MixerSettings mixer_settings;
+  LoadedKit kit;  // Keeps the kit file mapped for the whole run
 
   try {
-    sample_map = loadSamplesFromYaml(yaml_path);
+    if (!kit_path.empty()) {
+      const auto load_start = std::chrono::steady_clock::now();
+      kit = loadKitFile(kit_path);
+      layout = std::move(kit.layout);
+      engine_settings = kit.engine;
+      control_settings = kit.control;
+      mixer_settings = kit.mixer;
+      audio_processor->provideDecodedFiles(kit.files);
+      std::cout << "Mapped " << kit_path << " in "
+                << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - load_start).count()
+                << " ms" << std::endl;
+    } else {
+      layout = loadSamplesFromYaml(yaml_path);
+      engine_settings = loadEngineSettingsFromYaml(yaml_path);
+      control_settings = loadControlSettingsFromYaml(yaml_path);
+      mixer_settings = loadMixerSettingsFromYaml(yaml_path);
+    }
   } catch (const std::exception& e) {
-    std::cerr << "Failed to load samples from " << yaml_path << ": " << e.what() << std::endl;
+    std::cerr << "Failed to load samples from " << config_path << ": " << e.what() << std::endl;
     return 1;
   }
 
-  if (sample_map.empty()) {
-    std::cerr << "No samples defined in " << yaml_path << std::endl;
+  if (layout.pads.empty()) {
+    std::cerr << "No samples defined in " << config_path << std::endl;
     return 1;
   }
 
+  // `--output <backend>[:device]` overrides the configured output, e.g. `--output null` on
+  // machines without a sound card or `--output file:take.wav` to record the session
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (std::string(argv[i]) != "--output") {
+      continue;
+    }
+    const std::string value = argv[i + 1];
+    const size_t colon = value.find(':');
+    if (!parseOutputBackend(value.substr(0, colon), engine_settings.output.backend)) {
+      std::cerr << "Unknown output '" << value << "' (use coreaudio, alsa, auto, file or null)" << std::endl;
+      return 1;
+    }
+    engine_settings.output.device = colon == std::string::npos ? "" : value.substr(colon + 1);
+  }
+
+  // `--realtime` runs the audio and sequencer threads with the recommended real-time
+  // settings, unless samples.yaml already configures them
+  for (int i = 1; i < argc; ++i) {
+    if (std::string(argv[i]) == "--realtime" && !engine_settings.realtime.enabled()) {
+      engine_settings.realtime = RealtimeSettings::recommended();
+    }
+  }
+
+  audio_processor->setRealtime(engine_settings.realtime);
+
+  audio_processor->setOutput(engine_settings.output);
+  audio_processor->setResamplerQuality(engine_settings.resampler_quality);
+  audio_processor->setPitchCacheBudget(engine_settings.pitch_cache_mb * 1024 * 1024);
+  audio_processor->setRenderThreads(engine_settings.render_threads);
+  std::cout << "Resampler quality: " << resamplerQualityName(engine_settings.resampler_quality) << std::endl;
+
   int registered_count = 0;
-  for (const auto& s : sample_map) {
-    registered_count += register_if_exists(s.first, s.second.filename, s.second.name, s.second.volume);
+  for (const auto& [pad, spec] : layout.pads) {
+    registered_count += register_if_exists(pad, spec);
   }
 
   if (registered_count == 0) {
@@ -181,22 +228,69 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
-  assert(registered_count == sample_map.size());
+  assert(registered_count == layout.pads.size());
 
-  std::cout << "\n✓ Registered " << registered_count << " audio samples" << std::endl;
+  if (engine_settings.realtime.prefault) {
+    std::cout << "Realtime samples: " << audio_processor->prefaultedBytes() / (1024 * 1024) << " MB prefaulted"
+              << std::endl;
+  }
 
-  // Create visualizer and set up amplitude callback
-  WaveVisualizer visualizer;
-  std::map<char, std::string> vis_sample_names;
-  for (const auto& [key, spec] : sample_map) {
-    vis_sample_names[key] = spec.name;
+  // Lock memory once the kit is loaded, and only if the memlock limit covers everything
+  // mapped by then (mlockall fails outright past it). The pitch cache and hot reloads
+  // allocate later, unlocked, so they never run into the limit.
+  if (engine_settings.realtime.lock_memory) {
+    const size_t needed = memoryToLock(audio_processor->sampleBytes());
+    const size_t limit = memoryLockLimit();
+    if (limit < needed) {
+      std::cerr << "Realtime memory: not locked (the memlock limit of " << limit / (1024 * 1024)
+                << " MB is below the " << needed / (1024 * 1024)
+                << " MB of samples, code and buffers; raise it with ulimit -l or grant CAP_IPC_LOCK)" << std::endl;
+    } else {
+      std::cout << describeMemoryLock(lockMemory()) << std::endl;
+    }
   }
-  visualizer.initialize(vis_sample_names);
 
-  // Set amplitude callback to update visualizer
-  audio_processor->setAmplitudeCallback([&visualizer](char key, float amplitude) {
-    visualizer.updateAmplitude(key, amplitude);
-  });
+  audio_processor->setMixer(mixerRouting(mixer_settings, layout));
+  sequencer->setTempo(mixer_settings.tempo);
+
+  std::cout << "\n✓ Registered " << registered_count << " audio samples in " << layout.banks.size() << " banks"
+            << std::endl;
+
+  // Keys play pads through the current bank; every bank's samples are already loaded
+  PadBanks banks;
+  banks.assign(layout);
+
+  // Create visualizer (showing the current bank's levels from the pad table)
+  WaveVisualizer visualizer(pad_table);
+  auto show_bank = [&visualizer, &banks](size_t bank) {
+    visualizer.initialize(banks.bankPads(bank));
+    visualizer.updateBank(banks.bankName(bank), bank, banks.bankCount());
+  };
+  show_bank(banks.currentBank());
+  banks.setBankChangeCallback(show_bank);
+
+  // Open the audio output now that samples are in place
+  if (!audio_processor->start()) {
+    std::cerr << "Failed to start audio output" << std::endl;
+    return 1;
+  }
+
+  // The audio threads only record their real-time setup; print it once the output thread
+  // has rendered (the render workers did when they started)
+  if (engine_settings.realtime.setsUpAudioThreads()) {
+    size_t reported = 0;
+    const auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (true) {
+      for (const std::string& report : audio_processor->takeThreadSetupReports()) {
+        std::cout << report << std::endl;
+        ++reported;
+      }
+      if (reported >= audio_processor->renderThreads() || std::chrono::steady_clock::now() > give_up) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
 
   // Disable terminal echo
   struct termios old_tio, new_tio;
@@ -214,8 +308,16 @@ int main(int argc, char* argv[]) {
   signal(SIGTERM, signalHandler);
   signal(SIGALRM, alarmHandler);
 
+  // Note started by each held key (pad and pitch), so its release stops the same note
+  // even if pitch mode, the octave or the bank changed while it was held. Only touched by the event loop.
+  struct HeldNote {
+    PadId pad = kNoPad;
+    double semitones = 0.0;
+  };
+  std::array<HeldNote, 256> held_notes{};
+
   // Set callback to play samples when keys are pressed
-  keyboard_input.setKeyPressCallback([&audio_processor, &sequencer, &pitch_mode_active, &pitch_mode_key, &pitch_octave_offset](char key, bool shift) {
+  keyboard_input.setKeyPressCallback([&audio_processor, &sequencer, &banks, &pitch_mode_active, &pitch_mode_pad, &pitch_octave_offset, &held_notes](char key, bool shift, int velocity) {
     if (key == 27) {  // ESC key
       if (g_keyboard_input) {
         g_keyboard_input->stop();
@@ -233,15 +335,25 @@ int main(int argc, char* argv[]) {
 
     // Handle SHIFT + key to enter pitch mode
     if (shift) {
-      if (!pitch_mode_active.load()) {
+      const PadId pad = banks.padForKey(key);
+      if (!pitch_mode_active.load() && pad != kNoPad) {
         // SHIFT + key enters pitch mode for that sample
-        pitch_mode_key = key;
+        pitch_mode_pad = pad;
         pitch_mode_active = true;
         pitch_octave_offset = 0;  // Reset octave
+
+        // Pre-render this sample's pitch variants in the background
+        audio_processor->preparePitchMode(pad, 0);
       }
       return;
     }
 
+    // [ and ] switch to the previous/next bank (works in both normal and pitch mode)
+    if (key == '[' || key == ']') {
+      banks.stepBank(key == '[' ? -1 : 1);
+      return;
+    }
+
     // Handle sequencer controls (works in both normal and pitch mode)
     if (key == '1') {  // 1 = toggle recording
       sequencer->toggleRecording();
@@ -260,10 +372,12 @@ int main(int argc, char* argv[]) {
       // Check for octave shift keys
       if (key == 'z') {
         pitch_octave_offset = pitch_octave_offset.load() - 12;
+        audio_processor->preparePitchMode(pitch_mode_pad.load(), pitch_octave_offset.load());
         return;
       }
       if (key == 'x') {
         pitch_octave_offset = pitch_octave_offset.load() + 12;
+        audio_processor->preparePitchMode(pitch_mode_pad.load(), pitch_octave_offset.load());
         return;
       }
 
@@ -274,56 +388,253 @@ int main(int argc, char* argv[]) {
 
       // Play the selected sample with pitch
       double total_semitones = pitch_offset + pitch_octave_offset.load();
-      audio_processor->playSampleWithPitch(pitch_mode_key.load(), total_semitones);
+      audio_processor->playSampleWithPitch(pitch_mode_pad.load(), total_semitones, velocity);
+      held_notes[static_cast<unsigned char>(key)] = {pitch_mode_pad.load(), total_semitones};
 
       // Record with pitch if recording is active
-      sequencer->recordKey(pitch_mode_key.load(), total_semitones);
+      sequencer->recordPad(pitch_mode_pad.load(), total_semitones, velocity);
+      return;
+    }
+
+    // Keys without a pad in the current bank do nothing
+    const PadId pad = banks.padForKey(key);
+    if (pad == kNoPad) {
       return;
     }
 
-    // Record key with no pitch (0.0 = original)
-    sequencer->recordKey(key, 0.0);
+    // Record pad with no pitch (0.0 = original)
+    sequencer->recordPad(pad, 0.0, velocity);
 
-    // Try to play the sample at original pitch
-    audio_processor->playSampleWithPitch(key, 0.0);
+    // Play the sample at original pitch
+    audio_processor->playSampleWithPitch(pad, 0.0, velocity);
+    held_notes[static_cast<unsigned char>(key)] = {pad, 0.0};
   });
 
+  // Releasing a key ends its note (only samples with an envelope respond)
+  keyboard_input.setKeyReleaseCallback([&audio_processor, &held_notes](char key) {
+    HeldNote& note = held_notes[static_cast<unsigned char>(key)];
+    if (note.pad != kNoPad) {
+      audio_processor->releaseSample(note.pad, note.semitones);
+      note = HeldNote{};
+    }
+  });
+
+  // MIDI pads play their mapped sample at the controller's velocity (the keyboard keeps working alongside).
+  // Notes map to pads directly, whatever bank is selected; program changes select banks.
+  std::unique_ptr<MidiInput> midi_input = MidiInput::create();
+  if (midi_input) {
+    bool has_midi_notes = false;
+    for (const auto& [pad, spec] : layout.pads) {
+      if (spec.midi_note >= 0) {
+        midi_input->mapNote(spec.midi_note, pad);
+        has_midi_notes = true;
+      }
+    }
+
+    midi_input->setNoteCallback([&audio_processor, &sequencer](PadId pad, int velocity,
+                                                               std::chrono::steady_clock::time_point received) {
+      if (velocity == 0) {
+        audio_processor->releaseSample(pad);
+        return;
+      }
+      audio_processor->playSampleWithPitch(pad, 0.0, velocity, received, {}, TriggerSource::Midi);
+      sequencer->recordPad(pad, 0.0, velocity);
+    });
+    midi_input->setProgramCallback([&banks](int program) {
+      banks.selectBank(static_cast<size_t>(program));
+    });
+
+    if ((!has_midi_notes && layout.banks.size() < 2) || !midi_input->start()) {
+      midi_input.reset();
+    }
+  }
+
+  // OSC control from other tools on this machine (triggers may be scheduled with bundle timetags)
+  std::unique_ptr<OscServer> osc_server;
+  if (control_settings.osc_port > 0) {
+    osc_server = std::make_unique<OscServer>(control_settings.osc_port);
+    osc_server->setTriggerCallback([&audio_processor, &sequencer, &banks](std::string_view name, int velocity, double pitch,
+                                                                          std::chrono::steady_clock::time_point received,
+                                                                          std::chrono::steady_clock::time_point play_at) {
+      const PadId pad = banks.find(name);
+      if (pad != kNoPad) {
+        audio_processor->playSampleWithPitch(pad, pitch, velocity, received, play_at, TriggerSource::Remote);
+        sequencer->recordPad(pad, pitch, velocity);
+      }
+    });
+    osc_server->setBankCallback([&banks](std::string_view bank) {
+      banks.selectBank(bank);
+    });
+    osc_server->setRecordCallback([&sequencer](std::optional<bool> state) {
+      if (!state || *state != sequencer->isRecording()) {
+        sequencer->toggleRecording();
+      }
+    });
+    osc_server->setPlayCallback([&sequencer](std::optional<bool> state) {
+      if (!state || *state != sequencer->isPlaying()) {
+        sequencer->togglePlaying();
+      }
+    });
+    if (!osc_server->start()) {
+      osc_server.reset();
+    }
+  }
+
+  // Control and stats API on a Unix socket (e.g. `socat - UNIX-CONNECT:/tmp/mpc-cli.sock`)
+  ControlApi control_api(*audio_processor, *sequencer, banks);
+  std::unique_ptr<ControlServer> control_server;
+  if (!control_settings.socket_path.empty()) {
+    control_server = std::make_unique<ControlServer>(control_settings.socket_path, [&control_api](const std::string& request) {
+      return control_api.handle(request);
+    });
+    if (!control_server->start()) {
+      control_server.reset();
+    }
+  }
+
+  // Hot reload: when samples.yaml or one of its samples changes, decode what changed in the
+  // background and swap the new kit in. Unchanged samples are reused and playing voices
+  // finish on the buffers they started with. (A compiled kit is rebuilt with `kit build` instead.)
+  std::unique_ptr<FileWatcher> file_watcher = kit_path.empty() ? FileWatcher::create() : nullptr;
+  if (file_watcher) {
+    file_watcher->watch(kitFiles(yaml_path, layout));
+    file_watcher->setChangeCallback([&](const std::set<std::string>& changed) {
+      KitLayout reloaded;
+      EngineSettings reloaded_engine;
+      MixerSettings reloaded_mixer;
+      try {
+        // Samples keep their pad (and so their recorded notes and pitch variants) by name
+        reloaded = keepPadIds(layout, loadSamplesFromYaml(yaml_path));
+        reloaded_engine = loadEngineSettingsFromYaml(yaml_path);
+        reloaded_mixer = loadMixerSettingsFromYaml(yaml_path);
+      } catch (const std::exception& e) {
+        std::cerr << "Keeping the current kit, " << yaml_path << " failed to load: " << e.what() << std::endl;
+        return;
+      }
+
+      // A sample whose files are missing (e.g. halfway through being copied) keeps its current version
+      std::map<PadId, SampleDefinition> definitions;
+      for (auto it = reloaded.pads.begin(); it != reloaded.pads.end();) {
+        bool missing = false;
+        for (const SampleLayer& layer : it->second.layers) {
+          for (const std::string& path : layer.files) {
+            missing = missing || !std::filesystem::exists(path);
+          }
+        }
+        auto current = layout.pads.find(it->first);
+        if (missing && current == layout.pads.end()) {
+          std::cout << "  [MISSING] " << it->second.name << std::endl;
+          it = reloaded.pads.erase(it);
+          continue;
+        }
+        if (missing) {
+          std::cout << "  [MISSING] " << it->second.name << " (keeping the current sample)" << std::endl;
+          it->second.layers = current->second.layers;
+          it->second.options = current->second.options;
+        }
+        definitions[it->first] = {it->second.layers, it->second.options};
+        ++it;
+      }
+
+      audio_processor->setResamplerQuality(reloaded_engine.resampler_quality);
+      audio_processor->setPitchCacheBudget(reloaded_engine.pitch_cache_mb * 1024 * 1024);
+      SampleUpdateSummary summary = audio_processor->updateSamples(definitions, changed);
+
+      // Channels follow pad IDs, so the graph is recompiled whenever the pads may have moved
+      audio_processor->setMixer(mixerRouting(reloaded_mixer, reloaded));
+      // A tempo set from the control API stands until the file's tempo itself changes
+      if (reloaded_mixer.tempo != mixer_settings.tempo) {
+        sequencer->setTempo(reloaded_mixer.tempo);
+      }
+      mixer_settings = reloaded_mixer;
+      std::cout << "Reloaded " << yaml_path << ": " << summary.loaded << " loaded, " << summary.unchanged
+                << " unchanged, " << summary.removed << " removed";
+      if (summary.failed > 0) {
+        std::cout << ", " << summary.failed << " failed";
+      }
+      std::cout << std::endl;
+
+      std::array<PadId, 128> midi_notes;
+      midi_notes.fill(kNoPad);
+      for (const auto& [pad, spec] : reloaded.pads) {
+        if (spec.midi_note >= 0 && spec.midi_note < 128) {
+          midi_notes[spec.midi_note] = pad;
+        }
+      }
+      banks.assign(reloaded);
+      show_bank(banks.currentBank());
+      if (midi_input) {
+        for (int note = 0; note < 128; ++note) {
+          midi_input->mapNote(note, midi_notes[note]);
+        }
+      }
+
+      layout = std::move(reloaded);
+      file_watcher->watch(kitFiles(yaml_path, layout));
+    });
+    if (!file_watcher->start()) {
+      file_watcher.reset();
+    }
+  }
+
+  // Start sequencer scheduling loop (sleeps until the next note is due), under the
+  // scheduler's real-time policy; its report is printed before the visualizer takes the screen
+  const RealtimeSettings& realtime = engine_settings.realtime;
+  std::promise<ThreadSetupResult> sequencer_setup;
+  std::future<ThreadSetupResult> sequencer_setup_result = sequencer_setup.get_future();
+  std::thread sequencer_thread([&sequencer, &realtime, &sequencer_setup]() {
+    sequencer_setup.set_value(setupCurrentThread(realtime.scheduler, realtime.prefault));
+    sequencer->run();
+  });
+  const ThreadSetupResult sequencer_result = sequencer_setup_result.get();
+  if (realtime.enabled()) {
+    std::cout << describeThreadSetup("sequencer thread", realtime.scheduler, sequencer_result) << std::endl;
+  }
+
   // Start the visualizer
   visualizer.start();
 
   // Start visualizer refresh thread
   std::atomic<bool> refresh_running(true);
-  std::thread refresh_thread([&visualizer, &sequencer, &pitch_mode_active, &pitch_mode_key, &pitch_octave_offset, &refresh_running]() {
-    auto last_tick = std::chrono::high_resolution_clock::now();
+  std::thread refresh_thread([&visualizer, &sequencer, &audio_processor, &pitch_mode_active, &pitch_mode_pad, &pitch_octave_offset, &refresh_running]() {
+    auto last_tick = std::chrono::steady_clock::now();
     while (refresh_running) {
       // Update sequencer status in visualizer
       visualizer.updateSequencerStatus(sequencer->isRecording(), sequencer->isPlaying());
       // Update pitch mode status in visualizer
-      visualizer.updatePitchMode(pitch_mode_active.load(), pitch_mode_key.load(), pitch_octave_offset.load());
+      visualizer.updatePitchMode(pitch_mode_active.load(), pitch_mode_pad.load(), pitch_octave_offset.load());
+      // Update render load in visualizer
+      const RenderLoad load = audio_processor->renderLoad();
+      visualizer.updateRenderLoad(load.deadline_ratio, load.overruns, load.underruns);
       
       // Refresh
       visualizer.refresh();
-      auto now = std::chrono::high_resolution_clock::now();
+      auto now = std::chrono::steady_clock::now();
       auto delta = std::chrono::duration_cast<std::chrono::microseconds>(now - last_tick);
       std::this_thread::sleep_for(std::chrono::milliseconds(16) - delta);  // ~60 FPS
       last_tick = now;
     }
   });
 
-  // Start sequencer update loop
-  std::atomic<bool> sequencer_running(true);
-  std::thread sequencer_thread([&sequencer, &sequencer_running]() {
-    while (sequencer_running) {
-      sequencer->tick();
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));  // High precision timing
-    }
-  });
-
   // Start the keyboard event loop (this will block until stop() is called)
   keyboard_input.startEventLoop();
 
+  // Stop reloads, MIDI and OSC callbacks before the processor and sequencer go away
+  if (file_watcher) {
+    file_watcher->stop();
+  }
+  if (midi_input) {
+    midi_input->stop();
+  }
+  if (osc_server) {
+    osc_server->stop();
+  }
+  if (control_server) {
+    control_server->stop();
+  }
+
   // Stop sequencer thread
-  sequencer_running = false;
+  sequencer->stop();
   if (sequencer_thread.joinable()) {
     sequencer_thread.join();
   }
@@ -340,10 +651,36 @@ int main(int argc, char* argv[]) {
   // Stop visualizer
   visualizer.stop();
 
+  // MIDI-to-audio latency: measured arrival-to-render plus the limiter lookahead and the output's buffering
+  LatencyHistogram::Snapshot latency = audio_processor->midiLatency();
+  if (latency.count > 0) {
+    const double output_ms =
+        (audio_processor->outputLatencySeconds() + audio_processor->mixerLatencySeconds()) * 1000.0;
+    std::cout << "MIDI-to-audio latency over " << latency.count << " notes: mean "
+              << latency.mean_seconds * 1000.0 + output_ms << " ms, p99 < "
+              << latency.percentileSeconds(0.99) * 1000.0 + output_ms << " ms, max "
+              << latency.max_seconds * 1000.0 + output_ms << " ms (includes " << output_ms << " ms limiter and output buffering)"
+              << std::endl;
+  }
+
+  // Output threads started when the output was reopened
+  for (const std::string& report : audio_processor->takeThreadSetupReports()) {
+    std::cout << report << std::endl;
+  }
+
+  // Render time against each buffer's deadline over the whole run
+  const RenderLoad load = audio_processor->renderLoad();
+  if (load.deadline_ratio.count > 0) {
+    std::cout << "Render load over " << load.deadline_ratio.count << " buffers: mean "
+              << load.deadline_ratio.mean_ratio * 100.0 << "%, p99 < " << load.deadline_ratio.percentileRatio(0.99) * 100.0
+              << "%, max " << load.deadline_ratio.max_ratio * 100.0 << "% of the deadline; " << load.overruns
+              << " overruns, " << load.underruns << " underruns" << std::endl;
+  }
+
   std::cout << "Cleaning up..." << std::endl;
 
   // Cleanup - destroy audio processor before deinitializing GStreamer
-  audio_processor.reset();  // Explicitly destroy all pipelines
+  audio_processor.reset();  // Explicitly destroy the output pipeline
 
   g_keyboard_input = nullptr;
 
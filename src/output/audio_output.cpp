@@ -0,0 +1,75 @@
+#include "audio_output.h"
+#include <algorithm>
+#include <iostream>
+#include "clocked_output.h"
+
+namespace mpccli {
+
+const char* outputBackendName(OutputBackend backend) {
+  switch (backend) {
+    case OutputBackend::CoreAudio: return "coreaudio";
+    case OutputBackend::Alsa: return "alsa";
+    case OutputBackend::Auto: return "auto";
+    case OutputBackend::File: return "file";
+    case OutputBackend::Null: return "null";
+  }
+  return "unknown";
+}
+
+bool parseOutputBackend(const std::string& name, OutputBackend& backend) {
+  if (name == "coreaudio") {
+    backend = OutputBackend::CoreAudio;
+  } else if (name == "alsa") {
+    backend = OutputBackend::Alsa;
+  } else if (name == "auto") {
+    backend = OutputBackend::Auto;
+  } else if (name == "file") {
+    backend = OutputBackend::File;
+  } else if (name == "null") {
+    backend = OutputBackend::Null;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+AudioOutput::AudioOutput(RenderCallback render, const OutputSettings& settings, int channels)
+    : render_callback_(std::move(render)),
+      settings_(settings),
+      channels_(channels),
+      underruns_(0) {
+}
+
+void AudioOutput::render(float* output, size_t frames) {
+  if (render_callback_) {
+    render_callback_(output, frames);
+  } else {
+    std::fill(output, output + frames * channels_, 0.0f);
+  }
+}
+
+std::unique_ptr<AudioOutput> AudioOutput::create(RenderCallback render, const OutputSettings& settings, int channels) {
+  try {
+    switch (settings.backend) {
+      case OutputBackend::CoreAudio:
+      case OutputBackend::Auto:
+        return createGstOutput(std::move(render), settings, channels);
+      case OutputBackend::Alsa:
+#if defined(__APPLE__)
+        std::cerr << "The ALSA output is only available on Linux" << std::endl;
+        return nullptr;
+#else
+        return createAlsaOutput(std::move(render), settings, channels);
+#endif
+      case OutputBackend::File:
+        return std::make_unique<WavFileOutput>(std::move(render), settings, channels);
+      case OutputBackend::Null:
+        return std::make_unique<NullOutput>(std::move(render), settings, channels);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Failed to open " << outputBackendName(settings.backend) << " output: " << e.what() << std::endl;
+  }
+  return nullptr;
+}
+
+}  // namespace mpccli
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include "../dsp/sample_buffer.h"
+
+namespace mpccli {
+
+// Where the engine's mix goes
+enum class OutputBackend {
+  CoreAudio,  // GStreamer osxaudiosink (macOS)
+  Alsa,       // ALSA PCM device, written directly (Linux)
+  Auto,       // GStreamer autoaudiosink: PulseAudio or PipeWire on Linux
+  File,       // 32-bit float WAV file, rendered in real time
+  Null,       // Discards the audio, paced by the steady clock like a device
+};
+
+#if defined(__APPLE__)
+constexpr OutputBackend kDefaultOutputBackend = OutputBackend::CoreAudio;
+#else
+constexpr OutputBackend kDefaultOutputBackend = OutputBackend::Auto;
+#endif
+
+const char* outputBackendName(OutputBackend backend);
+
+// Parse "coreaudio", "alsa", "auto", "file" or "null". Returns false for anything else.
+bool parseOutputBackend(const std::string& name, OutputBackend& backend);
+
+// Device format and buffering. The render callback fills one buffer of `buffer_frames`
+// at a time; the device's ring holds `periods` of them.
+struct OutputSettings {
+  static constexpr double kMinSampleRate = 8000.0;
+  static constexpr double kMaxSampleRate = 192000.0;
+  static constexpr size_t kMinBufferFrames = 16;
+  static constexpr size_t kMaxBufferFrames = 8192;
+  static constexpr size_t kMinPeriods = 2;
+  static constexpr size_t kMaxPeriods = 16;
+
+  OutputBackend backend = kDefaultOutputBackend;
+  std::string device;  // ALSA device ("default" if empty), or the WAV path ("mpc-cli.wav" if empty)
+  double sample_rate = kEngineSampleRate;
+  size_t buffer_frames = 256;
+  size_t periods = 4;
+
+  bool operator==(const OutputSettings&) const = default;
+};
+
+// An audio output that pulls interleaved float buffers from a render callback on its own
+// thread. Backends are created by create(); each one reports the latency its buffering adds.
+class AudioOutput {
+ public:
+  // Fill `frames` interleaved float frames (called on the output thread)
+  using RenderCallback = std::function<void(float* output, size_t frames)>;
+
+  virtual ~AudioOutput() = default;
+
+  // Open the backend named by `settings`. Returns nullptr (after reporting why) if the
+  // device or file can't be opened or the backend isn't available on this platform.
+  static std::unique_ptr<AudioOutput> create(RenderCallback render, const OutputSettings& settings,
+                                             int channels = kEngineChannels);
+
+  // Start pulling audio from the render callback
+  virtual bool start() = 0;
+
+  // Stop and close the output (the render callback is never called once this returns)
+  virtual void destroy() = 0;
+
+  virtual bool isPlaying() const = 0;
+
+  // Worst-case time from render to the device
+  virtual double outputLatencySeconds() const = 0;
+
+  // Buffers that reached the device too late, so it played silence (or, for the clocked
+  // file and null outputs, renders that missed a whole period)
+  uint64_t underruns() const { return underruns_.load(std::memory_order_relaxed); }
+
+  // The settings in use; a device may have adjusted the buffer size or period count
+  const OutputSettings& settings() const { return settings_; }
+  double sampleRate() const { return settings_.sample_rate; }
+  size_t blockFrames() const { return settings_.buffer_frames; }
+
+ protected:
+  AudioOutput(RenderCallback render, const OutputSettings& settings, int channels);
+
+  // Fill `output` from the render callback (silence without one)
+  void render(float* output, size_t frames);
+
+  // Called by the backend on its output thread
+  void countUnderrun() { underruns_.fetch_add(1, std::memory_order_relaxed); }
+
+  RenderCallback render_callback_;
+  OutputSettings settings_;
+  int channels_;
+  std::atomic<uint64_t> underruns_;
+};
+
+// Backends outside this module (nullptr if they fail to open)
+std::unique_ptr<AudioOutput> createGstOutput(AudioOutput::RenderCallback render, const OutputSettings& settings,
+                                             int channels);
+std::unique_ptr<AudioOutput> createAlsaOutput(AudioOutput::RenderCallback render, const OutputSettings& settings,
+                                              int channels);
+
+}  // namespace mpccli
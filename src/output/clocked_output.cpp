@@ -0,0 +1,165 @@
+#include "clocked_output.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#if defined(__linux__)
+#include <time.h>
+#endif
+
+namespace mpccli {
+
+namespace {
+
+constexpr size_t kFileBufferBytes = 1 << 20;
+constexpr uint16_t kWaveFormatFloat = 3;
+
+// Sleep to an absolute deadline (no drift from the time spent computing it)
+void sleepUntil(std::chrono::steady_clock::time_point deadline) {
+#if defined(__linux__)
+  // steady_clock is CLOCK_MONOTONIC here
+  const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+  timespec target{static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)};
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target, nullptr) == EINTR) {
+  }
+#else
+  std::this_thread::sleep_until(deadline);
+#endif
+}
+
+void putLittleEndian(char* out, uint32_t value, int bytes) {
+  for (int i = 0; i < bytes; ++i) {
+    out[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+  }
+}
+
+}  // namespace
+
+ClockedOutput::ClockedOutput(RenderCallback render, const OutputSettings& settings, int channels)
+    : AudioOutput(std::move(render), settings, channels),
+      buffer_(settings.buffer_frames * channels, 0.0f),
+      running_(false) {
+}
+
+ClockedOutput::~ClockedOutput() {
+  destroy();
+}
+
+double ClockedOutput::outputLatencySeconds() const {
+  return settings_.buffer_frames / settings_.sample_rate;
+}
+
+bool ClockedOutput::start() {
+  if (running_.exchange(true)) {
+    return true;
+  }
+  thread_ = std::thread(&ClockedOutput::run, this);
+  return true;
+}
+
+void ClockedOutput::destroy() {
+  const bool was_running = running_.exchange(false);
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (was_running) {
+    finish();
+  }
+}
+
+void ClockedOutput::run() {
+  const size_t frames = settings_.buffer_frames;
+  const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(frames / settings_.sample_rate));
+  auto deadline = std::chrono::steady_clock::now() + period;
+
+  while (running_.load(std::memory_order_relaxed)) {
+    render(buffer_.data(), frames);
+    consume(buffer_.data(), frames);
+
+    sleepUntil(deadline);
+    deadline += period;
+    const auto now = std::chrono::steady_clock::now();
+    if (now > deadline) {
+      deadline = now + period;  // A whole period late: skip ahead rather than burst
+      countUnderrun();
+    }
+  }
+}
+
+NullOutput::NullOutput(RenderCallback render, const OutputSettings& settings, int channels)
+    : ClockedOutput(std::move(render), settings, channels) {
+  std::cout << "Audio output: null sink (" << settings_.sample_rate << " Hz, " << settings_.buffer_frames
+            << "-frame buffers)" << std::endl;
+}
+
+WavFileOutput::WavFileOutput(RenderCallback render, const OutputSettings& settings, int channels)
+    : ClockedOutput(std::move(render), settings, channels),
+      file_(nullptr),
+      file_buffer_(kFileBufferBytes),
+      data_bytes_(0) {
+  if (settings_.device.empty()) {
+    settings_.device = "mpc-cli.wav";
+  }
+  file_ = std::fopen(settings_.device.c_str(), "wb");
+  if (!file_) {
+    throw std::runtime_error("Failed to create " + settings_.device + ": " + std::strerror(errno));
+  }
+  std::setvbuf(file_, file_buffer_.data(), _IOFBF, file_buffer_.size());
+  writeHeader(0);
+  std::cout << "Audio output: recording to " << settings_.device << " (" << settings_.sample_rate << " Hz, "
+            << settings_.buffer_frames << "-frame buffers)" << std::endl;
+}
+
+WavFileOutput::~WavFileOutput() {
+  destroy();
+  if (file_) {
+    std::fclose(file_);
+  }
+}
+
+void WavFileOutput::consume(const float* buffer, size_t frames) {
+  const size_t bytes = frames * channels_ * sizeof(float);
+  if (data_bytes_ + bytes > std::numeric_limits<uint32_t>::max() - 64) {
+    return;  // WAV sizes are 32-bit; stop recording at 4 GB
+  }
+  std::fwrite(buffer, 1, bytes, file_);
+  data_bytes_ += bytes;
+}
+
+void WavFileOutput::finish() {
+  std::fseek(file_, 0, SEEK_SET);
+  writeHeader(static_cast<uint32_t>(data_bytes_));
+  std::fseek(file_, 0, SEEK_END);
+  std::fflush(file_);
+  std::cout << "Recorded " << data_bytes_ / (channels_ * sizeof(float)) / settings_.sample_rate << " s to "
+            << settings_.device << std::endl;
+}
+
+void WavFileOutput::writeHeader(uint32_t data_bytes) {
+  // RIFF, an 18-byte fmt chunk for IEEE float, the fact chunk non-PCM formats carry, then data
+  char header[58];
+  const uint32_t frame_bytes = static_cast<uint32_t>(channels_ * sizeof(float));
+  const uint32_t rate = static_cast<uint32_t>(settings_.sample_rate);
+  std::memcpy(header, "RIFF", 4);
+  putLittleEndian(header + 4, sizeof(header) - 8 + data_bytes, 4);
+  std::memcpy(header + 8, "WAVEfmt ", 8);
+  putLittleEndian(header + 16, 18, 4);
+  putLittleEndian(header + 20, kWaveFormatFloat, 2);
+  putLittleEndian(header + 22, static_cast<uint32_t>(channels_), 2);
+  putLittleEndian(header + 24, rate, 4);
+  putLittleEndian(header + 28, rate * frame_bytes, 4);
+  putLittleEndian(header + 32, frame_bytes, 2);
+  putLittleEndian(header + 34, 32, 2);
+  putLittleEndian(header + 36, 0, 2);
+  std::memcpy(header + 38, "fact", 4);
+  putLittleEndian(header + 42, 4, 4);
+  putLittleEndian(header + 46, data_bytes / frame_bytes, 4);
+  std::memcpy(header + 50, "data", 4);
+  putLittleEndian(header + 54, data_bytes, 4);
+  std::fwrite(header, 1, sizeof(header), file_);
+}
+
+}  // namespace mpccli
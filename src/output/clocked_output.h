@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "audio_output.h"
+
+namespace mpccli {
+
+// Output with no device behind it: a thread renders one buffer per period on absolute
+// steady-clock deadlines, so buffers are consumed at exactly the sample rate on average
+// and timing never drifts. A render that overruns a whole period skips ahead instead of
+// bursting to catch up, like a device that underran. Subclasses must call destroy() in
+// their destructor, before the thread could call into a destroyed consume().
+class ClockedOutput : public AudioOutput {
+ public:
+  ~ClockedOutput() override;
+
+  bool start() override;
+  void destroy() override;
+  bool isPlaying() const override { return running_.load(std::memory_order_relaxed); }
+
+  // Each buffer is rendered one period before its deadline
+  double outputLatencySeconds() const override;
+
+ protected:
+  ClockedOutput(RenderCallback render, const OutputSettings& settings, int channels);
+
+  // Take a rendered buffer (on the output thread)
+  virtual void consume(const float* buffer, size_t frames) = 0;
+
+  // Called on the caller's thread after the output thread has stopped
+  virtual void finish() {}
+
+ private:
+  void run();
+
+  std::vector<float> buffer_;
+  std::thread thread_;
+  std::atomic<bool> running_;
+};
+
+// Discards every buffer: runs the whole engine without a sound card (CI, benchmarks)
+class NullOutput : public ClockedOutput {
+ public:
+  NullOutput(RenderCallback render, const OutputSettings& settings, int channels);
+  ~NullOutput() override { destroy(); }
+
+ protected:
+  void consume(const float*, size_t) override {}
+};
+
+// Records the output to a 32-bit float WAV file. The header's sizes are filled in when
+// the output is destroyed.
+class WavFileOutput : public ClockedOutput {
+ public:
+  // Throws if the file can't be created
+  WavFileOutput(RenderCallback render, const OutputSettings& settings, int channels);
+  ~WavFileOutput() override;
+
+ protected:
+  void consume(const float* buffer, size_t frames) override;
+  void finish() override;
+
+ private:
+  void writeHeader(uint32_t data_bytes);
+
+  std::FILE* file_;
+  std::vector<char> file_buffer_;  // stdio buffer, so most writes are a copy
+  uint64_t data_bytes_;
+};
+
+}  // namespace mpccli
@@ -0,0 +1,189 @@
+#include "audio_output.h"
+#include <alsa/asoundlib.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace mpccli {
+
+namespace {
+
+// ALSA PCM backend: blocking interleaved writes of one period at a time from a dedicated
+// thread, so each write returns as soon as the device has room for the next period.
+// Float samples are written directly when the device takes them, otherwise converted to
+// 16-bit. Playback starts once the whole ring is full; an underrun re-prepares the device
+// and carries on.
+class AlsaOutput : public AudioOutput {
+ public:
+  AlsaOutput(RenderCallback render, const OutputSettings& settings, int channels)
+      : AudioOutput(std::move(render), settings, channels),
+        pcm_(nullptr),
+        use_float_(true),
+        ring_frames_(0),
+        running_(false) {
+    if (settings_.device.empty()) {
+      settings_.device = "default";
+    }
+    int err = snd_pcm_open(&pcm_, settings_.device.c_str(), SND_PCM_STREAM_PLAYBACK, 0);
+    if (err < 0) {
+      pcm_ = nullptr;
+      throw std::runtime_error("Failed to open ALSA device " + settings_.device + ": " + snd_strerror(err));
+    }
+    if (!configure()) {
+      snd_pcm_close(pcm_);
+      pcm_ = nullptr;
+      throw std::runtime_error("ALSA device " + settings_.device + " can't play " +
+                               std::to_string(static_cast<int>(settings_.sample_rate)) + " Hz");
+    }
+
+    buffer_.assign(settings_.buffer_frames * channels_, 0.0f);
+    if (!use_float_) {
+      converted_.assign(settings_.buffer_frames * channels_, 0);
+    }
+    std::cout << "Audio output: ALSA " << settings_.device << " (" << settings_.sample_rate << " Hz, "
+              << (use_float_ ? "float" : "16-bit") << ", " << settings_.buffer_frames << "-frame buffers x "
+              << settings_.periods << " periods, " << outputLatencySeconds() * 1000.0 << " ms output latency)"
+              << std::endl;
+  }
+
+  ~AlsaOutput() override {
+    destroy();
+  }
+
+  bool start() override {
+    if (!pcm_) {
+      return false;
+    }
+    if (running_.exchange(true)) {
+      return true;
+    }
+    thread_ = std::thread([this]() { writeLoop(); });
+    return true;
+  }
+
+  void destroy() override {
+    running_ = false;
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    if (pcm_) {
+      snd_pcm_drop(pcm_);
+      snd_pcm_close(pcm_);
+      pcm_ = nullptr;
+    }
+  }
+
+  bool isPlaying() const override {
+    return running_.load(std::memory_order_relaxed);
+  }
+
+  // A buffer rendered just as the ring fills waits behind all of it
+  double outputLatencySeconds() const override {
+    return ring_frames_ / settings_.sample_rate;
+  }
+
+ private:
+  // Negotiate the format, then read back the period size and count the device chose
+  bool configure() {
+    snd_pcm_hw_params_t* hw;
+    snd_pcm_hw_params_alloca(&hw);
+    snd_pcm_hw_params_any(pcm_, hw);
+    if (snd_pcm_hw_params_set_access(pcm_, hw, SND_PCM_ACCESS_RW_INTERLEAVED) < 0 ||
+        snd_pcm_hw_params_set_channels(pcm_, hw, static_cast<unsigned int>(channels_)) < 0) {
+      return false;
+    }
+    if (snd_pcm_hw_params_set_format(pcm_, hw, SND_PCM_FORMAT_FLOAT_LE) < 0) {
+      use_float_ = false;
+      if (snd_pcm_hw_params_set_format(pcm_, hw, SND_PCM_FORMAT_S16_LE) < 0) {
+        return false;
+      }
+    }
+
+    // The engine renders at exactly this rate; "default" and "plughw" resample if needed
+    unsigned int rate = static_cast<unsigned int>(settings_.sample_rate);
+    if (snd_pcm_hw_params_set_rate(pcm_, hw, rate, 0) < 0) {
+      return false;
+    }
+
+    snd_pcm_uframes_t period = settings_.buffer_frames;
+    unsigned int periods = static_cast<unsigned int>(settings_.periods);
+    snd_pcm_hw_params_set_period_size_near(pcm_, hw, &period, nullptr);
+    snd_pcm_hw_params_set_periods_near(pcm_, hw, &periods, nullptr);
+    if (snd_pcm_hw_params(pcm_, hw) < 0) {
+      return false;
+    }
+
+    snd_pcm_uframes_t ring = 0;
+    snd_pcm_hw_params_get_period_size(hw, &period, nullptr);
+    snd_pcm_hw_params_get_buffer_size(hw, &ring);
+    settings_.buffer_frames = std::clamp<size_t>(period, OutputSettings::kMinBufferFrames,
+                                                 OutputSettings::kMaxBufferFrames);
+    settings_.periods = std::max<size_t>(1, ring / std::max<snd_pcm_uframes_t>(period, 1));
+    ring_frames_ = ring;
+
+    // Wake when a period is free; start only once the ring is full
+    snd_pcm_sw_params_t* sw;
+    snd_pcm_sw_params_alloca(&sw);
+    snd_pcm_sw_params_current(pcm_, sw);
+    snd_pcm_sw_params_set_avail_min(pcm_, sw, period);
+    snd_pcm_sw_params_set_start_threshold(pcm_, sw, ring - ring % period);
+    return snd_pcm_sw_params(pcm_, sw) >= 0 && snd_pcm_prepare(pcm_) >= 0;
+  }
+
+  void writeLoop() {
+    const size_t frames = settings_.buffer_frames;
+    while (running_.load(std::memory_order_relaxed)) {
+      render(buffer_.data(), frames);
+
+      const void* data = buffer_.data();
+      if (!use_float_) {
+        for (size_t i = 0; i < buffer_.size(); ++i) {
+          converted_[i] = static_cast<int16_t>(std::lrint(std::clamp(buffer_[i], -1.0f, 1.0f) * 32767.0f));
+        }
+        data = converted_.data();
+      }
+      const size_t frame_bytes = channels_ * (use_float_ ? sizeof(float) : sizeof(int16_t));
+
+      size_t written = 0;
+      while (written < frames && running_.load(std::memory_order_relaxed)) {
+        snd_pcm_sframes_t result =
+            snd_pcm_writei(pcm_, static_cast<const char*>(data) + written * frame_bytes, frames - written);
+        if (result >= 0) {
+          written += static_cast<size_t>(result);
+          continue;
+        }
+        // -EPIPE is an underrun: re-prepare and refill (also handles -EINTR and -ESTRPIPE)
+        if (result == -EPIPE) {
+          countUnderrun();
+        }
+        if (snd_pcm_recover(pcm_, static_cast<int>(result), 1) < 0) {
+          std::cerr << "ALSA output failed: " << snd_strerror(static_cast<int>(result)) << std::endl;
+          running_ = false;
+          return;
+        }
+      }
+    }
+  }
+
+  snd_pcm_t* pcm_;
+  bool use_float_;
+  size_t ring_frames_;
+  std::vector<float> buffer_;
+  std::vector<int16_t> converted_;
+  std::thread thread_;
+  std::atomic<bool> running_;
+};
+
+}  // namespace
+
+std::unique_ptr<AudioOutput> createAlsaOutput(AudioOutput::RenderCallback render, const OutputSettings& settings,
+                                              int channels) {
+  return std::make_unique<AlsaOutput>(std::move(render), settings, channels);
+}
+
+}  // namespace mpccli
@@ -0,0 +1,177 @@
+#include "realtime.h"
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace mpccli {
+
+namespace {
+
+// Deeper than any render call chain gets
+constexpr size_t kPrefaultStackBytes = 128 * 1024;
+
+// Binary, libraries, thread stacks and mixer buffers, where the mapped size can't be read
+constexpr size_t kLockAllowanceBytes = 256 * 1024 * 1024;
+
+size_t pageBytes() {
+  static const size_t bytes = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return bytes;
+}
+
+// Fault in the stack pages below the caller, so the first deep render doesn't
+__attribute__((noinline)) void prefaultStack() {
+  volatile unsigned char* stack = static_cast<volatile unsigned char*>(alloca(kPrefaultStackBytes));
+  for (size_t i = 0; i < kPrefaultStackBytes; i += pageBytes()) {
+    stack[i] = 0;
+  }
+}
+
+std::string errorText(int error, const char* hint) {
+  std::string text = std::string("failed (") + std::strerror(error);
+  if ((error == EPERM || error == ENOMEM) && *hint) {
+    text += std::string("; ") + hint;
+  }
+  return text + ")";
+}
+
+}  // namespace
+
+RealtimeSettings RealtimeSettings::recommended() {
+  RealtimeSettings settings;
+  settings.audio.priority = 80;
+  settings.scheduler.priority = 70;
+  settings.lock_memory = true;
+  settings.prefault = true;
+  return settings;
+}
+
+ThreadSetupResult setupCurrentThread(const ThreadPolicy& policy, bool prefault, size_t index) {
+  ThreadSetupResult result;
+  if (policy.priority > 0) {
+    sched_param param{};
+    param.sched_priority = policy.priority;
+    result.priority_error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  }
+
+  if (!policy.cores.empty()) {
+    result.core = policy.cores[index % policy.cores.size()];
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (result.core < CPU_SETSIZE) {
+      CPU_SET(result.core, &set);
+      result.pin_error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    } else {
+      result.pin_error = EINVAL;
+    }
+#else
+    result.pin_error = ENOTSUP;  // macOS only takes affinity hints, not CPUs
+#endif
+  }
+
+  if (prefault) {
+    prefaultStack();
+    result.prefaulted_stack_bytes = kPrefaultStackBytes;
+  }
+  return result;
+}
+
+std::string describeThreadSetup(const std::string& name, const ThreadPolicy& policy, const ThreadSetupResult& result) {
+  std::vector<std::string> parts;
+  if (result.priority_error >= 0) {
+    parts.push_back("SCHED_FIFO " + std::to_string(policy.priority) + " " +
+                    (result.priority_error == 0
+                         ? "ok"
+                         : errorText(result.priority_error, "raise the rtprio limit (ulimit -r) or grant CAP_SYS_NICE")));
+  }
+  if (result.pin_error >= 0) {
+    parts.push_back("CPU " + std::to_string(result.core) + " " +
+                    (result.pin_error == 0 ? "ok" : errorText(result.pin_error, "")));
+  }
+  if (result.prefaulted_stack_bytes > 0) {
+    parts.push_back(std::to_string(result.prefaulted_stack_bytes / 1024) + " KB stack prefaulted");
+  }
+  if (parts.empty()) {
+    parts.push_back("normal scheduling");
+  }
+
+  std::string text = "Realtime " + name + ":";
+  for (size_t i = 0; i < parts.size(); ++i) {
+    text += (i ? ", " : " ") + parts[i];
+  }
+  return text;
+}
+
+int lockMemory() {
+  return mlockall(MCL_CURRENT) == 0 ? 0 : errno;
+}
+
+size_t memoryToLock(size_t data_bytes) {
+#if defined(__linux__)
+  // The kernel checks the whole address space against the limit (statm's first field)
+  std::ifstream statm("/proc/self/statm");
+  size_t pages = 0;
+  if (statm >> pages) {
+    return pages * pageBytes();
+  }
+#endif
+  return data_bytes + kLockAllowanceBytes;
+}
+
+size_t memoryLockLimit() {
+  rlimit limit{};
+  if (geteuid() == 0 || getrlimit(RLIMIT_MEMLOCK, &limit) != 0 || limit.rlim_cur == RLIM_INFINITY) {
+    return SIZE_MAX;
+  }
+  return static_cast<size_t>(limit.rlim_cur);
+}
+
+std::string describeMemoryLock(int error) {
+  return std::string("Realtime memory: ") +
+         (error == 0 ? "locked" : errorText(error, "raise the memlock limit (ulimit -l) or grant CAP_IPC_LOCK"));
+}
+
+void prefaultMemory(const void* data, size_t bytes) {
+  if (!data || bytes == 0) {
+    return;
+  }
+  const volatile unsigned char* begin = static_cast<const volatile unsigned char*>(data);
+  unsigned char sum = 0;
+  for (size_t i = 0; i < bytes; i += pageBytes()) {
+    sum += begin[i];
+  }
+  sum += begin[bytes - 1];
+  (void)sum;
+}
+
+bool parseCoreList(const std::string& text, std::vector<int>& cores) {
+  std::vector<int> parsed;
+  std::istringstream stream(text);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (item.empty() || item.find_first_not_of("0123456789") != std::string::npos || item.size() > 6) {
+      return false;
+    }
+    parsed.push_back(std::stoi(item));
+  }
+  cores = std::move(parsed);
+  return true;
+}
+
+std::string formatCoreList(const std::vector<int>& cores) {
+  std::string text;
+  for (size_t i = 0; i < cores.size(); ++i) {
+    text += (i ? "," : "") + std::to_string(cores[i]);
+  }
+  return text;
+}
+
+}  // namespace mpccli
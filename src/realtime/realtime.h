@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace mpccli {
+
+// How one class of threads should be scheduled
+struct ThreadPolicy {
+  static constexpr int kMaxPriority = 99;
+
+  int priority = 0;        // SCHED_FIFO priority (1-99); 0 keeps normal scheduling
+  std::vector<int> cores;  // CPUs to pin to (empty = any); thread N takes cores[N % size]
+
+  bool operator==(const ThreadPolicy&) const = default;
+};
+
+// Real-time setup of the audio path. Everything is off by default; each setting is
+// tried on its own and reported, so an unprivileged run still gets whatever it can.
+struct RealtimeSettings {
+  ThreadPolicy audio;      // Output thread (worker 0) and render workers
+  ThreadPolicy scheduler;  // Sequencer thread
+  bool lock_memory = false;  // mlockall(MCL_CURRENT) once loaded: the kit is never paged out
+  bool prefault = false;     // Touch thread stacks and sample audio before the first render needs them
+
+  // Whether the audio threads need setting up (a priority, CPUs or stack prefaulting)
+  bool setsUpAudioThreads() const { return audio.priority > 0 || !audio.cores.empty() || prefault; }
+
+  bool enabled() const {
+    return audio.priority > 0 || !audio.cores.empty() || scheduler.priority > 0 || !scheduler.cores.empty() ||
+           lock_memory || prefault;
+  }
+
+  // SCHED_FIFO 80 for audio and 70 for the scheduler, memory locked and prefaulted, no pinning
+  static RealtimeSettings recommended();
+
+  bool operator==(const RealtimeSettings&) const = default;
+};
+
+// What applying a ThreadPolicy to the calling thread achieved. Errors are errno values:
+// 0 took effect, -1 wasn't asked for.
+struct ThreadSetupResult {
+  int priority_error = -1;
+  int pin_error = -1;
+  int core = -1;  // Pinned to, if asked
+  size_t prefaulted_stack_bytes = 0;
+};
+
+// Apply `policy` to the calling thread as thread `index` of its class, and prefault its
+// stack if `prefault`
+ThreadSetupResult setupCurrentThread(const ThreadPolicy& policy, bool prefault, size_t index = 0);
+
+// "Realtime <name>: SCHED_FIFO 80 ok, CPU 2 ok, 128 KB stack prefaulted", with the reason
+// and a hint for each setting that failed
+std::string describeThreadSetup(const std::string& name, const ThreadPolicy& policy, const ThreadSetupResult& result);
+
+// mlockall(MCL_CURRENT). Returns 0 or the errno value. Later allocations (pitch variants,
+// hot-reloaded samples) stay unlocked, so they can't fail against the memlock limit.
+int lockMemory();
+
+// Bytes lockMemory() would lock: everything the process has mapped (binary, libraries,
+// thread stacks, buffers) where that can be read, otherwise `data_bytes` plus an allowance
+// for the rest
+size_t memoryToLock(size_t data_bytes);
+
+// Bytes this process may lock: the RLIMIT_MEMLOCK soft limit, or SIZE_MAX when it is
+// unlimited or the process runs as root
+size_t memoryLockLimit();
+
+// "Realtime memory: locked" or why not
+std::string describeMemoryLock(int error);
+
+// Touch one byte per page so [data, data + bytes) is resident before the audio thread reads it
+void prefaultMemory(const void* data, size_t bytes);
+
+// "2,3" <-> {2, 3}. parseCoreList() returns false for anything but non-negative numbers.
+bool parseCoreList(const std::string& text, std::vector<int>& cores);
+std::string formatCoreList(const std::vector<int>& cores);
+
+}  // namespace mpccli
@@ -4,105 +4,121 @@
 #include <iostream>
 #include <algorithm>
 
-Sequencer::Sequencer(KeyTriggerCallback callback)
+Sequencer::Sequencer(PadTriggerCallback callback, std::shared_ptr<const mpccli::Clock> clock,
+                     std::shared_ptr<const mpccli::PadTable> pads)
     : playing_(false),
       recording_(false),
+      tempo_(120.0),
+      clock_(clock ? std::move(clock) : std::make_shared<mpccli::SteadyClock>()),
+      pads_(std::move(pads)),
+      sequence_record_start_time_(mpccli::ClockTime::zero()),
+      sequence_play_start_time_(mpccli::ClockTime::zero()),
       sequence_length_(std::chrono::duration<double>::zero()),
-      previous_play_position_(std::chrono::duration<double>::zero()),
+      current_loop_(0),
       current_index_(0),
-      key_trigger_callback_(callback) {
+      pad_trigger_callback_(callback),
+      wake_pending_(false),
+      stopped_(false) {
 }
 
 void Sequencer::toggleRecording() {
-  const std::chrono::time_point<std::chrono::system_clock> now =
-        std::chrono::system_clock::now();
-  if (recording_) {
-    // Stop recording
-    sequence_length_ = now - sequence_record_start_time_;
-    recording_ = false;
-
+  {
     std::lock_guard<std::mutex> lk(sequence_points_lock_);
+    const mpccli::ClockTime now = clock_->now();
+    if (recording_) {
+      // Stop recording
+      sequence_length_ = now - sequence_record_start_time_;
+      recording_ = false;
+
+      // Sort sequence points by time
+      std::sort(sequence_points_.begin(), sequence_points_.end(),
+                [](const SequencePoint& a, const SequencePoint& b) {
+                  return a.time_from_start_ < b.time_from_start_;
+                });
+
+      // Automatically play
+      startPlayingLocked(now);
+    } else {
+      // Start recording
+      sequence_record_start_time_ = now;
+      sequence_length_ = std::chrono::duration<double>::zero();
+      sequence_points_.clear();
+      recording_ = true;
+    }
+  }
 
-    // Sort sequence points by time
-    std::sort(sequence_points_.begin(), sequence_points_.end(),
-              [](const SequencePoint& a, const SequencePoint& b) {
-                return a.time_from_start_ < b.time_from_start_;
-              });
-
-    // Automatically play
-    togglePlaying();
-  } else {
-    // Start recording
-    sequence_record_start_time_ = now;
-    sequence_length_ = std::chrono::duration<double>::zero();
-
-    std::lock_guard<std::mutex> lk(sequence_points_lock_);
-    sequence_points_.clear();
+  wake();
+}
 
-    recording_ = true;
+void Sequencer::setTempo(double bpm) {
+  bpm = std::clamp(bpm, 20.0, 300.0);
+  tempo_ = bpm;
+  if (tempo_callback_) {
+    tempo_callback_(bpm);
   }
 }
 
-void Sequencer::recordKey(char key, double pitch) {
-  if (!recording_) {
+void Sequencer::recordPad(mpccli::PadId pad, double pitch, int velocity) {
+  if (!recording_ || !playable(pad)) {
     return;
   }
 
-  const std::chrono::time_point<std::chrono::system_clock> now =
-        std::chrono::system_clock::now();
-  std::chrono::duration<double> timeSinceStart = now - sequence_record_start_time_;
-  SequencePoint pt = { key, timeSinceStart, pitch };
+  {
+    std::lock_guard<std::mutex> lk(sequence_points_lock_);
+    std::chrono::duration<double> timeSinceStart = clock_->now() - sequence_record_start_time_;
+    sequence_points_.push_back({ pad, timeSinceStart, pitch, velocity });
+  }
 
-  std::lock_guard<std::mutex> lk(sequence_points_lock_);
-  sequence_points_.push_back(pt);
+  wake();
 }
 
 void Sequencer::togglePlaying() {
-  const std::chrono::time_point<std::chrono::system_clock> now =
-        std::chrono::system_clock::now();
-
-  if (playing_) {
-    // Stop playing
-    previous_play_position_ = std::chrono::duration<double>(-0.001);
-    playing_ = false;
-  } else {
-    // Start playing
-    sequence_play_start_time_ = now;
-    current_index_ = 0;
-    // Initialize to small negative value to ensure notes at time 0 trigger
-    previous_play_position_ = std::chrono::duration<double>(-0.001);
-    playing_ = true;
+  {
+    std::lock_guard<std::mutex> lk(sequence_points_lock_);
+    if (playing_) {
+      // Stop playing
+      playing_ = false;
+    } else {
+      startPlayingLocked(clock_->now());
+    }
   }
+
+  wake();
+}
+
+void Sequencer::startPlayingLocked(mpccli::ClockTime now) {
+  // Start playing from the first note of loop 0
+  sequence_play_start_time_ = now;
+  current_index_ = 0;
+  current_loop_ = 0;
+  playing_ = true;
 }
 
-void Sequencer::tick() {
+std::optional<std::chrono::duration<double>> Sequencer::tick() {
+  // The play position is written by whichever thread starts playback or recording
+  std::lock_guard<std::mutex> lk(sequence_points_lock_);
   if (!playing_) {
-    return;
+    return std::nullopt;
   }
 
-  const std::chrono::time_point<std::chrono::system_clock> now =
-        std::chrono::system_clock::now();
-
   // Calculate current position using floating-point for precision
-  std::chrono::duration<double> time_since_start = now - sequence_play_start_time_;
+  std::chrono::duration<double> time_since_start = clock_->now() - sequence_play_start_time_;
   double sequence_length = sequence_length_.count();
 
   // Handle empty or zero-length sequence
   if (sequence_length <= 0.0 || sequence_points_.empty()) {
-    return;
+    return std::nullopt;
   }
 
-  // Wrap using floating-point modulo to maintain precision
-  double wrapped_time = std::fmod(time_since_start.count(), sequence_length);
-  auto current_position = std::chrono::duration<double>(wrapped_time);
-
-  std::lock_guard<std::mutex> lk(sequence_points_lock_);
-
-  // Check if we wrapped around (looped back to the start)
-  bool wrapped = current_position < previous_play_position_;
+  // Split into loop iteration and position within the loop.
+  // Tracking the loop count (rather than comparing positions) detects a wrap
+  // even when the scheduler sleeps straight past the loop point.
+  int64_t loop = static_cast<int64_t>(std::floor(time_since_start.count() / sequence_length));
+  auto current_position = std::chrono::duration<double>(time_since_start.count() - loop * sequence_length);
 
-  if (wrapped) {
+  if (loop != current_loop_) {
     // Reset index when we loop back to start
+    current_loop_ = loop;
     current_index_ = 0;
   }
 
@@ -114,8 +130,8 @@ void Sequencer::tick() {
 
     // Check if this note should play at current position
     if (pt.time_from_start_ <= current_position) {
-      if (key_trigger_callback_) {
-        key_trigger_callback_(pt.key_, pt.pitch_);
+      if (pad_trigger_callback_ && playable(pt.pad_)) {
+        pad_trigger_callback_(pt.pad_, pt.pitch_, pt.velocity_);
       }
 
       current_index_++;  // Move to next note
@@ -125,5 +141,50 @@ void Sequencer::tick() {
     }
   }
 
-  previous_play_position_ = current_position;
+  // Time until the next note: later in this loop, or the first note of the next loop
+  if (current_index_ < sequence_points_.size()) {
+    return sequence_points_[current_index_].time_from_start_ - current_position;
+  }
+  return sequence_length_ - current_position + sequence_points_.front().time_from_start_;
+}
+
+void Sequencer::run() {
+  std::unique_lock<std::mutex> lk(wake_mutex_);
+  while (!stopped_) {
+    lk.unlock();
+    std::optional<std::chrono::duration<double>> next = tick();
+    lk.lock();
+
+    // A change arrived while we were ticking - re-evaluate immediately
+    if (wake_pending_) {
+      wake_pending_ = false;
+      continue;
+    }
+
+    auto woken = [this] { return wake_pending_ || stopped_; };
+    if (next) {
+      // Due times are in the sequencer clock's time, so let the clock do the sleeping
+      clock_->waitFor(wake_cv_, lk, *next, woken);
+    } else {
+      // Nothing scheduled: sleep until play/stop/record changes
+      wake_cv_.wait(lk, woken);
+    }
+    wake_pending_ = false;
+  }
+}
+
+void Sequencer::stop() {
+  {
+    std::lock_guard<std::mutex> lk(wake_mutex_);
+    stopped_ = true;
+  }
+  wake_cv_.notify_one();
+}
+
+void Sequencer::wake() {
+  {
+    std::lock_guard<std::mutex> lk(wake_mutex_);
+    wake_pending_ = true;
+  }
+  wake_cv_.notify_one();
 }
@@ -1,49 +1,106 @@
+#pragma once
+
 #include <chrono>
 #include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <vector>
 #include <functional>
+#include "../clock/clock.h"
+#include "../kit/pad.h"
+#include "../kit/pad_table.h"
 
 struct SequencePoint {
-  char key_;
+  mpccli::PadId pad_;
   std::chrono::duration<double> time_from_start_;
   double pitch_;  // Pitch in semitones (0 = original)
+  int velocity_;  // MIDI-style velocity (1-127)
 };
 
-// Callback type for when a key should be triggered during playback
-// Parameters: char key, double pitch (in semitones)
-using KeyTriggerCallback = std::function<void(char, double)>;
+// Callback type for when a pad should be triggered during playback
+// Parameters: PadId pad, double pitch (in semitones), int velocity (1-127)
+using PadTriggerCallback = std::function<void(mpccli::PadId, double, int)>;
+
+// Callback type for tempo changes, in BPM
+using TempoCallback = std::function<void(double)>;
 
 class Sequencer {
 public:
-  // Constructor takes a callback function to trigger keys during playback
-  explicit Sequencer(KeyTriggerCallback callback);
+  // Constructor takes a callback function to trigger pads during playback
+  // and the clock all recording/playback timing is measured against
+  // (defaults to a steady clock when none is given). With a pad table, pads that have no
+  // sound (e.g. removed by a kit reload) are neither recorded nor played.
+  explicit Sequencer(PadTriggerCallback callback, std::shared_ptr<const mpccli::Clock> clock = nullptr,
+                     std::shared_ptr<const mpccli::PadTable> pads = nullptr);
 
   void toggleRecording();
 
-  void recordKey(char key, double pitch = 0.0);
+  // Record a pad (not the key that played it, so playback is unaffected by bank switches)
+  void recordPad(mpccli::PadId pad, double pitch = 0.0, int velocity = 127);
 
   void togglePlaying();
 
-  void tick();
+  // Trigger every note that is due at the current clock time.
+  // Returns the time until the next note is due, or nullopt if nothing is scheduled
+  // (stopped, recording or empty sequence).
+  std::optional<std::chrono::duration<double>> tick();
+
+  // Run the scheduling loop on the calling thread until stop() is called.
+  // Sleeps until the next note is due and is woken early by play/stop/record changes,
+  // so a stopped or empty sequencer never wakes up.
+  void run();
+
+  // Ask run() to return (safe to call from any thread, before or after run() starts)
+  void stop();
 
   bool isRecording() const { return recording_.load(); }
   bool isPlaying() const { return playing_.load(); }
 
+  // Tempo in BPM (default 120). Recorded notes keep their own timing; the tempo is what
+  // synced effects such as the send delay follow. Values are clamped to 20-300.
+  void setTempo(double bpm);
+  double tempo() const { return tempo_.load(); }
+
+  // Called with the new tempo from whichever thread calls setTempo()
+  void setTempoCallback(TempoCallback callback) { tempo_callback_ = std::move(callback); }
+
 private:
+  // Begin playback from the first note at `now` (requires sequence_points_lock_)
+  void startPlayingLocked(mpccli::ClockTime now);
+
+  // Wake the scheduling loop so it re-evaluates the next due note
+  void wake();
+
+  // Whether a pad can be played (always true without a pad table)
+  bool playable(mpccli::PadId pad) const { return !pads_ || pads_->loaded(pad); }
+
   std::atomic<bool> playing_;
   std::atomic<bool> recording_;
+  std::atomic<double> tempo_;
+
+  std::shared_ptr<const mpccli::Clock> clock_;
+  std::shared_ptr<const mpccli::PadTable> pads_;
 
-  std::chrono::time_point<std::chrono::system_clock> sequence_record_start_time_;
-  std::chrono::time_point<std::chrono::system_clock> sequence_play_start_time_;
+  // Guards the recorded points and the record/play positions below, which the scheduling
+  // loop reads while input and UI threads start and stop recording and playback
+  std::mutex sequence_points_lock_;
+  std::vector<SequencePoint> sequence_points_;
+
+  mpccli::ClockTime sequence_record_start_time_;
+  mpccli::ClockTime sequence_play_start_time_;
 
   std::chrono::duration<double> sequence_length_;
-  std::chrono::duration<double> previous_play_position_;
+  int64_t current_loop_;  // Loop iteration the current_index_ belongs to
 
   size_t current_index_;  // Track last played note to avoid duplicates
 
-  std::mutex sequence_points_lock_;
-  std::vector<SequencePoint> sequence_points_;
+  PadTriggerCallback pad_trigger_callback_;
+  TempoCallback tempo_callback_;
 
-  KeyTriggerCallback key_trigger_callback_;
+  std::mutex wake_mutex_;
+  std::condition_variable wake_cv_;
+  bool wake_pending_;
+  bool stopped_;
 };
\ No newline at end of file
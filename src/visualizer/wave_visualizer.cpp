@@ -2,29 +2,38 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 #include <cmath>
 
 namespace mpccli {
 
-WaveVisualizer::WaveVisualizer()
-    : running_(false), is_recording_(false), is_playing_(false),
-      pitch_mode_active_(false), pitch_mode_key_('\0'), pitch_octave_offset_(0) {
+WaveVisualizer::WaveVisualizer(std::shared_ptr<PadTable> pads)
+    : table_(std::move(pads)), bank_index_(0), bank_count_(1), has_load_(false), load_mean_(0.0), load_p99_(0.0),
+      overruns_(0), underruns_(0), running_(false), layout_changed_(false), is_recording_(false),
+      is_playing_(false), pitch_mode_active_(false), pitch_mode_pad_(kNoPad), pitch_octave_offset_(0) {
 }
 
 WaveVisualizer::~WaveVisualizer() {
   stop();
 }
 
-void WaveVisualizer::initialize(const std::map<char, std::string>& sample_names) {
+void WaveVisualizer::initialize(const std::vector<PadLabel>& pads) {
   std::lock_guard<std::mutex> lock(mutex_);
-  sample_names_ = sample_names;
+  const bool rows_changed = pads_.size() != pads.size();
+  pads_ = pads;
 
-  // Initialize amplitudes to 0
-  for (const auto& [key, name] : sample_names_) {
-    amplitudes_[key] = 0.0f;
+  if (rows_changed) {
+    layout_changed_ = true;
   }
 }
 
+void WaveVisualizer::updateBank(const std::string& name, size_t index, size_t count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  bank_name_ = name;
+  bank_index_ = index;
+  bank_count_ = count;
+}
+
 void WaveVisualizer::start() {
   running_ = true;
   // Use alternate screen buffer (like vim/less)
@@ -48,44 +57,59 @@ void WaveVisualizer::stop() {
   }
 }
 
-void WaveVisualizer::updateAmplitude(char key, float amplitude) {
-  std::lock_guard<std::mutex> lock(mutex_);
-
-  // Clamp amplitude to 0-1 range
-  amplitude = std::max(0.0f, std::min(1.0f, amplitude));
-
-  // Apply some decay to make it look more natural
-  if (amplitudes_.count(key)) {
-    amplitudes_[key] = amplitude;
-  }
-}
-
 void WaveVisualizer::updateSequencerStatus(bool isRecording, bool isPlaying) {
   is_recording_ = isRecording;
   is_playing_ = isPlaying;
 }
 
-void WaveVisualizer::updatePitchMode(bool active, char key, int octave_offset) {
+void WaveVisualizer::updatePitchMode(bool active, PadId pad, int octave_offset) {
   pitch_mode_active_ = active;
-  pitch_mode_key_ = key;
+  pitch_mode_pad_ = pad;
   pitch_octave_offset_ = octave_offset;
 }
 
+void WaveVisualizer::updateRenderLoad(const DeadlineHistogram::Snapshot& deadline_ratio, uint64_t overruns,
+                                      uint64_t underruns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  overruns_ = overruns;
+  underruns_ = underruns;
+
+  const auto now = std::chrono::steady_clock::now();
+  if (now - load_window_time_ < std::chrono::seconds(1)) {
+    return;
+  }
+  const DeadlineHistogram::Snapshot window = deadline_ratio.since(load_window_start_);
+  if (window.count > 0) {
+    load_mean_ = window.mean_ratio;
+    load_p99_ = window.percentileRatio(0.99);
+    has_load_ = true;
+  }
+  load_window_start_ = deadline_ratio;
+  load_window_time_ = now;
+}
+
 void WaveVisualizer::refresh() {
   if (!running_) {
     return;
   }
 
+  // The number of sample rows changed: redraw the frame around them
+  if (layout_changed_.exchange(false)) {
+    clearScreen();
+    drawLayout();
+  }
+
   std::lock_guard<std::mutex> lock(mutex_);
 
   // Redraw all bars
   int row = 2;  // Start after header
-  for (const auto& [key, name] : sample_names_) {
-    float amplitude = amplitudes_[key];
-    drawBar(row++, key, name, amplitude);
+  for (const PadLabel& pad : pads_) {
+    std::atomic<float>& level = (*table_)[pad.pad].level;
+    float amplitude = level.load(std::memory_order_relaxed);
+    drawBar(row++, pad, std::max(0.0f, std::min(1.0f, amplitude)));
 
-    // Apply decay
-    amplitudes_[key] *= 0.95f;  // Decay by 5% each refresh
+    // Decay by 5% each refresh, unless the audio thread stored a new hit meanwhile
+    level.compare_exchange_strong(amplitude, amplitude * 0.95f, std::memory_order_relaxed);
   }
 
   // Draw sequencer status at bottom
@@ -114,7 +138,7 @@ void WaveVisualizer::drawLayout() {
   std::cout << "╠═══════════════════════════════════════════════════════════════════════════╣\n";
 
   // Draw each sample row
-  for (size_t i = 0; i < sample_names_.size(); ++i) {
+  for (size_t i = 0; i < pads_.size(); ++i) {
     std::cout << "║                                                                           ║\n";
   }
 
@@ -122,16 +146,16 @@ void WaveVisualizer::drawLayout() {
   std::cout << std::flush;
 }
 
-void WaveVisualizer::drawBar(int row, char key, const std::string& name, float amplitude) {
+void WaveVisualizer::drawBar(int row, const PadLabel& pad, float amplitude) {
   moveCursor(row, 2);
 
   // Clear from cursor to end of line
   std::cout << "\033[K";
 
-  // Format: "[a] Sample Name  [████████░░░░░░░░░░░░░░░░░░░░] 45%"
+  // Format: "[a] Sample Name  [████████░░░░░░░░░░░░░░░░░░░░] 45%" (pads without a key show "[ ]")
   std::ostringstream oss;
-  oss << "[" << key << "] ";
-  oss << std::left << std::setw(12) << name << " ";
+  oss << "[" << (pad.key != 0 ? pad.key : ' ') << "] ";
+  oss << std::left << std::setw(12) << pad.name << " ";
 
   // Draw bar
   oss << "[";
@@ -153,12 +177,13 @@ void WaveVisualizer::drawBar(int row, char key, const std::string& name, float a
 
 void WaveVisualizer::drawSequencerStatus() {
   // Position cursor below the bottom border
-  int status_row = 2 + sample_names_.size() + 1;
+  int status_row = 2 + pads_.size() + 1;
   moveCursor(status_row, 0);
 
   // ANSI color codes
   const char* RED = "\033[31m";
   const char* GREEN = "\033[32m";
+  const char* YELLOW = "\033[33m";
   const char* CYAN = "\033[36m";
   const char* WHITE = "\033[37m";
   const char* BOLD = "\033[1m";
@@ -183,9 +208,15 @@ void WaveVisualizer::drawSequencerStatus() {
   // Second line: Show pitch mode status if active
   std::cout << "\n";
   if (pitch_mode) {
-    char key = pitch_mode_key_.load();
+    const PadId pad = pitch_mode_pad_.load();
+    std::string name = "pad " + std::to_string(pad);
+    for (const PadLabel& label : pads_) {
+      if (label.pad == pad) {
+        name = label.name;
+      }
+    }
     int octave = pitch_octave_offset_.load() / 12;
-    std::cout << CYAN << BOLD << "[♪ Pitch Mode: " << key << " | Octave: ";
+    std::cout << CYAN << BOLD << "[♪ Pitch Mode: " << name << " | Octave: ";
     if (octave >= 0) std::cout << "+";
     std::cout << octave << "]" << RESET;
     std::cout << "  Piano keys: AWSEDFTGYHUJ | Z/X for octave";
@@ -193,6 +224,24 @@ void WaveVisualizer::drawSequencerStatus() {
     std::cout << "Press SHIFT + any sample key to enter pitch mode";
   }
 
+  // Third line: the bank, when there is more than one
+  std::cout << "\n";
+  if (bank_count_ > 1) {
+    std::cout << "Bank: " << BOLD << bank_name_ << RESET << " (" << bank_index_ + 1 << "/" << bank_count_
+              << ")  Press [ and ] to switch";
+  }
+  std::cout << "\033[K";  // The previous bank name may have been longer
+
+  // Fourth line: render time as a share of each buffer's deadline, and any dropouts
+  std::cout << "\n";
+  if (has_load_) {
+    std::cout << "Audio load: " << (load_p99_ >= 0.8 ? YELLOW : "") << std::lround(load_mean_ * 100.0)
+              << "% (p99 " << std::lround(load_p99_ * 100.0) << "%)" << RESET << " of buffer deadline  "
+              << (overruns_ > 0 ? RED : "") << "Overruns: " << overruns_ << RESET << "  "
+              << (underruns_ > 0 ? RED : "") << "Underruns: " << underruns_ << RESET;
+  }
+  std::cout << "\033[K";
+
   std::cout << "\n\n";
 
   if (pitch_mode) {
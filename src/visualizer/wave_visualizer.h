@@ -1,30 +1,41 @@
 #pragma once
 
-#include <map>
+#include <memory>
 #include <string>
 #include <mutex>
 #include <atomic>
+#include <chrono>
+#include <vector>
+#include "../engine/deadline_histogram.h"
+#include "../kit/pad.h"
+#include "../kit/pad_table.h"
 
 namespace mpccli {
 
 // Terminal-based waveform visualizer
-// Displays amplitude bars for each sample in real-time
+// Displays amplitude bars for each sample in real-time, from the levels the audio thread
+// stores in the pad table
 class WaveVisualizer {
  public:
-  WaveVisualizer();
+  explicit WaveVisualizer(std::shared_ptr<PadTable> pads);
   ~WaveVisualizer();
 
-  // Initialize the visualizer with sample names
-  void initialize(const std::map<char, std::string>& sample_names);
+  // Initialize the visualizer with the pads to show (one row each)
+  // (may be called again while running, e.g. after the kit is reloaded or the bank changed)
+  void initialize(const std::vector<PadLabel>& pads);
 
-  // Update amplitude for a specific key (0.0 to 1.0)
-  void updateAmplitude(char key, float amplitude);
+  // Update the bank shown in the footer (hidden while there is only one)
+  void updateBank(const std::string& name, size_t index, size_t count);
 
   // Update sequencer status (for display)
   void updateSequencerStatus(bool isRecording, bool isPlaying);
 
   // Update pitch mode status (for display)
-  void updatePitchMode(bool active, char key, int octave_offset);
+  void updatePitchMode(bool active, PadId pad, int octave_offset);
+
+  // Update the render load shown in the footer (call periodically; the load shown is
+  // averaged over the renders of about the last second)
+  void updateRenderLoad(const DeadlineHistogram::Snapshot& deadline_ratio, uint64_t overruns, uint64_t underruns);
 
   // Start the visualization (clears screen and draws initial layout)
   void start();
@@ -39,17 +50,28 @@ class WaveVisualizer {
   void clearScreen();
   void moveCursor(int row, int col);
   void drawLayout();
-  void drawBar(int row, char key, const std::string& name, float amplitude);
+  void drawBar(int row, const PadLabel& pad, float amplitude);
   void drawSequencerStatus();
 
-  std::map<char, std::string> sample_names_;
-  std::map<char, float> amplitudes_;
+  std::shared_ptr<PadTable> table_;
+  std::vector<PadLabel> pads_;
+  std::string bank_name_;
+  size_t bank_index_;
+  size_t bank_count_;
+  DeadlineHistogram::Snapshot load_window_start_;  // Render load at the start of the current window
+  std::chrono::steady_clock::time_point load_window_time_;
+  bool has_load_;  // A window has completed
+  double load_mean_;
+  double load_p99_;
+  uint64_t overruns_;
+  uint64_t underruns_;
   std::mutex mutex_;
   std::atomic<bool> running_;
+  std::atomic<bool> layout_changed_;  // Sample rows changed; redraw the frame on the next refresh
   std::atomic<bool> is_recording_;
   std::atomic<bool> is_playing_;
   std::atomic<bool> pitch_mode_active_;
-  std::atomic<char> pitch_mode_key_;
+  std::atomic<PadId> pitch_mode_pad_;
   std::atomic<int> pitch_octave_offset_;
 
   static constexpr int BAR_WIDTH = 50;